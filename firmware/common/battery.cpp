@@ -0,0 +1,225 @@
+/*--------------------------------------------------------------------------*
+* Battery monitoring
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Samples the battery voltage occasionally (the analog input is only enabled
+* for long enough to take a reading), filters it and tracks the rate it is
+* falling at. The time until the next sample is the time the battery takes
+* to drop by BATTERY_STEP_MV at the current rate so a stable battery is
+* rarely sampled. As the voltage drops the node saves power by sleeping for
+* longer and reducing the radio transmit power, at the cutoff voltage it
+* shuts down.
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+// Battery input scaling (millivolts for a full scale reading)
+#ifndef BATTERY_FULL_SCALE_MV
+#  define BATTERY_FULL_SCALE_MV 3300
+#endif
+
+// Voltage thresholds (millivolts), defaults are for a single alkaline cell
+#ifndef BATTERY_LOW_MV
+#  define BATTERY_LOW_MV        1100
+#endif
+#ifndef BATTERY_CRITICAL_MV
+#  define BATTERY_CRITICAL_MV   1000
+#endif
+#ifndef BATTERY_CUTOFF_MV
+#  define BATTERY_CUTOFF_MV     900
+#endif
+
+// The voltage must rise this much above a threshold to return to a level
+#define BATTERY_HYSTERESIS_MV   50
+
+// Sample interval limits (seconds)
+#define BATTERY_INTERVAL_MIN    60
+#define BATTERY_INTERVAL_MAX    3600
+
+// Minimum time between trend updates (seconds)
+#define BATTERY_TREND_PERIOD    1800
+
+// Longest sleep period batteryStretch() will produce (seconds)
+#define BATTERY_STRETCH_MAX     86400
+
+// Voltage change to wait for between samples (millivolts)
+#define BATTERY_STEP_MV         10
+
+// Time allowed for the first conversion after enabling the input (ms)
+#define BATTERY_SETTLE          2
+#define BATTERY_TIMEOUT         10
+
+// Filter coefficients (as shifts, 1/4 for the voltage, 1/8 for the trend)
+#define BATTERY_FILTER_SHIFT    2
+#define BATTERY_TREND_SHIFT     3
+
+// Values are kept in 1/16 millivolt units
+#define BATTERY_FRACTION        4
+
+// Radio transmit power for each level
+static const uint8_t g_power[] = { 3, 2, 0 };
+
+// Battery state
+static bool          g_sampling = false;
+static bool          g_valid = false;
+static uint32_t      g_sampleTime = 0;
+static uint32_t      g_lastTime = 0;
+static uint32_t      g_interval = 0;           // Seconds until the next sample
+static int32_t       g_voltage;                // Filtered voltage (mV / 16)
+static int32_t       g_lastVoltage;            // Filtered voltage at the last sample
+static int32_t       g_trend = 0;              // Rate of change (mV / hour / 16)
+static BATTERY_LEVEL g_level = BATTERY_NORMAL;
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Determine the level for the current voltage
+ *
+ * Moving to a lower level happens as soon as the voltage drops below the
+ * threshold, moving back up needs the voltage to rise BATTERY_HYSTERESIS_MV
+ * above it.
+ *
+ * @param millivolts the filtered battery voltage.
+ *
+ * @return the new battery level.
+ */
+static BATTERY_LEVEL batteryClassify(int32_t millivolts) {
+  static const int32_t thresholds[] = { BATTERY_LOW_MV, BATTERY_CRITICAL_MV };
+  int level = BATTERY_NORMAL;
+  while((level<BATTERY_CRITICAL)&&(millivolts<thresholds[level]))
+    level++;
+  while((level<g_level)&&(millivolts<(thresholds[level] + BATTERY_HYSTERESIS_MV)))
+    level++;
+  return (BATTERY_LEVEL)level;
+  }
+
+/** Process a new reading
+ *
+ * @param sample the raw 16 bit sample from the battery input.
+ */
+static void batteryUpdate(uint16_t sample) {
+  uint32_t now = getTicks();
+  int32_t reading = (int32_t)(((uint32_t)sample * BATTERY_FULL_SCALE_MV) >> (16 - BATTERY_FRACTION));
+  if(!g_valid) {
+    g_voltage = reading;
+    g_lastVoltage = reading;
+    g_lastTime = now;
+    g_valid = true;
+    }
+  else {
+    g_voltage += (reading - g_voltage) / (1 << BATTERY_FILTER_SHIFT);
+    uint32_t elapsed = timeElapsed(g_lastTime, now, SECOND);
+    if(elapsed>=BATTERY_TREND_PERIOD) {
+      int32_t slope = ((g_voltage - g_lastVoltage) * 3600) / (int32_t)elapsed;
+      g_trend += (slope - g_trend) / (1 << BATTERY_TREND_SHIFT);
+      g_lastVoltage = g_voltage;
+      g_lastTime = now;
+      }
+    }
+  // Wait for the voltage to drop another step at the current rate
+  g_interval = BATTERY_INTERVAL_MAX;
+  if(g_trend<0) {
+    uint32_t interval = ((uint32_t)BATTERY_STEP_MV * 3600 << BATTERY_FRACTION) / (uint32_t)(-g_trend);
+    if(interval<g_interval)
+      g_interval = (interval<BATTERY_INTERVAL_MIN) ? BATTERY_INTERVAL_MIN : interval;
+    }
+  // Apply the power saving measures for the level. Shut down on the second
+  // reading below the cutoff (the first moves to the critical level).
+  int32_t millivolts = g_voltage >> BATTERY_FRACTION;
+  if((millivolts<=BATTERY_CUTOFF_MV)&&(g_level==BATTERY_CRITICAL))
+    shutdown();
+  BATTERY_LEVEL level = batteryClassify(millivolts);
+  if(level!=g_level) {
+    g_level = level;
+    netPower(g_power[level]);
+    }
+  if(level!=BATTERY_NORMAL)
+    g_interval = BATTERY_INTERVAL_MIN;
+  }
+
+/** Battery monitoring
+ *
+ * Called from the main loop. Enables the battery input when a sample is due
+ * and takes the reading once the converter has had time to fill the filter.
+ */
+void taskBattery() {
+  if(!g_sampling) {
+    if(!timeExpired(g_sampleTime, g_interval, SECOND))
+      return;
+    if(!pinConfig(PIN_BATTERY, ANALOG))
+      return;
+    g_sampling = true;
+    g_sampleTime = getTicks();
+    return;
+    }
+  if(!timeExpired(g_sampleTime, BATTERY_SETTLE, MILLISECOND))
+    return;
+  uint16_t sample = pinSample(PIN_BATTERY);
+  if((sample==0)&&!timeExpired(g_sampleTime, BATTERY_TIMEOUT, MILLISECOND))
+    return;
+  pinConfig(PIN_BATTERY, DISABLED);
+  g_sampling = false;
+  g_sampleTime = getTicks();
+  if(sample!=0)
+    batteryUpdate(sample);
+  }
+
+/** Stretch a sleep period to save power
+ *
+ * @param seconds the requested sleep period.
+ *
+ * @return the sleep period to use (doubled for each level below normal but
+ *         no longer than BATTERY_STRETCH_MAX).
+ */
+uint32_t batteryStretch(uint32_t seconds) {
+  if(seconds>=BATTERY_STRETCH_MAX)
+    return seconds;
+  seconds <<= g_level;
+  return (seconds>BATTERY_STRETCH_MAX) ? BATTERY_STRETCH_MAX : seconds;
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Get the battery voltage
+ *
+ * @return the filtered battery voltage in millivolts or 0 if it has not
+ *         been measured yet.
+ */
+uint16_t batteryVoltage() {
+  return g_valid ? (uint16_t)(g_voltage >> BATTERY_FRACTION) : 0;
+  }
+
+/** Get the battery level
+ *
+ * @return the current battery level.
+ */
+BATTERY_LEVEL batteryLevel() {
+  return g_level;
+  }
+
+/** Get the rate the battery voltage is changing
+ *
+ * @return the rate of change in millivolts per hour (negative while the
+ *         battery is discharging).
+ */
+int32_t batteryTrend() {
+  return g_trend / (1 << BATTERY_FRACTION);
+  }
+
+/** Estimate the remaining run time
+ *
+ * @return the estimated time until the battery reaches the cutoff voltage in
+ *         minutes or BATTERY_RUNTIME_UNKNOWN if the voltage is not falling.
+ */
+uint32_t batteryRuntime() {
+  int32_t remaining = g_voltage - (BATTERY_CUTOFF_MV << BATTERY_FRACTION);
+  if(!g_valid||(g_trend>=0))
+    return BATTERY_RUNTIME_UNKNOWN;
+  if(remaining<=0)
+    return 0;
+  return (uint32_t)(((uint64_t)remaining * 60) / (uint32_t)(-g_trend));
+  }
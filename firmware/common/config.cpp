@@ -0,0 +1,352 @@
+/*--------------------------------------------------------------------------*
+* Configuration storage
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Stores small configuration values in the flash region reserved by the
+* linker script. The region is split into two banks. Values are appended to
+* the active bank as CRC16 protected records so changing a value never
+* erases flash, when the bank is full the current values are copied to the
+* other bank (which is erased first) and it becomes the active bank. Each
+* bank starts with a header holding a sequence number, the header of the
+* new bank is written last so an interrupted compaction leaves the old bank
+* in use.
+*
+* The location of the latest record for each key is kept in a RAM index
+* built at startup so reads go straight to the value in flash.
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+// Marks a bank header ("CFG1")
+#define CONFIG_MAGIC     0x31474643
+
+// Records are padded to a whole number of flash blocks
+#define CONFIG_ALIGN(n)  (((n) + FLASH_BLOCK_SIZE - 1) & ~(FLASH_BLOCK_SIZE - 1))
+
+// Size of the record header and CRC
+#define CONFIG_OVERHEAD  (4 + 2)
+
+// Largest record
+#define CONFIG_RECORD_MAX CONFIG_ALIGN(CONFIG_VALUE_MAX + CONFIG_OVERHEAD)
+
+// Reserved flash region (defined by the linker script)
+extern "C" uint8_t CONFIG_START;
+
+// Size of each bank
+#define CONFIG_BANK_SIZE (CONFIG_SIZE / 2)
+
+/** Bank header
+ */
+typedef struct _CONFIG_HEADER {
+  uint32_t m_magic;    //!< CONFIG_MAGIC
+  uint32_t m_sequence; //!< Incremented each time the banks are swapped
+  uint16_t m_crc;      //!< CRC16 of the fields above
+  } CONFIG_HEADER;
+
+// Number of header bytes covered by the CRC
+#define CONFIG_HEADER_CRC 8
+
+// Offset of the first record in a bank
+#define CONFIG_FIRST     CONFIG_ALIGN(sizeof(CONFIG_HEADER))
+
+// A bank must hold the largest value for every key plus the record being
+// written, otherwise compaction could not make room for it
+static_assert((CONFIG_FIRST + ((CONFIG_KEYS + 1) * CONFIG_RECORD_MAX))<=CONFIG_BANK_SIZE,
+  "CONFIG_KEYS and CONFIG_VALUE_MAX are too large for the configuration banks");
+static_assert((CONFIG_BANK_SIZE % FLASH_PAGE_SIZE)==0,
+  "Configuration banks must be a whole number of flash pages");
+
+/** Value record
+ *
+ * The value is followed by the CRC16 of the header and value.
+ */
+typedef struct _CONFIG_RECORD {
+  uint8_t m_key;                                   //!< Key of the value
+  uint8_t m_check;                                 //!< Complement of the key
+  uint8_t m_length;                                //!< Length of the value (0 if deleted)
+  uint8_t m_reserved;                              //!< Padding (0xff)
+  uint8_t m_value[CONFIG_RECORD_MAX - 4];          //!< Value, CRC and padding
+  } CONFIG_RECORD;
+
+// Store state
+static uint8_t  *g_bank = NULL;        // Active bank
+static uint32_t  g_sequence;           // Sequence number of the active bank
+static uint32_t  g_free;               // Offset of the next record
+static uint16_t  g_index[CONFIG_KEYS]; // Offset of the record for each key (0 if none)
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Get the size of a record
+ *
+ * @param length the length of the value.
+ *
+ * @return the number of bytes the record occupies in flash.
+ */
+static uint32_t configSize(int length) {
+  return CONFIG_ALIGN(length + CONFIG_OVERHEAD);
+  }
+
+/** Get a bank
+ *
+ * @param bank the bank number (0 or 1).
+ *
+ * @return a pointer to the start of the bank.
+ */
+static uint8_t *configBank(int bank) {
+  return &CONFIG_START + (bank * CONFIG_BANK_SIZE);
+  }
+
+/** Check a bank header
+ *
+ * @param pBank the bank to check.
+ *
+ * @return true if the bank has a valid header.
+ */
+static bool configValid(const uint8_t *pBank) {
+  const CONFIG_HEADER *pHeader = (const CONFIG_HEADER *)pBank;
+  return (pHeader->m_magic==CONFIG_MAGIC)&&
+    (pHeader->m_crc==crcData(crcInit(), pBank, CONFIG_HEADER_CRC));
+  }
+
+/** Write data to the flash
+ *
+ * @param pDest the destination (aligned to FLASH_BLOCK_SIZE).
+ * @param pData the data to write (a multiple of FLASH_BLOCK_SIZE bytes).
+ * @param length the number of bytes to write.
+ *
+ * @return true if all the data was written.
+ */
+static bool configProgram(uint8_t *pDest, const uint32_t *pData, uint32_t length) {
+  for(uint32_t offset=0; offset<length; offset+=FLASH_BLOCK_SIZE) {
+    if(!flashWrite(pDest + offset, pData + (offset / 4)))
+      return false;
+    }
+  return true;
+  }
+
+/** Write a bank header
+ *
+ * @param pBank the bank to write the header to.
+ * @param sequence the sequence number for the header.
+ *
+ * @return true if the header was written.
+ */
+static bool configHeader(uint8_t *pBank, uint32_t sequence) {
+  uint32_t block[CONFIG_FIRST / 4];
+  memset(block, 0xff, sizeof(block));
+  CONFIG_HEADER *pHeader = (CONFIG_HEADER *)block;
+  pHeader->m_magic = CONFIG_MAGIC;
+  pHeader->m_sequence = sequence;
+  pHeader->m_crc = crcData(crcInit(), (const uint8_t *)block, CONFIG_HEADER_CRC);
+  return configProgram(pBank, block, CONFIG_FIRST);
+  }
+
+/** Erase a bank
+ *
+ * @param pBank the bank to erase.
+ *
+ * @return true if all the pages in the bank were erased.
+ */
+static bool configErase(uint8_t *pBank) {
+  for(uint32_t offset=0; offset<CONFIG_BANK_SIZE; offset+=FLASH_PAGE_SIZE) {
+    if(!flashErase(pBank + offset))
+      return false;
+    }
+  return true;
+  }
+
+/** Build the index for the active bank
+ *
+ * Records are read until one with an invalid header (erased flash or an
+ * interrupted write) is found. Records that fail the CRC check are skipped.
+ */
+static void configScan() {
+  memset(g_index, 0, sizeof(g_index));
+  g_free = CONFIG_FIRST;
+  while((g_free + configSize(0))<=CONFIG_BANK_SIZE) {
+    const CONFIG_RECORD *pRecord = (const CONFIG_RECORD *)(g_bank + g_free);
+    if((pRecord->m_check!=(uint8_t)~pRecord->m_key)||(pRecord->m_length>CONFIG_VALUE_MAX))
+      break;
+    uint32_t size = configSize(pRecord->m_length);
+    if((g_free + size)>CONFIG_BANK_SIZE)
+      break;
+    int length = 4 + pRecord->m_length;
+    uint16_t crc = pRecord->m_value[pRecord->m_length] | (pRecord->m_value[pRecord->m_length + 1] << 8);
+    if((pRecord->m_key<CONFIG_KEYS)&&(crc==crcData(crcInit(), (const uint8_t *)pRecord, length)))
+      g_index[pRecord->m_key] = (pRecord->m_length==0) ? 0 : g_free;
+    g_free += size;
+    }
+  }
+
+/** Get the space used by the current values
+ *
+ * @return the number of bytes (including the bank header) the values would
+ *         occupy after compaction.
+ */
+static uint32_t configLive() {
+  uint32_t used = CONFIG_FIRST;
+  for(int key=0; key<CONFIG_KEYS; key++) {
+    if(g_index[key]!=0)
+      used += configSize(((const CONFIG_RECORD *)(g_bank + g_index[key]))->m_length);
+    }
+  return used;
+  }
+
+/** Copy the current values to the other bank
+ *
+ * @return true if the other bank is now active.
+ */
+static bool configCompact() {
+  uint8_t *pBank = (g_bank==configBank(0)) ? configBank(1) : configBank(0);
+  if(configLive()>CONFIG_BANK_SIZE)
+    return false;
+  if(!configErase(pBank))
+    return false;
+  uint16_t index[CONFIG_KEYS];
+  uint32_t record[CONFIG_RECORD_MAX / 4];
+  uint32_t offset = CONFIG_FIRST;
+  for(int key=0; key<CONFIG_KEYS; key++) {
+    index[key] = 0;
+    if(g_index[key]==0)
+      continue;
+    const CONFIG_RECORD *pRecord = (const CONFIG_RECORD *)(g_bank + g_index[key]);
+    uint32_t size = configSize(pRecord->m_length);
+    if((offset + size)>CONFIG_BANK_SIZE)
+      return false;
+    memcpy(record, pRecord, size);
+    if(!configProgram(pBank + offset, record, size))
+      return false;
+    index[key] = offset;
+    offset += size;
+    }
+  // Switch banks once everything has been copied
+  if(!configHeader(pBank, g_sequence + 1))
+    return false;
+  g_bank = pBank;
+  g_sequence++;
+  g_free = offset;
+  memcpy(g_index, index, sizeof(g_index));
+  return true;
+  }
+
+/** Find the active bank and build the index
+ *
+ * Runs at startup so applications can read their configuration from their
+ * own constructors.
+ */
+static void configInit() STARTUP(STARTUP_PLATFORM);
+static void configInit() {
+  uint8_t *pBank0 = configBank(0), *pBank1 = configBank(1);
+  bool valid0 = configValid(pBank0), valid1 = configValid(pBank1);
+  if(valid0&&valid1) {
+    uint32_t sequence0 = ((const CONFIG_HEADER *)pBank0)->m_sequence;
+    uint32_t sequence1 = ((const CONFIG_HEADER *)pBank1)->m_sequence;
+    g_bank = ((int32_t)(sequence1 - sequence0)>0) ? pBank1 : pBank0;
+    }
+  else if(valid0||valid1)
+    g_bank = valid0 ? pBank0 : pBank1;
+  else if(configErase(pBank0)&&configHeader(pBank0, 1))
+    g_bank = pBank0;
+  else
+    return;
+  g_sequence = ((const CONFIG_HEADER *)g_bank)->m_sequence;
+  configScan();
+  }
+
+/** Append a record to the active bank
+ *
+ * @param key the key of the value.
+ * @param pValue the value to store (may be NULL if length is 0).
+ * @param length the length of the value (0 to delete it).
+ *
+ * @return true if the record was written.
+ */
+static bool configAppend(uint8_t key, const void *pValue, int length) {
+  if(g_bank==NULL)
+    return false;
+  uint32_t size = configSize(length);
+  if((g_free + size)>CONFIG_BANK_SIZE) {
+    // Don't erase anything unless compaction will make enough room
+    if((configLive() + size)>CONFIG_BANK_SIZE)
+      return false;
+    if(!configCompact())
+      return false;
+    }
+  uint32_t buffer[CONFIG_RECORD_MAX / 4];
+  memset(buffer, 0xff, sizeof(buffer));
+  CONFIG_RECORD *pRecord = (CONFIG_RECORD *)buffer;
+  pRecord->m_key = key;
+  pRecord->m_check = ~key;
+  pRecord->m_length = length;
+  if(length>0)
+    memcpy(pRecord->m_value, pValue, length);
+  uint16_t crc = crcData(crcInit(), (const uint8_t *)pRecord, 4 + length);
+  pRecord->m_value[length] = crc & 0xff;
+  pRecord->m_value[length + 1] = crc >> 8;
+  uint32_t offset = g_free;
+  // The space is used even if the write fails
+  g_free += size;
+  if(!configProgram(g_bank + offset, buffer, size))
+    return false;
+  g_index[key] = (length==0) ? 0 : offset;
+  return true;
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Read a configuration value
+ *
+ * @param key the key of the value (less than CONFIG_KEYS).
+ * @param pValue the buffer to receive the value.
+ * @param length the size of the buffer.
+ *
+ * @return the length of the stored value (which may be more than was copied)
+ *         or -1 if there is no value for the key.
+ */
+int configRead(uint8_t key, void *pValue, int length) {
+  if((key>=CONFIG_KEYS)||(g_index[key]==0))
+    return -1;
+  const CONFIG_RECORD *pRecord = (const CONFIG_RECORD *)(g_bank + g_index[key]);
+  memcpy(pValue, pRecord->m_value, (length<pRecord->m_length) ? length : pRecord->m_length);
+  return pRecord->m_length;
+  }
+
+/** Store a configuration value
+ *
+ * Writing the value that is already stored does not use any flash.
+ *
+ * @param key the key of the value (less than CONFIG_KEYS).
+ * @param pValue the value to store.
+ * @param length the length of the value (1 to CONFIG_VALUE_MAX bytes).
+ *
+ * @return true if the value was stored.
+ */
+bool configWrite(uint8_t key, const void *pValue, int length) {
+  if((key>=CONFIG_KEYS)||(length<1)||(length>CONFIG_VALUE_MAX))
+    return false;
+  if(g_index[key]!=0) {
+    const CONFIG_RECORD *pRecord = (const CONFIG_RECORD *)(g_bank + g_index[key]);
+    if((pRecord->m_length==length)&&(memcmp(pRecord->m_value, pValue, length)==0))
+      return true;
+    }
+  return configAppend(key, pValue, length);
+  }
+
+/** Remove a configuration value
+ *
+ * @param key the key of the value to remove.
+ *
+ * @return true if there is no longer a value for the key.
+ */
+bool configDelete(uint8_t key) {
+  if(key>=CONFIG_KEYS)
+    return false;
+  if(g_index[key]==0)
+    return true;
+  return configAppend(key, NULL, 0);
+  }
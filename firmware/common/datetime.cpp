@@ -4,9 +4,55 @@
 * 30-Oct-2015 ShaneG
 *
 * Implements the platform independant date and time manipulation functions.
+*
+* 19-Oct-2026
+*
+* Implemented the conversions without loops, tables or division (the
+* Cortex-M0 has no divide instruction). Each division by a constant is
+* replaced by a multiply and shift, the constants have been verified over
+* the full range of inputs they are used with. Days are counted from
+* 1/3/1968 so leap days fall at the end of each 4 year cycle, the only
+* century in range (2100) is adjusted for separately.
 *--------------------------------------------------------------------------*/
 #include <sensnode.h>
 
+// Range of timestamps (1/1/1970 to 7/2/2106 06:28:15)
+#define YEAR_FIRST       1970
+#define YEAR_LAST        2106
+#define DAYS_LAST        49710 // Days from 1/1/1970 to 7/2/2106
+#define SECONDS_LAST     23295 // Seconds into 7/2/2106
+
+// Day numbers (from 1/3/1968)
+#define DAYS_TO_EPOCH    671   // 1/1/1970
+#define DAYS_TO_2100     48212 // 1/3/2100 (no 29/2/2100)
+
+// Days in a 4 year cycle
+#define DAYS_PER_CYCLE   1461
+
+/** Get the upper 32 bits of a 32 x 32 bit multiply
+ *
+ * The Cortex-M0 only provides a 32 bit result so the multiplication is
+ * done in 16 bit parts.
+ */
+static inline uint32_t mulhi(uint32_t a, uint32_t b) {
+  uint32_t al = a & 0xffff, ah = a >> 16;
+  uint32_t bl = b & 0xffff, bh = b >> 16;
+  uint32_t t = (ah * bl) + ((al * bl) >> 16);
+  uint32_t w = (t & 0xffff) + (al * bh);
+  return (ah * bh) + (t >> 16) + (w >> 16);
+  }
+
+/** Determine if a year is a leap year
+ */
+static bool isLeapYear(uint16_t year) {
+  if(year&0x03)
+    return false;
+  // Divisible by 100 if year / 4 is divisible by 25
+  uint32_t quarter = year >> 2;
+  uint32_t century = (quarter * 5243) >> 17; // quarter / 25
+  return ((century * 25)!=quarter)||!(century&0x03);
+  }
+
 /** Determine if the date and time are valid
  *
  * Helper function to validate the values in a DATETIME structure.
@@ -16,8 +62,14 @@
  * @return true if the values are valid, false otherwise.
  */
 bool isDateTimeValid(DATETIME *pDateTime) {
-  // TODO: Implement this
-  return false;
+  if((pDateTime==NULL)||(pDateTime->m_month<1)||(pDateTime->m_month>12)||(pDateTime->m_day<1))
+    return false;
+  uint8_t month = pDateTime->m_month, days;
+  if(month==2)
+    days = isLeapYear(pDateTime->m_year) ? 29 : 28;
+  else // 31 days in odd months up to July, even months after that
+    days = 30 + ((month ^ (month >> 3)) & 1);
+  return (pDateTime->m_day<=days)&&(pDateTime->m_hour<24)&&(pDateTime->m_minute<60)&&(pDateTime->m_second<60);
   }
 
 /** Convert a date time structure to a timestamp
@@ -33,8 +85,26 @@ bool isDateTimeValid(DATETIME *pDateTime) {
  *         epoch or contains invalid information the return value will be 0.
  */
 uint32_t toTimestamp(DATETIME *pDateTime) {
-  // TODO: Implement this
-  return 0;
+  if(!isDateTimeValid(pDateTime)||(pDateTime->m_year<YEAR_FIRST)||(pDateTime->m_year>YEAR_LAST))
+    return 0;
+  // Years start in March so the leap day is the last day of the year
+  uint32_t year = pDateTime->m_year - 1968, month = pDateTime->m_month;
+  if(month<=2) {
+    year--;
+    month += 9;
+    }
+  else
+    month -= 3;
+  uint32_t days = ((year * DAYS_PER_CYCLE) >> 2)  // Start of the year
+    + (((month * 1959) + 25) >> 6)                 // (153 * month + 2) / 5
+    + pDateTime->m_day - 1;
+  if(days>DAYS_TO_2100)
+    days--;
+  days -= DAYS_TO_EPOCH;
+  uint32_t seconds = (pDateTime->m_hour * 3600) + (pDateTime->m_minute * 60) + pDateTime->m_second;
+  if((days>DAYS_LAST)||((days==DAYS_LAST)&&(seconds>SECONDS_LAST)))
+    return 0;
+  return (days * 86400) + seconds;
   }
 
 /** Convert a timestamp to a date time structure
@@ -47,6 +117,31 @@ uint32_t toTimestamp(DATETIME *pDateTime) {
  * @param timestamp the timestamp value to convert.
  */
 void fromTimestamp(DATETIME *pDateTime, uint32_t timestamp) {
-  // TODO: Implement this
+  // Split into days and seconds (86400 = 128 * 675)
+  uint32_t days = mulhi(timestamp >> 7, 0x308b915) >> 3;
+  uint32_t seconds = timestamp - (days * 86400);
+  uint32_t hour = (seconds * 37283) >> 27;  // seconds / 3600
+  seconds -= hour * 3600;
+  uint32_t minute = (seconds * 2185) >> 17; // seconds / 60
+  pDateTime->m_hour = hour;
+  pDateTime->m_minute = minute;
+  pDateTime->m_second = seconds - (minute * 60);
+  // Count from 1/3/1968 and pretend 29/2/2100 exists
+  days += DAYS_TO_EPOCH;
+  days += (days>=DAYS_TO_2100);
+  uint32_t cycle = (days * 22967) >> 25;    // days / 1461
+  days -= cycle * DAYS_PER_CYCLE;
+  uint32_t year = ((days * 359) + 128) >> 17; // (4 * days + 3) / 1461
+  days -= (year * DAYS_PER_CYCLE) >> 2;
+  uint32_t month = ((days * 1071) + 410) >> 15; // (5 * days + 2) / 153
+  pDateTime->m_day = days - (((month * 1959) + 25) >> 6) + 1;
+  year += 1968 + (cycle << 2);
+  if(month>=10) {
+    year++;
+    month -= 9;
+    }
+  else
+    month += 3;
+  pDateTime->m_month = month;
+  pDateTime->m_year = year;
   }
-
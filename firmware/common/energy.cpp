@@ -0,0 +1,233 @@
+/*--------------------------------------------------------------------------*
+* Energy accounting
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Records the number of ticks spent in each power state. The processor state
+* is switched by the main loop, 'delay()' and 'sleep()', the peripheral
+* states are set by the radio driver and the analog sampling code. Charge is
+* estimated from the tick counts and the supply current for each state.
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+// Typical supply currents (microamps), override on the command line
+#ifndef ENERGY_CURRENT_RUN
+#  define ENERGY_CURRENT_RUN    6000  // Core running at 32MHz
+#endif
+#ifndef ENERGY_CURRENT_SLEEP
+#  define ENERGY_CURRENT_SLEEP  300   // Deep sleep with the RTC running
+#endif
+#ifndef ENERGY_CURRENT_TX
+#  define ENERGY_CURRENT_TX     11300 // NRF24L01+ at 0dBm
+#endif
+#ifndef ENERGY_CURRENT_RX
+#  define ENERGY_CURRENT_RX     13100 // NRF24L01+ at 1Mbps
+#endif
+#ifndef ENERGY_CURRENT_ADC
+#  define ENERGY_CURRENT_ADC    1000  // VADC converting continuously
+#endif
+
+// Supply voltage used for the energy estimate (millivolts)
+#ifndef ENERGY_SUPPLY_MV
+#  define ENERGY_SUPPLY_MV      3000
+#endif
+
+// Ticks in an hour
+#define TICKS_PER_HOUR          (3600ULL * TICKS_PER_SECOND)
+
+// Supply current for each state
+static uint32_t g_current[ENERGY_STATES] = {
+  ENERGY_CURRENT_RUN,   // ENERGY_LOOP
+  ENERGY_CURRENT_RUN,   // ENERGY_TASKS
+  ENERGY_CURRENT_RUN,   // ENERGY_DELAY
+  ENERGY_CURRENT_SLEEP, // ENERGY_SLEEP
+  ENERGY_CURRENT_TX,    // ENERGY_RADIO_TX
+  ENERGY_CURRENT_RX,    // ENERGY_RADIO_RX
+  ENERGY_CURRENT_ADC,   // ENERGY_ADC
+  };
+
+// Names used in the report
+static const char *g_names[ENERGY_STATES] = {
+  "loop", "tasks", "delay", "sleep", "tx", "rx", "adc"
+  };
+
+// Accounting state
+static uint64_t     g_ticks[ENERGY_STATES]; // Ticks spent in each state
+static ENERGY_STATE g_state = ENERGY_LOOP;  // Current processor state
+static uint32_t     g_active = 0;           // Active peripherals (bit per state)
+static uint32_t     g_last = 0;             // Tick count of the last update
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Add the ticks since the last update to the current states
+ */
+static void energyUpdate() {
+  uint32_t now = getTicks();
+  uint32_t elapsed = now - g_last;
+  g_last = now;
+  g_ticks[g_state] += elapsed;
+  for(uint32_t active = g_active, state = ENERGY_RADIO_TX; active!=0; state++) {
+    if(active&(1 << state)) {
+      g_ticks[state] += elapsed;
+      active &= ~(1 << state);
+      }
+    }
+  }
+
+/** Get the charge used in a state
+ *
+ * @param state the state to calculate the charge for.
+ *
+ * @return the charge in microamp ticks.
+ */
+static uint64_t energyUsed(int state) {
+  return g_ticks[state] * g_current[state];
+  }
+
+/** Get the total charge used in all states
+ *
+ * @return the charge in microamp ticks.
+ */
+static uint64_t energyTotal() {
+  energyUpdate();
+  uint64_t total = 0;
+  for(int state=0; state<ENERGY_STATES; state++)
+    total += energyUsed(state);
+  return total;
+  }
+
+/** Get the total time accounted for
+ *
+ * @return the number of ticks since the last reset.
+ */
+static uint64_t energyTicks() {
+  return g_ticks[ENERGY_LOOP] + g_ticks[ENERGY_TASKS] + g_ticks[ENERGY_DELAY] + g_ticks[ENERGY_SLEEP];
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Change the processor power state
+ *
+ * Used by the library and drivers, must not be called from an interrupt
+ * handler.
+ *
+ * @param state the new processor state (ENERGY_LOOP to ENERGY_SLEEP).
+ *
+ * @return the previous processor state so it can be restored.
+ */
+ENERGY_STATE energySwitch(ENERGY_STATE state) {
+  ENERGY_STATE previous = g_state;
+  if((state!=previous)&&(state<ENERGY_RADIO_TX)) {
+    energyUpdate();
+    g_state = state;
+    }
+  return previous;
+  }
+
+/** Mark a peripheral as active or inactive
+ *
+ * Used by the library and drivers, must not be called from an interrupt
+ * handler.
+ *
+ * @param state the peripheral state (ENERGY_RADIO_TX to ENERGY_ADC).
+ * @param active true if the peripheral is now active.
+ */
+void energyActive(ENERGY_STATE state, bool active) {
+  if((state<ENERGY_RADIO_TX)||(state>=ENERGY_STATES)||(active==((g_active&(1 << state))!=0)))
+    return;
+  energyUpdate();
+  if(active)
+    g_active |= (1 << state);
+  else
+    g_active &= ~(1 << state);
+  }
+
+/** Set the supply current for a state
+ *
+ * @param state the state to set the current for.
+ * @param microamps the supply current in that state.
+ */
+void energyCurrent(ENERGY_STATE state, uint32_t microamps) {
+  if(state>=ENERGY_STATES)
+    return;
+  energyUpdate();
+  g_current[state] = microamps;
+  }
+
+/** Get the time spent in a state
+ *
+ * @param state the state to query.
+ *
+ * @return the time spent in the state since the last 'energyReset()' in
+ *         milliseconds.
+ */
+uint32_t energyTime(ENERGY_STATE state) {
+  if(state>=ENERGY_STATES)
+    return 0;
+  energyUpdate();
+  return (uint32_t)(g_ticks[state] / (TICKS_PER_SECOND / 1000));
+  }
+
+/** Get the estimated charge used
+ *
+ * @return the charge used since the last 'energyReset()' in microamp hours.
+ */
+uint32_t energyCharge() {
+  return (uint32_t)(energyTotal() / TICKS_PER_HOUR);
+  }
+
+/** Get the estimated average supply current
+ *
+ * @return the average current since the last 'energyReset()' in microamps.
+ */
+uint32_t energyAverage() {
+  uint64_t total = energyTotal(), ticks = energyTicks();
+  return (ticks==0) ? 0 : (uint32_t)(total / ticks);
+  }
+
+/** Clear the accumulated times
+ */
+void energyReset() {
+  energyUpdate();
+  for(int state=0; state<ENERGY_STATES; state++)
+    g_ticks[state] = 0;
+  }
+
+/** Write an energy report to the serial port
+ *
+ * Lists the time and charge for each state followed by the totals and an
+ * energy estimate based on the ENERGY_SUPPLY_MV supply voltage.
+ */
+void energyPrint() {
+  uint64_t total = energyTotal(), ticks = energyTicks();
+  for(int state=0; state<ENERGY_STATES; state++) {
+    serialFormat("ENERGY: #s #Ums #UuAh\n",
+      g_names[state],
+      (unsigned long)(g_ticks[state] / (TICKS_PER_SECOND / 1000)),
+      (unsigned long)(energyUsed(state) / TICKS_PER_HOUR)
+      );
+    }
+  uint32_t charge = (uint32_t)(total / TICKS_PER_HOUR);
+  serialFormat("ENERGY: total #Us #UuAh #UuWh average #UuA\n",
+    (unsigned long)(ticks / TICKS_PER_SECOND),
+    (unsigned long)charge,
+    (unsigned long)(((uint64_t)charge * ENERGY_SUPPLY_MV) / 1000),
+    (unsigned long)((ticks==0) ? 0 : (total / ticks))
+    );
+  }
+
+/** Send the average current to the base station
+ *
+ * @param channel the application defined channel number for the reading.
+ *
+ * @return true if the reading was queued.
+ */
+bool energySend(uint8_t channel) {
+  uint32_t average = energyAverage();
+  return netReading(channel, (average>32767) ? 32767 : (int16_t)average);
+  }
@@ -5,22 +5,24 @@
 *
 * Main program loop. Invokes the application setup and loop functions as
 * well as processing power management and network activity.
+*
+* 19-Oct-2026
+*
+* The main loop and 'delay()' switch the energy accounting state, the
+* background tasks run while waiting in 'delay()' are counted as delay time
+* rather than task time. Each part of the main loop is timed when built with
+* PROFILE defined. The indicator is now driven by the target (see
+* 'indicate()'). Battery monitoring is enabled. A warm restart (see
+* 'restart()') skips the start up indication, the pins, hardware and
+* 'setup()' are always set up again as the reset clears them. Static
+* constructors are now run by 'init()', the power pin is latched by the
+* first of them.
 *--------------------------------------------------------------------------*/
 #include <sensnode.h>
 #include <platform.h>
 
-// Battery level cutoff
-static uint16_t g_battery = 0;
-
-// Indicator pattern
-static uint16_t g_pattern = 0;
-static uint8_t  g_patternIdx = 0;
-static bool     g_patternRepeat = false;
-static uint32_t g_patternTimer = 0;
-
-// Static initialisers (constructors, etc)
-extern "C" void (**__init_array_start)();
-extern "C" void (**__init_array_end)();
+// Background tasks added by drivers
+static FN_TASK g_tasks[MAX_TASKS];
 
 //---------------------------------------------------------------------------
 // Internal implementation
@@ -34,38 +36,60 @@ extern "C" void (**__init_array_end)();
  * @param userTask if true, run the user application loop as well.
  */
 static void mainLoop(bool userTask) {
+  // Passes made from delay() stay in ENERGY_DELAY
+  ENERGY_STATE state = userTask ? energySwitch(ENERGY_TASKS) : ENERGY_DELAY;
+  // Deliver pin change notifications
+  PROFILE_CALL(PROFILE_PINEVENTS, taskPinEvents());
+  // Deliver completed I2C transactions
+  PROFILE_CALL(PROFILE_I2C, taskI2C());
   // Power management checking
-//  taskBattery();
-  // Indicator display
-//  taskIndicator();
-  // TODO: Network processing
+  PROFILE_CALL(PROFILE_BATTERY, taskBattery());
+  // Network processing
+  PROFILE_CALL(PROFILE_NETWORK, taskNetwork());
   // Application loop
+  if(userTask) {
+    energySwitch(ENERGY_LOOP);
+    PROFILE_CALL(PROFILE_LOOP, loop());
+    energySwitch(ENERGY_TASKS);
+    }
+  // Driver tasks
+  for(int i=0; (i<MAX_TASKS)&&(g_tasks[i]!=NULL); i++)
+    PROFILE_CALL(PROFILE_TASK + i, (*g_tasks[i])());
   if(userTask)
-    loop();
+    energySwitch(state);
   }
 
-/** Program entry point
+/** Latch the power on
+ *
+ * Runs before any other start up code so the node stays powered while the
+ * hardware is set up.
  */
-int main() {
-  // First configure and latch our power pin.
+static void powerLatch() STARTUP(STARTUP_POWER);
+static void powerLatch() {
   pinConfig(PIN_LATCH, DIGITAL_OUTPUT, 1);
   pinWrite(PIN_LATCH, true);
-  // Call all the constructors
-  for(void (**p)() = __init_array_start; p < __init_array_end; ++p)
-    (*p)();
+  }
+
+/** Program entry point
+ */
+int main() {
+  bool warm = retainRestore();
   // Set up the rest of the power head pins
   pinConfig(PIN_INDICATOR, DIGITAL_OUTPUT, 0);
   pinWrite(PIN_INDICATOR, false);
   pinConfig(PIN_ACTION, DIGITAL_INPUT, WAKEUP);
-  pinConfig(PIN_BATTERY, ANALOG);
-  // Show we are on (2s indicator LED)
-//  indicate(PATTERN_FULL, false);
-  // TODO: Internal setup
+  // Show we are on (2s indicator LED), not needed after a warm restart
+  if(!warm)
+    indicate(PATTERN_FULL, false);
+  // Internal setup
+  initNetwork();
+  // Report the time from reset (as far as it can be measured)
+  DBG("Boot time #U ticks", (unsigned long)getTicks());
   // Application setup
-  setup();
+  PROFILE_CALL(PROFILE_SETUP, setup());
   // Main loop
   while(true)
-    mainLoop(true);
+    PROFILE_CALL(PROFILE_PASS, mainLoop(true));
   return 0;
   }
 
@@ -73,26 +97,6 @@ int main() {
 // Public API
 //---------------------------------------------------------------------------
 
-/** Set the output indication sequence
- *
- * Every power adapter has an indication LED which is used to provide visual
- * feedback. This function sets an indication pattern to run on the LED. A
- * pattern consists of a sequence of 16 LED states (1 = on, 0 = off) which
- * are stepped through every 125ms giving a total of 2s for each pattern.
- *
- * If a pattern is already running it will be terminated at the current step
- * and the new pattern started instead.
- *
- * @param pattern the 16 bit pattern to start.
- * @param repeat if true the pattern will be repeated until a new pattern is
- *               set.
- */
-void indicate(uint16_t pattern, bool repeat) {
-//  resetIndicator();
-  g_pattern = pattern;
-  g_patternRepeat = repeat;
-  }
-
 /** Power down the device
  *
  * This function will completely power down the device. It is usually only
@@ -118,10 +122,38 @@ void delay(uint32_t duration, TIMEUNIT units) {
   if(inDelay)
     return; // Avoid recursive calls
   inDelay = true;
+  ENERGY_STATE state = energySwitch(ENERGY_DELAY);
   // Run the main loop without the user application for a while
   uint32_t timer = getTicks();
   while(!timeExpired(timer, duration, units))
     mainLoop(false);
+  energySwitch(state);
   inDelay = false;
   }
 
+/** Add a background task
+ *
+ * Background tasks are called at the end of every pass through the main loop
+ * (including the passes made while in 'delay()'). Drivers use them to write
+ * back buffered changes once the application loop has finished. Adding the
+ * same task more than once has no effect.
+ *
+ * @param pfnTask the function to call.
+ *
+ * @return true if the task was added, false if there is no more room.
+ */
+bool addTask(FN_TASK pfnTask) {
+  for(int i=0; i<MAX_TASKS; i++) {
+    if(g_tasks[i]==pfnTask)
+      return true;
+    if(g_tasks[i]==NULL) {
+      g_tasks[i] = pfnTask;
+#ifdef PROFILE
+      profileTag(PROFILE_TASK + i, (uint32_t)(uintptr_t)pfnTask);
+#endif
+      return true;
+      }
+    }
+  return false;
+  }
+
@@ -0,0 +1,166 @@
+/*--------------------------------------------------------------------------*
+* Network time
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Maintains a clock synchronised with the gateway. The clock is derived from
+* the system tick count. Small errors are removed gradually (slewed) and the
+* tick rate is trimmed to match the gateway so the clock stays in step
+* between updates. Large errors (and the first update) step the clock and
+* the RTC directly.
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+// Errors larger than this (in milliseconds) step the clock
+#define NET_STEP_LIMIT      1000
+
+// Slew at most 1ms for every NET_SLEW_RATE milliseconds elapsed
+#define NET_SLEW_RATE       20
+
+// Limit of the rate correction (parts per million)
+#define NET_DRIFT_LIMIT     500
+
+// Minimum time between updates (milliseconds) to estimate the drift
+#define NET_DRIFT_MIN       10000
+
+// Fold the elapsed time into the base before the tick counter can wrap
+#define NET_REBASE_INTERVAL (3600L * TICKS_PER_SECOND)
+
+// Clock state
+static bool     g_synced = false;
+static uint32_t g_baseTicks;   // Tick count at the base time
+static uint64_t g_baseTime;    // Network time (ms since 1/1/1970) at g_baseTicks
+static int32_t  g_slew;        // Correction still to be applied (ms)
+static int32_t  g_drift;       // Rate correction (ppm)
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Convert a number of ticks to milliseconds
+ */
+static uint32_t ticksToMillis(uint32_t ticks) {
+  return (uint32_t)(((uint64_t)ticks * 1000) / TICKS_PER_SECOND);
+  }
+
+/** Determine how much of the pending slew has been applied
+ *
+ * @param elapsed the time since the base tick count (milliseconds).
+ *
+ * @return the correction applied so far (milliseconds).
+ */
+static int32_t slewApplied(uint32_t elapsed) {
+  int32_t limit = elapsed / NET_SLEW_RATE;
+  if(g_slew>limit)
+    return limit;
+  if(g_slew<-limit)
+    return -limit;
+  return g_slew;
+  }
+
+/** Move the base of the clock to a new tick count
+ *
+ * @param ticks the new base tick count.
+ */
+static void netTimeRebase(uint32_t ticks) {
+  uint32_t elapsed = ticksToMillis(ticks - g_baseTicks);
+  g_baseTime = netTimeAt(ticks);
+  g_slew -= slewApplied(elapsed);
+  g_baseTicks = ticks;
+  }
+
+/** Set the RTC from the network clock if they are more than a second apart
+ *
+ * @param seconds the current network time (seconds since 1/1/1970).
+ */
+static void netTimeSetRTC(uint32_t seconds) {
+  DATETIME now;
+  if(getDateTime(&now)) {
+    int32_t error = (int32_t)(seconds - toTimestamp(&now));
+    if((error>=-1)&&(error<=1))
+      return;
+    }
+  fromTimestamp(&now, seconds);
+  setDateTime(&now);
+  }
+
+/** Get the network time at a given tick count
+ *
+ * @param ticks the tick count.
+ *
+ * @return the network time in milliseconds since 1/1/1970 or 0 if the clock
+ *         has not been synchronised.
+ */
+uint64_t netTimeAt(uint32_t ticks) {
+  if(!g_synced)
+    return 0;
+  uint32_t elapsed = ticksToMillis(ticks - g_baseTicks);
+  int64_t time = g_baseTime + elapsed;
+  time += ((int64_t)elapsed * g_drift) / 1000000L;
+  return time + slewApplied(elapsed);
+  }
+
+/** Update the network clock
+ *
+ * Called when a time response is received from the gateway. Errors smaller
+ * than NET_STEP_LIMIT are slewed out and used to trim the clock rate, larger
+ * errors reset the clock.
+ *
+ * @param ticks the tick count when the response was received.
+ * @param time the gateway time (milliseconds since 1/1/1970) at that tick
+ *             count with the transmission delay removed.
+ */
+void netTimeUpdate(uint32_t ticks, uint64_t time) {
+  int64_t error = (int64_t)(time - netTimeAt(ticks));
+  if(!g_synced||(error>NET_STEP_LIMIT)||(error<-NET_STEP_LIMIT)) {
+    g_baseTime = time;
+    g_baseTicks = ticks;
+    g_slew = 0;
+    if(!g_synced)
+      g_drift = 0;
+    g_synced = true;
+    }
+  else {
+    uint32_t elapsed = ticksToMillis(ticks - g_baseTicks);
+    netTimeRebase(ticks);
+    // Anything not explained by the outstanding slew is drift, use half of
+    // it to trim the rate (a full correction tends to overshoot)
+    if(elapsed>=NET_DRIFT_MIN) {
+      int32_t drift = g_drift + (int32_t)(((error - g_slew) * 500000L) / elapsed);
+      if(drift>NET_DRIFT_LIMIT)
+        drift = NET_DRIFT_LIMIT;
+      else if(drift<-NET_DRIFT_LIMIT)
+        drift = -NET_DRIFT_LIMIT;
+      g_drift = drift;
+      }
+    g_slew = (int32_t)error;
+    }
+  netTimeSetRTC((uint32_t)(time / 1000));
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Get the current network time
+ *
+ * The network time is synchronised with the base station shortly after the
+ * node joins the network and kept up to date while it remains connected.
+ *
+ * @param pMillis optional pointer to receive the milliseconds (0 to 999).
+ *
+ * @return the network time in seconds since 1/1/1970 or 0 if the time has
+ *         not been synchronised yet.
+ */
+uint32_t netTime(uint16_t *pMillis) {
+  if(!g_synced)
+    return 0;
+  uint32_t ticks = getTicks();
+  if((ticks - g_baseTicks)>=(uint32_t)NET_REBASE_INTERVAL)
+    netTimeRebase(ticks);
+  uint64_t time = netTimeAt(ticks);
+  if(pMillis!=NULL)
+    *pMillis = time % 1000;
+  return time / 1000;
+  }
@@ -0,0 +1,669 @@
+/*--------------------------------------------------------------------------*
+* Network management
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Implements the node side of the star network protocol (see netframe.h)
+* on top of the NRF24L01 driver. Handles joining the network and batches
+* sensor readings into as few frames as possible. Once connected the node
+* periodically requests the time from the gateway (see nettime.cpp) and,
+* when the gateway assigns a TDMA slot, only transmits during that slot.
+* The assigned address and slot are retained so a warm restart (see
+* 'restart()') reconnects without joining again. Readings that cannot be
+* sent are kept by the sample buffer (see samples.cpp) and uploaded a few
+* frames at a time during the node's slot. Firmware updates offered by the
+* gateway are fetched a frame at a time and applied as they arrive (see
+* update.cpp), the node restarts into the new firmware when it is complete.
+* An offer is only accepted once the running image has been checked, the
+* check is spread over several passes of the main loop.
+*
+* Once the node has a slot and the network time the radio is powered down
+* between slots. It stays on while joining, updating, sending and waiting
+* for a time response, 'sleep()' powers it down and wakes it again shortly
+* before the slot (see 'netSleep()' and 'netWake()').
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+#include <netframe.h>
+#include <delta.h>
+#include <drivers/nrf24l01.h>
+
+#if NRF_PAYLOAD_MAX < NET_FRAME_MAX
+#  error Network frames do not fit in a single NRF24L01 payload
+#endif
+
+// Time between join attempts (milliseconds)
+#define NET_JOIN_INTERVAL 5000
+
+// Consecutive lost frames before the node tries to join again
+#define NET_MAX_LOST      8
+
+// Time between clock updates once synchronised (milliseconds)
+#define NET_SYNC_INTERVAL 60000
+
+// Time between clock updates while not synchronised (milliseconds)
+#define NET_SYNC_RETRY    5000
+
+// Responses taking longer than this (milliseconds) are ignored
+#define NET_SYNC_MAX_RTT  250
+
+// Frames of stored samples sent per loop pass (the radio queue holds 3)
+#define NET_UPLOAD_FRAMES 3
+
+// Time to wait for update data before asking again (milliseconds)
+#define NET_UPDATE_RETRY  500
+
+// Time allowed for the final update status to be sent (milliseconds)
+#define NET_UPDATE_DELAY  1000
+
+// Time the receiver stays on after a time request (milliseconds), covers
+// the response and the update offer that may follow it
+#define NET_LISTEN_TIME   (2 * NET_SYNC_MAX_RTT)
+
+// Longest wait for queued frames to be sent before sleeping (milliseconds)
+#define NET_SLEEP_DRAIN   50
+
+/** Network states
+ */
+typedef enum {
+  NET_DISABLED,  //!< No radio available
+  NET_JOINING,   //!< Waiting for NET_ACCEPT
+  NET_CONNECTED, //!< Joined the network
+  } NET_STATE;
+
+/** Device identifiers
+ *
+ * These are replaced by the flashing tool, the marker values allow it to
+ * find them in the firmware image. They are declared volatile so the
+ * compiler always reads the patched values from flash. The '.ids' section is
+ * placed outside the application image (see xmc1100.ld) so every node runs
+ * the same image and a firmware update keeps the node's own IDs.
+ */
+extern "C" const volatile uint8_t NODEID[NET_UUID_SIZE] __attribute__((used, section(".ids"))) = NET_NODEID_MARKER;
+extern "C" const volatile uint8_t TYPEID[NET_UUID_SIZE] __attribute__((used, section(".ids"))) = NET_TYPEID_MARKER;
+
+// Radio and network state
+static NRF24L01  g_radio;
+static NET_STATE g_state = NET_DISABLED;
+static uint16_t  g_address = NET_ADDRESS_NONE;
+static uint8_t   g_sequence = 0;
+static uint32_t  g_joinTime = 0;
+static uint16_t  g_lost = 0;
+static uint16_t  g_sent = 0;
+static uint32_t  g_syncTime = 0;
+static bool      g_syncValid = false;
+static uint16_t  g_slot = 0;
+static uint16_t  g_slotCount = 0;
+static uint16_t  g_slotTime = 0;
+static uint8_t   g_nodeID[NET_UUID_SIZE];
+static uint8_t   g_power = 3;  // Transmit power level (applied at start up)
+
+// Firmware update state
+static uint32_t  g_updateLength = 0; // Size of the delta (0 if not updating)
+static uint32_t  g_updateOffset = 0; // Offset of the next delta byte
+static uint32_t  g_updateCrc = 0;    // CRC of the new image
+static uint32_t  g_updateTime = 0;   // Time of the last request
+static bool      g_updateDone = false; // New image staged, restarting
+static bool      g_updateCheck = false; // Checking the running image
+
+/** Connection details kept over a warm restart
+ */
+typedef struct _NET_RETAINED {
+  uint16_t m_address;   //!< Assigned address (NET_ADDRESS_NONE if not joined)
+  uint16_t m_slot;      //!< Assigned TDMA slot
+  uint16_t m_slotCount; //!< Number of slots (0 if there is no schedule)
+  uint16_t m_slotTime;  //!< Slot length (milliseconds)
+  } NET_RETAINED;
+
+static NET_RETAINED g_retained RETAINED;
+
+// Readings waiting to be sent
+static NET_READING g_readings[NET_READINGS_MAX];
+static uint8_t     g_readingCount = 0;
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Build and send a frame to the gateway
+ *
+ * @param type the frame type.
+ * @param pPayload the payload data.
+ * @param length the size of the payload (at most NET_PAYLOAD_MAX).
+ *
+ * @return true if the frame was queued for transmission.
+ */
+static bool netSend(NET_FRAME_TYPE type, const void *pPayload, int length) {
+  uint8_t frame[NET_FRAME_MAX];
+  NET_HEADER *pHeader = (NET_HEADER *)frame;
+  pHeader->m_type = type;
+  pHeader->m_sequence = g_sequence++;
+  netPut16(pHeader->m_address, g_address);
+  memcpy(&frame[NET_HEADER_SIZE], pPayload, length);
+  length += NET_HEADER_SIZE;
+  netPut16(&frame[length], crcData(crcInit(), frame, length));
+  return g_radio.send(frame, length + NET_CRC_SIZE);
+  }
+
+/** Change the radio address the node listens on
+ */
+static void netListen() {
+  uint8_t radio[NET_RADIO_ADDRESS];
+  netRadioAddress(radio, g_address, g_nodeID);
+  g_radio.setAddress(radio);
+  }
+
+/** Store a reading for a later upload
+ *
+ * @param channel the channel number.
+ * @param value the value of the reading.
+ *
+ * @return true if the reading was stored.
+ */
+static bool netStore(uint8_t channel, int16_t value) {
+  uint32_t time = netTime();
+  return (time!=0)&&sampleStore(channel, value, time);
+  }
+
+/** Send stored samples
+ *
+ * Stops when the radio queue is full, the rest are sent on later passes.
+ */
+static void netUpload() {
+  uint8_t payload[NET_PAYLOAD_MAX];
+  int length;
+  for(int frames=0; (frames<NET_UPLOAD_FRAMES)&&(sampleCount()>0); frames++) {
+    int count = samplePack(payload, NET_PAYLOAD_MAX, &length);
+    if((count==0)||!netSend(NET_SAMPLES, payload, length))
+      return;
+    sampleDrop(count);
+    }
+  }
+
+/** Report the result of an update to the gateway
+ *
+ * @param result the NET_UPDATE_RESULT to send.
+ */
+static void netUpdateStatus(NET_UPDATE_RESULT result) {
+  uint8_t status = result;
+  netSend(NET_UPDATE_STATUS, &status, sizeof(status));
+  }
+
+/** Ask the gateway for the next part of the delta
+ */
+static void netUpdateRequest() {
+  uint8_t offset[4];
+  g_updateTime = getTicks();
+  netPut32(offset, g_updateOffset);
+  netSend(NET_UPDATE_REQUEST, offset, sizeof(offset));
+  }
+
+/** Abandon the update in progress
+ */
+static void netUpdateCancel() {
+  if(g_updateLength==0)
+    return;
+  updateCancel();
+  g_updateLength = 0;
+  g_updateCheck = false;
+  }
+
+/** Process an update offer from the gateway
+ *
+ * The offer is accepted once the running image has been checked (see
+ * 'netUpdateCheck()'). An offer for the update already in progress (the
+ * acceptance was lost) is accepted again without starting over.
+ *
+ * @param pOffer the offer payload.
+ */
+static void netUpdateOffer(const NET_UPDATE_OFFER_PAYLOAD *pOffer) {
+  uint32_t length = netGet32(pOffer->m_length);
+  uint32_t crc = netGet32(pOffer->m_newCrc);
+  if(g_updateDone)
+    return;
+  if((g_updateLength!=0)&&(g_updateLength==length)&&(g_updateCrc==crc)) {
+    if(!g_updateCheck)
+      netUpdateStatus(NET_UPDATE_ACCEPTED);
+    return;
+    }
+  netUpdateCancel();
+  if((length<=sizeof(DELTA_HEADER))||!updateStart(netGet32(pOffer->m_oldSize), netGet32(pOffer->m_newSize), netGet32(pOffer->m_oldCrc), crc)) {
+    netUpdateStatus(NET_UPDATE_REJECTED);
+    return;
+    }
+  g_updateLength = length;
+  g_updateOffset = 0;
+  g_updateCrc = crc;
+  g_updateCheck = true;
+  }
+
+/** Check the running image a part at a time
+ *
+ * The update is accepted (and the first part of the delta requested) once
+ * the delta is known to apply to the running image.
+ */
+static void netUpdateCheck() {
+  int result = updateCheck();
+  if(result==UPDATE_MORE)
+    return;
+  g_updateCheck = false;
+  if(result==UPDATE_COMPLETE) {
+    netUpdateStatus(NET_UPDATE_ACCEPTED);
+    netUpdateRequest();
+    return;
+    }
+  g_updateLength = 0;
+  netUpdateStatus(NET_UPDATE_REJECTED);
+  }
+
+/** Process update data from the gateway
+ *
+ * Data for any offset other than the one requested is ignored (it is a
+ * duplicate of a response that has already been processed).
+ *
+ * @param pData the frame payload (offset followed by the data).
+ * @param length the size of the payload.
+ */
+static void netUpdateData(const uint8_t *pData, int length) {
+  if((g_updateLength==0)||g_updateCheck||(length<=4)||(netGet32(pData)!=g_updateOffset))
+    return;
+  uint32_t count = length - 4;
+  if(count>(g_updateLength - g_updateOffset))
+    count = g_updateLength - g_updateOffset;
+  int result = updateWrite(&pData[4], count);
+  g_updateOffset += count;
+  if((result==UPDATE_MORE)&&(g_updateOffset<g_updateLength)) {
+    netUpdateRequest();
+    return;
+    }
+  g_updateLength = 0;
+  if(result==UPDATE_COMPLETE) {
+    // Restart once the status has been sent
+    netUpdateStatus(NET_UPDATE_COMPLETE);
+    g_updateDone = true;
+    g_updateTime = getTicks();
+    }
+  else {
+    updateCancel();
+    netUpdateStatus(NET_UPDATE_FAILED);
+    }
+  }
+
+/** Start (or restart) joining the network
+ */
+static void netJoin() {
+  netUpdateCancel();
+  g_state = NET_JOINING;
+  g_address = NET_ADDRESS_NONE;
+  g_retained.m_address = NET_ADDRESS_NONE;
+  // Keep any readings that have not been sent
+  for(int i=0; i<g_readingCount; i++)
+    netStore(g_readings[i].m_channel, (int16_t)netGet16(g_readings[i].m_value));
+  g_readingCount = 0;
+  netListen();
+  // Force an immediate join request
+  g_joinTime = getTicks() - ((NET_JOIN_INTERVAL * TICKS_PER_SECOND) / 1000);
+  }
+
+/** Enter the connected state with the current address
+ */
+static void netConnect() {
+  netListen();
+  g_sent = g_radio.sent();
+  g_lost = g_radio.lost();
+  g_state = NET_CONNECTED;
+  // Synchronise the clock straight away
+  g_syncValid = false;
+  g_syncTime = getTicks() - ((NET_SYNC_RETRY * TICKS_PER_SECOND) / 1000);
+  }
+
+/** Determine if the node may transmit now
+ *
+ * Without a schedule (or before the clock is synchronised) the node may
+ * transmit at any time. Otherwise transmission is limited to the first half
+ * of the assigned slot, leaving the rest to absorb clock errors and
+ * retransmissions.
+ *
+ * @return true if frames can be sent.
+ */
+static bool netInSlot() {
+  if(g_slotCount==0)
+    return true;
+  uint64_t time = netTimeAt(getTicks());
+  if(time==0)
+    return true;
+  uint32_t window = g_slotTime / 2;
+  return netSlotStart(time - window + 1, g_slot, g_slotCount, g_slotTime)<=time;
+  }
+
+/** Determine if the radio needs to be powered up
+ *
+ * Without a schedule (or before the clock is synchronised) the node has to
+ * listen all the time. Otherwise the radio is only needed from just before
+ * the slot until the end of it, while frames are being sent or a response
+ * is expected and while an update is in progress.
+ *
+ * @return true if the radio should be powered up.
+ */
+static bool netRadioNeeded() {
+  if((g_state!=NET_CONNECTED)||(g_slotCount==0))
+    return true;
+  if(g_radio.sending()||(g_updateLength!=0)||g_updateDone)
+    return true;
+  if(!timeExpired(g_syncTime, NET_LISTEN_TIME, MILLISECOND))
+    return true;
+  uint64_t time = netTimeAt(getTicks());
+  if(time==0)
+    return true;
+  return netSlotStart(time - g_slotTime + 1, g_slot, g_slotCount, g_slotTime)<=(time + NET_WAKE_AHEAD);
+  }
+
+/** Power the radio up or down as required
+ */
+static void netRadioPower() {
+  if(netRadioNeeded())
+    g_radio.powerUp();
+  else
+    g_radio.powerDown();
+  }
+
+/** Request the current time from the gateway
+ *
+ * The request carries the current tick count, the gateway echoes it back
+ * so the round trip time can be measured.
+ */
+static void netSync() {
+  uint8_t origin[4];
+  g_syncTime = getTicks();
+  netPut32(origin, g_syncTime);
+  netSend(NET_TIME_REQUEST, origin, sizeof(origin));
+  }
+
+/** Get a time value from a frame
+ *
+ * @return the time in milliseconds since 1/1/1970.
+ */
+static uint64_t netGetTime(const NET_TIME *pTime) {
+  return ((uint64_t)netGet32(pTime->m_seconds) * 1000) + netGet16(pTime->m_millis);
+  }
+
+/** Process a time response from the gateway
+ *
+ * Half of the round trip time (less the time the gateway held the request)
+ * is added to the gateway transmit time to get the time of arrival.
+ *
+ * @param pTime the response payload.
+ * @param ticks the tick count when the response was received.
+ */
+static void netSyncResponse(const NET_TIME_PAYLOAD *pTime, uint32_t ticks) {
+  // Only accept the response to the last request
+  if(netGet32(pTime->m_origin)!=g_syncTime)
+    return;
+  uint32_t elapsed = ticks - g_syncTime;
+  if(elapsed>((NET_SYNC_MAX_RTT * TICKS_PER_SECOND) / 1000))
+    return;
+  uint32_t rtt = (elapsed * 1000) / TICKS_PER_SECOND;
+  uint64_t receive = netGetTime(&pTime->m_receive);
+  uint64_t transmit = netGetTime(&pTime->m_transmit);
+  if((transmit<receive)||((transmit - receive)>rtt))
+    return;
+  netTimeUpdate(ticks, transmit + ((rtt - (uint32_t)(transmit - receive)) / 2));
+  g_syncValid = true;
+  }
+
+/** Process a received frame
+ *
+ * @param pFrame the frame data.
+ * @param length the size of the frame.
+ */
+static void netProcess(const uint8_t *pFrame, int length) {
+  uint32_t ticks = getTicks();
+  if((length<(NET_HEADER_SIZE + NET_CRC_SIZE))||(length>NET_FRAME_MAX))
+    return;
+  length -= NET_CRC_SIZE;
+  if(crcData(crcInit(), pFrame, length)!=netGet16(&pFrame[length]))
+    return;
+  const NET_HEADER *pHeader = (const NET_HEADER *)pFrame;
+  const uint8_t *pPayload = &pFrame[NET_HEADER_SIZE];
+  length -= NET_HEADER_SIZE;
+  switch(pHeader->m_type) {
+    case NET_ACCEPT: {
+        const NET_ACCEPT_PAYLOAD *pAccept = (const NET_ACCEPT_PAYLOAD *)pPayload;
+        if((g_state!=NET_JOINING)||(length<(int)sizeof(NET_ACCEPT_PAYLOAD)))
+          break;
+        if(memcmp(pAccept->m_nodeID, g_nodeID, NET_UUID_SIZE)!=0)
+          break;
+        uint16_t address = netGet16(pAccept->m_address);
+        if((address==NET_ADDRESS_NONE)||(address==NET_ADDRESS_GATEWAY))
+          break;
+        // Switch to the assigned address and report our type
+        g_address = address;
+        g_slot = netGet16(pAccept->m_slot);
+        g_slotCount = netGet16(pAccept->m_slotCount);
+        g_slotTime = netGet16(pAccept->m_slotTime);
+        if((g_slot>=g_slotCount)||(g_slotTime<2))
+          g_slotCount = 0;
+        g_retained.m_address = g_address;
+        g_retained.m_slot = g_slot;
+        g_retained.m_slotCount = g_slotCount;
+        g_retained.m_slotTime = g_slotTime;
+        uint8_t typeID[NET_UUID_SIZE];
+        for(int i=0; i<NET_UUID_SIZE; i++)
+          typeID[i] = TYPEID[i];
+        netConnect();
+        netSend(NET_TYPE, typeID, NET_UUID_SIZE);
+        }
+      break;
+    case NET_TIME_RESPONSE:
+      if((g_state==NET_CONNECTED)&&(length>=(int)sizeof(NET_TIME_PAYLOAD)))
+        netSyncResponse((const NET_TIME_PAYLOAD *)pPayload, ticks);
+      break;
+    case NET_UPDATE_OFFER:
+      if((g_state==NET_CONNECTED)&&(length>=(int)sizeof(NET_UPDATE_OFFER_PAYLOAD)))
+        netUpdateOffer((const NET_UPDATE_OFFER_PAYLOAD *)pPayload);
+      break;
+    case NET_UPDATE_DATA:
+      if(g_state==NET_CONNECTED)
+        netUpdateData(pPayload, length);
+      break;
+    default:
+      break;
+    }
+  }
+
+/** Initialise the network subsystem
+ *
+ * Called once at startup. If the radio module is not present the network
+ * functions are disabled.
+ */
+void initNetwork() {
+  if(!warmBoot())
+    sampleReset();
+  for(int i=0; i<NET_UUID_SIZE; i++)
+    g_nodeID[i] = NODEID[i];
+  if(!g_radio.init())
+    return;
+  g_radio.setPower(g_power);
+  uint8_t radio[NET_RADIO_ADDRESS];
+  netRadioAddress(radio, NET_ADDRESS_GATEWAY, g_nodeID);
+  g_radio.setTarget(radio);
+  if(warmBoot()&&(g_retained.m_address!=NET_ADDRESS_NONE)&&(g_retained.m_address!=NET_ADDRESS_GATEWAY)) {
+    // Carry on with the connection we had before the restart
+    g_address = g_retained.m_address;
+    g_slot = g_retained.m_slot;
+    g_slotCount = g_retained.m_slotCount;
+    g_slotTime = g_retained.m_slotTime;
+    netConnect();
+    }
+  else
+    netJoin();
+  }
+
+/** Process received frames and send anything due
+ *
+ * The body of 'taskNetwork()', the radio power is updated after every pass.
+ */
+static void netService() {
+  // Process everything the radio has received (the IRQ line is optional)
+  g_radio.poll();
+  uint8_t frame[NET_FRAME_MAX];
+  int length;
+  while((length = g_radio.receive(frame, NET_FRAME_MAX))>0)
+    netProcess(frame, length);
+  if(g_state==NET_JOINING) {
+    if(timeExpired(g_joinTime, NET_JOIN_INTERVAL, MILLISECOND)) {
+      netSend(NET_JOIN, g_nodeID, NET_UUID_SIZE);
+      g_joinTime = getTicks();
+      }
+    return;
+    }
+  // Rejoin if the gateway has stopped acknowledging
+  if(g_radio.sent()!=g_sent) {
+    g_sent = g_radio.sent();
+    g_lost = g_radio.lost();
+    }
+  else if((uint16_t)(g_radio.lost() - g_lost)>=NET_MAX_LOST) {
+    netJoin();
+    return;
+    }
+  // Firmware updates do not wait for the slot
+  if(g_updateDone) {
+    if(!g_radio.sending()||timeExpired(g_updateTime, NET_UPDATE_DELAY, MILLISECOND))
+      restart(false);
+    return;
+    }
+  if(g_updateCheck)
+    netUpdateCheck();
+  else if((g_updateLength!=0)&&timeExpired(g_updateTime, NET_UPDATE_RETRY, MILLISECOND))
+    netUpdateRequest();
+  // Everything else waits for our slot
+  if(!netInSlot())
+    return;
+  // Keep the clock in step with the gateway
+  if(timeExpired(g_syncTime, g_syncValid ? NET_SYNC_INTERVAL : NET_SYNC_RETRY, MILLISECOND))
+    netSync();
+  netFlush();
+  netUpload();
+  }
+
+/** Network processing
+ *
+ * Called from the main loop to process received frames, manage joining the
+ * network and send buffered readings. Because this runs at the start of
+ * each loop pass all the readings made during the previous pass are sent
+ * together.
+ */
+void taskNetwork() {
+  if(g_state==NET_DISABLED)
+    return;
+  netService();
+  netRadioPower();
+  }
+
+/** Prepare the radio for sleep
+ *
+ * Used by 'sleep()'. Frames that are still queued are given a short time to
+ * be sent and the radio is powered down, anything left is sent after waking.
+ */
+void netSleep() {
+  if(g_state==NET_DISABLED)
+    return;
+  uint32_t start = getTicks();
+  while(g_radio.sending()&&!timeExpired(start, NET_SLEEP_DRAIN, MILLISECOND))
+    g_radio.poll();
+  g_radio.powerDown();
+  }
+
+/** Power the radio up again after sleeping
+ *
+ * Used by 'sleep()' NET_WAKE_AHEAD milliseconds before the wake up time, the
+ * radio is only powered up if it will be needed.
+ */
+void netWake() {
+  if(g_state!=NET_DISABLED)
+    netRadioPower();
+  }
+
+/** Set the radio transmit power
+ *
+ * Used by the battery monitor to save power as the battery runs down. A
+ * level set before the radio has started is applied when it starts.
+ *
+ * @param level the power level from 0 (lowest) to 3 (highest).
+ */
+void netPower(uint8_t level) {
+  g_power = level;
+  if(g_state!=NET_DISABLED)
+    g_radio.setPower(level);
+  }
+
+/** Align a wake up time with the transmit slot
+ *
+ * Used by 'sleep()' so the node wakes at the start of its slot.
+ *
+ * @param ticks the earliest tick count to wake at.
+ *
+ * @return the tick count at the start of the next slot (at or after the
+ *         requested time) or the requested time if there is no schedule.
+ */
+uint32_t netSlotAlign(uint32_t ticks) {
+  if((g_state!=NET_CONNECTED)||(g_slotCount==0))
+    return ticks;
+  uint64_t time = netTimeAt(ticks);
+  if(time==0)
+    return ticks;
+  uint64_t start = netSlotStart(time, g_slot, g_slotCount, g_slotTime);
+  return ticks + (uint32_t)(((start - time) * TICKS_PER_SECOND) / 1000);
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Determine if the node has joined the network
+ *
+ * @return true if the node has been accepted by the base station.
+ */
+bool netConnected() {
+  return g_state==NET_CONNECTED;
+  }
+
+/** Queue a sensor reading for transmission
+ *
+ * Readings are buffered until the end of the current loop pass (or until a
+ * frame is full) and then sent together.
+ *
+ * @param channel the application defined channel number.
+ * @param value the value of the reading.
+ *
+ * @return true if the reading was queued or stored, false if the node has
+ *         no radio or has never had the network time.
+ */
+bool netReading(uint8_t channel, int16_t value) {
+  if(g_state==NET_DISABLED)
+    return false;
+  if(g_state!=NET_CONNECTED)
+    return netStore(channel, value);
+  if((g_readingCount==NET_READINGS_MAX)&&!netFlush())
+    return netStore(channel, value);
+  NET_READING *pReading = &g_readings[g_readingCount++];
+  pReading->m_channel = channel;
+  netPut16(pReading->m_value, (uint16_t)value);
+  return true;
+  }
+
+/** Send any buffered readings immediately
+ *
+ * If the node has been assigned a transmit slot the readings are held until
+ * the slot starts.
+ *
+ * @return true if the readings were sent (or there were none to send).
+ */
+bool netFlush() {
+  if(g_readingCount==0)
+    return true;
+  if((g_state!=NET_CONNECTED)||!netInSlot()||!netSend(NET_READINGS, g_readings, g_readingCount * sizeof(NET_READING)))
+    return false;
+  g_readingCount = 0;
+  return true;
+  }
@@ -0,0 +1,144 @@
+/*--------------------------------------------------------------------------*
+* Pin change events
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Implements the platform independent part of pin change notification. The
+* target specific interrupt handlers record edges here and the main loop
+* debounces them and invokes the application callbacks.
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+/** Callback information for a single pin
+ */
+typedef struct _PINEVENT {
+  FN_PINCHANGE      m_pfnCallback; //!< Function to call (NULL if not attached)
+  uint32_t          m_debounce;    //!< Required stable period (milliseconds)
+  volatile uint32_t m_edgeTime;    //!< Tick count of the most recent edge
+  uint8_t           m_edge;        //!< Edges to report
+  bool              m_state;       //!< Last reported state of the pin
+  } PINEVENT;
+
+// Callback table (one entry per pin)
+static PINEVENT g_pinevents[PINMAX];
+
+// Pins with an edge that has not been processed yet (one bit per pin)
+static volatile uint32_t g_pending = 0;
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Record an edge on a pin
+ *
+ * Called from the interrupt handler to queue a change event for the main
+ * loop. This is safe to call from interrupt context.
+ *
+ * @param pin the pin that generated the interrupt.
+ */
+void pinEventSignal(PIN pin) {
+  if(pin>=PINMAX)
+    return;
+  // Every edge restarts the debounce period
+  g_pinevents[pin].m_edgeTime = getTicks();
+  g_pending |= (1 << pin);
+  }
+
+/** Determine if there are pin change events waiting
+ *
+ * @return true if an edge has been recorded but not yet delivered.
+ */
+bool pinEventPending() {
+  return g_pending!=0;
+  }
+
+/** Deliver pending pin change events
+ *
+ * Called from the main loop to debounce queued edges and invoke the attached
+ * callbacks.
+ */
+void taskPinEvents() {
+  if(g_pending==0)
+    return;
+  for(int pin=0; pin<PINMAX; pin++) {
+    uint32_t mask = (1 << pin);
+    if(!(g_pending&mask))
+      continue;
+    PINEVENT *pEvent = &g_pinevents[pin];
+    // Wait for the input to settle (an edge may arrive while we check)
+    disable_interrupts();
+    uint32_t edgeTime = pEvent->m_edgeTime;
+    enable_interrupts();
+    if(!timeExpired(edgeTime, pEvent->m_debounce, MILLISECOND))
+      continue;
+    disable_interrupts();
+    g_pending &= ~mask;
+    enable_interrupts();
+    if(pEvent->m_pfnCallback==NULL)
+      continue;
+    // Determine the new state, ignore bounces back to the original state
+    bool value = pinRead((PIN)pin);
+    if((pEvent->m_debounce>0)&&(value==pEvent->m_state))
+      continue;
+    pEvent->m_state = value;
+    if(pEvent->m_edge&(value?EDGE_RISING:EDGE_FALLING))
+      (*pEvent->m_pfnCallback)((PIN)pin, value);
+    }
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Attach a pin change callback to a digital input
+ *
+ * The pin must already be configured as DIGITAL_INPUT. Once attached the
+ * callback will be invoked from the main loop whenever the pin changes to a
+ * state matching the requested edge and has remained stable for the debounce
+ * period. If the debounce period is 0 every matching edge is reported as soon
+ * as possible without checking for stability.
+ *
+ * @param pin the pin to monitor.
+ * @param edge the edge (or edges) to report.
+ * @param pfnCallback the function to call when the pin changes.
+ * @param debounce the time (in milliseconds) the pin must remain stable
+ *                 before the change is reported.
+ *
+ * @return true if the callback was attached, false if the pin does not
+ *         support change notification or no more interrupts are available.
+ */
+bool pinAttach(PIN pin, PIN_EDGE edge, FN_PINCHANGE pfnCallback, uint32_t debounce) {
+  if((pin>=PINMAX)||(pfnCallback==NULL)||!(edge&EDGE_BOTH))
+    return false;
+  pinDetach(pin);
+  // Set up the callback before the interrupt is enabled
+  PINEVENT *pEvent = &g_pinevents[pin];
+  pEvent->m_pfnCallback = pfnCallback;
+  pEvent->m_debounce = debounce;
+  pEvent->m_edge = edge;
+  pEvent->m_state = pinRead(pin);
+  // Debouncing needs to see both edges to know when the input has settled
+  if(!pinEventEnable(pin, (debounce>0)?EDGE_BOTH:edge)) {
+    pEvent->m_pfnCallback = NULL;
+    return false;
+    }
+  return true;
+  }
+
+/** Remove a pin change callback
+ *
+ * Stops monitoring the pin and releases the associated interrupt. Any change
+ * that has been detected but not yet reported is discarded.
+ *
+ * @param pin the pin to stop monitoring.
+ */
+void pinDetach(PIN pin) {
+  if((pin>=PINMAX)||(g_pinevents[pin].m_pfnCallback==NULL))
+    return;
+  pinEventDisable(pin);
+  g_pinevents[pin].m_pfnCallback = NULL;
+  disable_interrupts();
+  g_pending &= ~(1 << pin);
+  enable_interrupts();
+  }
@@ -0,0 +1,125 @@
+/*--------------------------------------------------------------------------*
+* Loop profiling
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Collects timing statistics for the main loop when the library is built
+* with PROFILE defined. Durations are measured with 'getCycles()' so they
+* have single cycle resolution without a hardware cycle counter.
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+#ifdef PROFILE
+
+// Format version of the binary record
+#define PROFILE_VERSION 1
+
+/** Statistics for a single slot
+ */
+typedef struct _PROFILE_STATS {
+  uint32_t m_id;                         //!< Identifier reported with the slot
+  uint32_t m_count;                      //!< Number of runs recorded
+  uint32_t m_min;                        //!< Shortest run (cycles)
+  uint32_t m_max;                        //!< Longest run (cycles)
+  uint64_t m_total;                      //!< Total of all runs (cycles)
+  uint16_t m_histogram[PROFILE_BUCKETS]; //!< Runs in each power of two
+  } PROFILE_STATS;
+
+// Collected statistics
+static PROFILE_STATS g_profile[PROFILE_SLOTS];
+static uint32_t      g_profileStart = 0;
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Write a value to the serial port and add it to the CRC
+ *
+ * @param crc the CRC to update.
+ * @param value the value to write.
+ * @param bytes the number of bytes to write (least significant first).
+ *
+ * @return the updated CRC.
+ */
+static uint16_t profileWrite(uint16_t crc, uint32_t value, int bytes) {
+  for(int i=0; i<bytes; i++, value >>= 8) {
+    serialWrite((uint8_t)value);
+    crc = crcByte(crc, (uint8_t)value);
+    }
+  return crc;
+  }
+
+/** Record the duration of a single run of a profiled function
+ *
+ * @param slot the profile slot (PROFILE_SLOT).
+ * @param cycles the duration in processor cycles.
+ */
+void profileRecord(int slot, uint32_t cycles) {
+  if((slot<0)||(slot>=PROFILE_SLOTS))
+    return;
+  PROFILE_STATS *pStats = &g_profile[slot];
+  if((pStats->m_count==0)||(cycles<pStats->m_min))
+    pStats->m_min = cycles;
+  if(cycles>pStats->m_max)
+    pStats->m_max = cycles;
+  pStats->m_count++;
+  pStats->m_total += cycles;
+  int bucket = 0;
+  while((bucket<(PROFILE_BUCKETS - 1))&&(cycles>>bucket))
+    bucket++;
+  if(pStats->m_histogram[bucket]!=0xffff)
+    pStats->m_histogram[bucket]++;
+  }
+
+/** Associate an identifier with a profile slot
+ *
+ * @param slot the profile slot (PROFILE_SLOT).
+ * @param id the identifier to report with the slot.
+ */
+void profileTag(int slot, uint32_t id) {
+  if((slot>=0)&&(slot<PROFILE_SLOTS))
+    g_profile[slot].m_id = id;
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Clear the collected profile
+ */
+void profileReset() {
+  for(int slot=0; slot<PROFILE_SLOTS; slot++) {
+    uint32_t id = g_profile[slot].m_id;
+    memset(&g_profile[slot], 0, sizeof(PROFILE_STATS));
+    g_profile[slot].m_id = id;
+    }
+  g_profileStart = getTicks();
+  }
+
+/** Write the collected profile to the serial port
+ *
+ * See sensnode.h for the format of the record.
+ */
+void profileDump() {
+  uint16_t crc = crcInit();
+  crc = profileWrite(crc, 'P', 1);
+  crc = profileWrite(crc, 'F', 1);
+  crc = profileWrite(crc, PROFILE_VERSION, 1);
+  crc = profileWrite(crc, PROFILE_SLOTS, 1);
+  crc = profileWrite(crc, getCyclesPerTick(), 4);
+  crc = profileWrite(crc, getTicks() - g_profileStart, 4);
+  for(int slot=0; slot<PROFILE_SLOTS; slot++) {
+    PROFILE_STATS *pStats = &g_profile[slot];
+    crc = profileWrite(crc, pStats->m_id, 4);
+    crc = profileWrite(crc, pStats->m_count, 4);
+    crc = profileWrite(crc, pStats->m_min, 4);
+    crc = profileWrite(crc, pStats->m_max, 4);
+    crc = profileWrite(crc, (pStats->m_count==0) ? 0 : (uint32_t)(pStats->m_total / pStats->m_count), 4);
+    for(int bucket=0; bucket<PROFILE_BUCKETS; bucket++)
+      crc = profileWrite(crc, pStats->m_histogram[bucket], 2);
+    }
+  profileWrite(crc, crc, 2);
+  }
+
+#endif /* PROFILE */
@@ -0,0 +1,99 @@
+/*--------------------------------------------------------------------------*
+* Retained state
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Variables declared RETAINED are placed in the '.noinit' section which
+* 'init()' leaves alone so they survive a processor reset. 'restart()' seals
+* the section with a CRC16 before resetting, at the next start up the seal
+* is checked and, if it is intact, the library takes the warm boot path.
+* The seal is broken as soon as it has been checked so any other reset
+* (or a power cycle) is a cold boot. Only an explicit 'restart(true)' leads
+* to a warm boot, waking from 'sleep()' does not reset the processor. The
+* hardware is set up again as usual, a warm boot only skips the application
+* and network start up (see 'main()' and 'initNetwork()').
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+// Marks a sealed section ("WARM")
+#define RETAIN_MAGIC  0x5741524d
+
+// AIRCR value to request a system reset
+#define AIRCR_RESET   0x05fa0004
+
+/** Seal placed in front of the retained data
+ */
+typedef struct _RETAIN_HEADER {
+  uint32_t m_magic;  //!< RETAIN_MAGIC if the data is valid
+  uint16_t m_length; //!< Size of the retained data
+  uint16_t m_crc;    //!< CRC16 of the retained data
+  } RETAIN_HEADER;
+
+// Retained data (defined by the linker script, the header is not included)
+extern "C" uint8_t NOINIT_START;
+extern "C" uint8_t NOINIT_END;
+
+// The seal is kept in its own section so it is placed before NOINIT_START
+static RETAIN_HEADER g_seal __attribute__((section(".noinit.header")));
+static bool          g_warm = false;
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Calculate the CRC of the retained data
+ *
+ * @return the CRC16 of everything between NOINIT_START and NOINIT_END.
+ */
+static uint16_t retainCRC() {
+  return crcData(crcInit(), &NOINIT_START, &NOINIT_END - &NOINIT_START);
+  }
+
+/** Check for retained state at startup
+ *
+ * Called once from 'main()' before any retained variables are used.
+ *
+ * @return true if the retained data is valid and this is a warm boot.
+ */
+bool retainRestore() {
+  g_warm = (g_seal.m_magic==RETAIN_MAGIC)&&
+    (g_seal.m_length==(uint16_t)(&NOINIT_END - &NOINIT_START))&&
+    (g_seal.m_crc==retainCRC());
+  g_seal.m_magic = 0;
+  return g_warm;
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Determine if this is a warm boot
+ *
+ * @return true if the device was started by 'restart(true)' and the RETAINED
+ *         variables hold the values they had before the reset.
+ */
+bool warmBoot() {
+  return g_warm;
+  }
+
+/** Reset the processor
+ *
+ * A warm restart seals the RETAINED variables so they are kept, a cold
+ * restart behaves like a power cycle. The hardware is initialised again in
+ * both cases. This function does not return.
+ *
+ * @param warm true to keep the retained state.
+ */
+void restart(bool warm) {
+  disable_interrupts();
+  if(warm) {
+    g_seal.m_length = (uint16_t)(&NOINIT_END - &NOINIT_START);
+    g_seal.m_crc = retainCRC();
+    g_seal.m_magic = RETAIN_MAGIC;
+    }
+  else
+    g_seal.m_magic = 0;
+  AIRCR = AIRCR_RESET;
+  while(true);
+  }
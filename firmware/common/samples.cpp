@@ -0,0 +1,179 @@
+/*--------------------------------------------------------------------------*
+* Sample storage
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Holds timestamped readings while the gateway cannot be reached. Samples
+* are kept in a ring buffer using the same delta encoded records as the
+* NET_SAMPLES frame (see netframe.h), a reading taken every few minutes
+* usually needs three or four bytes. When the buffer is full the oldest
+* samples are discarded. The buffer is RETAINED so stored samples survive a
+* warm restart.
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+#include <netframe.h>
+
+// Size of the buffer (bytes)
+#ifndef SAMPLE_BUFFER_SIZE
+#  define SAMPLE_BUFFER_SIZE 2048
+#endif
+
+/** Ring buffer of encoded samples
+ *
+ * The encoder state is the state after the newest record, the decoder state
+ * is the state before the oldest record.
+ */
+typedef struct _SAMPLE_BUFFER {
+  uint16_t         m_head;                     //!< Offset of the next record
+  uint16_t         m_tail;                     //!< Offset of the oldest record
+  uint16_t         m_used;                     //!< Bytes in use
+  uint16_t         m_count;                    //!< Number of samples stored
+  NET_SAMPLE_STATE m_write;                    //!< Encoder state
+  NET_SAMPLE_STATE m_read;                     //!< Decoder state
+  uint8_t          m_data[SAMPLE_BUFFER_SIZE]; //!< Encoded records
+  } SAMPLE_BUFFER;
+
+static SAMPLE_BUFFER g_samples RETAINED;
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Decode the record at a position in the buffer
+ *
+ * @param pState the decoder state (updated).
+ * @param pOffset the offset of the record (updated to the next record).
+ * @param pAvailable the number of bytes from the offset to the head (updated).
+ * @param pChannel receives the channel number.
+ * @param pTime receives the time of the sample.
+ * @param pValue receives the value of the sample.
+ *
+ * @return true if a record was decoded.
+ */
+static bool sampleNext(NET_SAMPLE_STATE *pState, uint16_t *pOffset, uint16_t *pAvailable, uint8_t *pChannel, uint32_t *pTime, int16_t *pValue) {
+  uint8_t record[NET_SAMPLE_RECORD_MAX];
+  int length = (*pAvailable<NET_SAMPLE_RECORD_MAX) ? *pAvailable : NET_SAMPLE_RECORD_MAX;
+  for(int i=0, offset=*pOffset; i<length; i++) {
+    record[i] = g_samples.m_data[offset];
+    offset = (offset + 1) % SAMPLE_BUFFER_SIZE;
+    }
+  length = netSampleDecode(pState, record, length, pChannel, pTime, pValue);
+  if(length==0)
+    return false;
+  *pOffset = (*pOffset + length) % SAMPLE_BUFFER_SIZE;
+  *pAvailable -= length;
+  return true;
+  }
+
+/** Clear the buffer
+ *
+ * Called at startup unless this is a warm boot.
+ */
+void sampleReset() {
+  g_samples.m_head = 0;
+  g_samples.m_tail = 0;
+  g_samples.m_used = 0;
+  g_samples.m_count = 0;
+  netSampleReset(&g_samples.m_write);
+  netSampleReset(&g_samples.m_read);
+  }
+
+/** Remove the oldest samples
+ *
+ * @param count the number of samples to remove.
+ */
+void sampleDrop(int count) {
+  uint8_t channel;
+  uint32_t time;
+  int16_t value;
+  for(; (count>0)&&(g_samples.m_count>0); count--) {
+    if(!sampleNext(&g_samples.m_read, &g_samples.m_tail, &g_samples.m_used, &channel, &time, &value)) {
+      // Should not happen, start again rather than decode garbage
+      sampleReset();
+      return;
+      }
+    g_samples.m_count--;
+    }
+  }
+
+/** Add a sample to the buffer
+ *
+ * The oldest samples are removed if there is not enough space.
+ *
+ * @param channel the channel number.
+ * @param value the value of the sample.
+ * @param time the time of the sample (seconds since 1/1/1970).
+ *
+ * @return true if the sample was stored.
+ */
+bool sampleStore(uint8_t channel, int16_t value, uint32_t time) {
+  uint8_t record[NET_SAMPLE_RECORD_MAX];
+  NET_SAMPLE_STATE state = g_samples.m_write;
+  int length = netSampleEncode(&state, record, channel, time, value);
+  while((g_samples.m_count>0)&&((SAMPLE_BUFFER_SIZE - g_samples.m_used)<length))
+    sampleDrop(1);
+  if((SAMPLE_BUFFER_SIZE - g_samples.m_used)<length)
+    return false;
+  for(int i=0; i<length; i++) {
+    g_samples.m_data[g_samples.m_head] = record[i];
+    g_samples.m_head = (g_samples.m_head + 1) % SAMPLE_BUFFER_SIZE;
+    }
+  g_samples.m_used += length;
+  g_samples.m_count++;
+  g_samples.m_write = state;
+  return true;
+  }
+
+/** Build a NET_SAMPLES payload from the oldest samples
+ *
+ * The samples are not removed, call 'sampleDrop()' once the frame has been
+ * queued.
+ *
+ * @param pPayload buffer to receive the payload.
+ * @param size the size of the buffer.
+ * @param pLength receives the length of the payload.
+ *
+ * @return the number of samples in the payload.
+ */
+int samplePack(uint8_t *pPayload, int size, int *pLength) {
+  NET_SAMPLE_STATE read = g_samples.m_read, frame;
+  uint16_t offset = g_samples.m_tail, available = g_samples.m_used;
+  uint8_t record[NET_SAMPLE_RECORD_MAX];
+  uint8_t channel;
+  uint32_t time;
+  int16_t value;
+  int count = 0, length = 0;
+  netSampleReset(&frame);
+  while(count<g_samples.m_count) {
+    // Work on copies so the record can be abandoned if it does not fit
+    NET_SAMPLE_STATE nextRead = read, nextFrame = frame;
+    uint16_t nextOffset = offset, nextAvailable = available;
+    if(!sampleNext(&nextRead, &nextOffset, &nextAvailable, &channel, &time, &value))
+      break;
+    int used = netSampleEncode(&nextFrame, record, channel, time, value);
+    if((length + used)>size)
+      break;
+    memcpy(&pPayload[length], record, used);
+    length += used;
+    count++;
+    read = nextRead;
+    frame = nextFrame;
+    offset = nextOffset;
+    available = nextAvailable;
+    }
+  *pLength = length;
+  return count;
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Get the number of stored samples
+ *
+ * @return the number of readings waiting to be uploaded.
+ */
+uint16_t sampleCount() {
+  return g_samples.m_count;
+  }
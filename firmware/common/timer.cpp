@@ -4,6 +4,13 @@
 * 03-Sep-2015 ShaneG
 *
 * Implements the common timing functions.
+*
+* 19-Oct-2026
+*
+* Added the system tick counter (driven by SysTick) and compensation for
+* time spent in deep sleep. Elapsed times are now converted from ticks to
+* the requested units. Added a cycle count for profiling (the SysTick
+* registers are read by the target, see 'getCycles()').
 *--------------------------------------------------------------------------*/
 #include <sensnode.h>
 #include <platform.h>
@@ -13,6 +20,45 @@
 #  error TICKS_PER_SECOND must be >= 1000
 #endif
 
+// Ticks since power up
+static volatile uint32_t g_ticks = 0;
+
+/** SysTick interrupt handler
+ *
+ * Referenced from the interrupt vectors, the tick timer is configured by the
+ * target initialisation code to fire TICKS_PER_SECOND times a second.
+ */
+extern "C" void SysTick_Handler() {
+  g_ticks++;
+  }
+
+/** Advance the system tick count
+ *
+ * Used to account for periods where the tick timer was stopped (deep
+ * sleep for example).
+ *
+ * @param ticks the number of ticks to add.
+ */
+void tickAdvance(uint32_t ticks) {
+  disable_interrupts();
+  g_ticks += ticks;
+  enable_interrupts();
+  }
+
+/** Get the current system tick count
+ *
+ * Each processor board maintains a count of system ticks since power up, this
+ * function returns the current value of that count. The duration of a single
+ * tick is processor independent - use the 'timeExpired()' function to determine
+ * if a time period has been exceeded or 'timeElapsed()' to determine the
+ * amount of time between two tick counts.
+ *
+ * @return the current system tick count.
+ */
+uint32_t getTicks() {
+  return g_ticks;
+  }
+
 /** Calculate the time difference between two tick counts.
  *
  * This function will convert the difference between two tick count values into
@@ -26,17 +72,14 @@
  * @return the amount of elapsed time in whole units.
  */
 uint32_t timeElapsed(uint32_t start, uint32_t end, TIMEUNIT units) {
-  uint32_t elapsed;
-  if(start>end) // Handle wrap around
-    elapsed = ((uint32_t)-1) - end + start;
-  else
-    elapsed = end - start;
+  uint32_t elapsed = end - start; // Unsigned arithmetic handles wrap around
   // Convert to appropriate time period
   switch(units) {
     case MILLISECOND:
+      elapsed = elapsed / (TICKS_PER_SECOND / 1000);
       break;
     case SECOND:
-      elapsed = elapsed / 1000;
+      elapsed = elapsed / TICKS_PER_SECOND;
       break;
     }
   return elapsed;
@@ -0,0 +1,318 @@
+/*--------------------------------------------------------------------------*
+* Firmware update
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Applies a firmware delta (see delta.h) as it arrives. The new image is
+* built a page at a time in RAM and written to the staging area, unchanged
+* code is copied from the running image so only the differences have to be
+* sent. Once the whole image has been written and its CRC32 checked a boot
+* record is written, the boot loader (see xmc1100/boot.c) installs the new
+* image at the next reset. An interrupted update leaves the running image
+* untouched. The running image is checked a part at a time by
+* 'updateCheck()' before the delta is accepted and the new image is checked
+* as each page is written, neither check holds up frame processing. The
+* node IDs are kept in the boot region so they are not part of either image
+* and survive the update.
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+#include <netframe.h>
+#include <delta.h>
+
+// Bytes of the running image checked by each call to updateCheck()
+#define UPDATE_CHECK_SIZE 1024
+
+// Flash regions (defined by the linker script)
+extern "C" uint8_t APP_START;
+extern "C" uint8_t APP_END;
+extern "C" uint8_t UPDATE_START;
+extern "C" uint8_t UPDATE_END;
+extern "C" uint8_t BOOT_RECORD_START;
+
+/** Delta decoder states
+ */
+typedef enum {
+  UPDATE_IDLE,     //!< No update in progress
+  UPDATE_CHECK,    //!< Checking the CRC of the running image
+  UPDATE_HEADER,   //!< Reading the DELTA_HEADER
+  UPDATE_OPCODE,   //!< Waiting for a command
+  UPDATE_ARGUMENT, //!< Reading the command argument
+  UPDATE_DATA,     //!< Reading literal data
+  UPDATE_DONE,     //!< The new image is complete
+  } UPDATE_STATE;
+
+// Update state
+static UPDATE_STATE g_state = UPDATE_IDLE;
+static uint32_t     g_oldSize;   // Size of the running image
+static uint32_t     g_newSize;   // Size of the new image
+static uint32_t     g_oldCrc;    // CRC of the running image
+static uint32_t     g_newCrc;    // CRC of the new image
+static uint32_t     g_crc;       // CRC calculated so far
+static uint32_t     g_position;  // Position in the running image
+static uint32_t     g_written;   // Bytes of the new image produced
+static uint8_t      g_opcode;    // Current command
+static uint32_t     g_value;     // Argument (or header bytes read)
+static uint8_t      g_shift;     // Bits of the argument read
+static uint8_t      g_header[sizeof(DELTA_HEADER)];
+static uint32_t     g_page[FLASH_PAGE_SIZE / 4];
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Write the page buffer to the staging area
+ *
+ * The page is added to the CRC of the new image as it was written to flash.
+ *
+ * @param offset the offset of the page in the new image.
+ *
+ * @return true if the page was written.
+ */
+static bool updatePage(uint32_t offset) {
+  uint8_t *pPage = &UPDATE_START + offset;
+  if(!flashErase(pPage))
+    return false;
+  for(uint32_t block=0; block<FLASH_PAGE_SIZE; block+=FLASH_BLOCK_SIZE) {
+    if(!flashWrite(pPage + block, &g_page[block / 4]))
+      return false;
+    }
+  uint32_t length = g_newSize - offset;
+  g_crc = deltaCrcUpdate(g_crc, pPage, (length<FLASH_PAGE_SIZE) ? length : FLASH_PAGE_SIZE);
+  return true;
+  }
+
+/** Add bytes to the new image
+ *
+ * @param pData the bytes to add.
+ * @param length the number of bytes.
+ *
+ * @return true if the bytes were added, false if the image would be too big
+ *         or the flash could not be written.
+ */
+static bool updateOutput(const uint8_t *pData, uint32_t length) {
+  if(length>(g_newSize - g_written))
+    return false;
+  uint8_t *pPage = (uint8_t *)g_page;
+  while(length>0) {
+    uint32_t offset = g_written % FLASH_PAGE_SIZE;
+    uint32_t count = FLASH_PAGE_SIZE - offset;
+    if(count>length)
+      count = length;
+    memcpy(&pPage[offset], pData, count);
+    pData += count;
+    length -= count;
+    g_written += count;
+    if(((g_written % FLASH_PAGE_SIZE)==0)&&!updatePage(g_written - FLASH_PAGE_SIZE))
+      return false;
+    }
+  return true;
+  }
+
+/** Check the delta header matches the update that was started
+ *
+ * @return true if the header is valid.
+ */
+static bool updateHeader() {
+  const DELTA_HEADER *pHeader = (const DELTA_HEADER *)g_header;
+  return (pHeader->m_magic[0]==DELTA_MAGIC0)&&(pHeader->m_magic[1]==DELTA_MAGIC1)&&
+    (pHeader->m_magic[2]==DELTA_MAGIC2)&&(pHeader->m_magic[3]==DELTA_MAGIC3)&&
+    (netGet32(pHeader->m_oldSize)==g_oldSize)&&(netGet32(pHeader->m_newSize)==g_newSize)&&
+    (netGet32(pHeader->m_oldCrc)==g_oldCrc)&&(netGet32(pHeader->m_newCrc)==g_newCrc);
+  }
+
+/** Execute a command once its argument has been read
+ *
+ * @return true if the command is valid.
+ */
+static bool updateCommand() {
+  switch(g_opcode) {
+    case DELTA_COPY:
+      if(g_value>(g_oldSize - g_position))
+        return false;
+      if(!updateOutput(&APP_START + g_position, g_value))
+        return false;
+      g_position += g_value;
+      g_state = UPDATE_OPCODE;
+      return true;
+    case DELTA_DATA:
+      if(g_value>(g_newSize - g_written))
+        return false;
+      g_state = (g_value==0) ? UPDATE_OPCODE : UPDATE_DATA;
+      return true;
+    case DELTA_SEEK: {
+        int32_t offset = (int32_t)(g_value >> 1) ^ -(int32_t)(g_value & 1);
+        uint32_t position = g_position + offset;
+        if(position>g_oldSize)
+          return false;
+        g_position = position;
+        g_state = UPDATE_OPCODE;
+        }
+      return true;
+    }
+  return false;
+  }
+
+/** Finish the new image
+ *
+ * Writes the last partial page, checks the image and writes the boot record.
+ *
+ * @return true if the update is ready to install.
+ */
+static bool updateFinish() {
+  if(g_written!=g_newSize)
+    return false;
+  uint32_t offset = g_written % FLASH_PAGE_SIZE;
+  if(offset>0) {
+    memset((uint8_t *)g_page + offset, 0xff, FLASH_PAGE_SIZE - offset);
+    if(!updatePage(g_written - offset))
+      return false;
+    }
+  if(~g_crc!=g_newCrc)
+    return false;
+  memset(g_page, 0xff, sizeof(g_page));
+  BOOT_RECORD *pRecord = (BOOT_RECORD *)g_page;
+  pRecord->m_magic = BOOT_MAGIC;
+  pRecord->m_size = g_newSize;
+  pRecord->m_crc = g_newCrc;
+  pRecord->m_check = ~g_newCrc;
+  if(!flashErase(&BOOT_RECORD_START))
+    return false;
+  for(uint32_t block=0; block<sizeof(BOOT_RECORD); block+=FLASH_BLOCK_SIZE) {
+    if(!flashWrite(&BOOT_RECORD_START + block, &g_page[block / 4]))
+      return false;
+    }
+  return true;
+  }
+
+/** Process a single byte of the delta
+ *
+ * @param data the byte to process.
+ *
+ * @return UPDATE_MORE, UPDATE_COMPLETE or UPDATE_FAILED.
+ */
+static int updateByte(uint8_t data) {
+  switch(g_state) {
+    case UPDATE_HEADER:
+      g_header[g_value++] = data;
+      if(g_value<sizeof(DELTA_HEADER))
+        return UPDATE_MORE;
+      if(!updateHeader())
+        return UPDATE_FAILED;
+      g_state = UPDATE_OPCODE;
+      return UPDATE_MORE;
+    case UPDATE_OPCODE:
+      g_opcode = data;
+      if(g_opcode==DELTA_END) {
+        if(!updateFinish())
+          return UPDATE_FAILED;
+        g_state = UPDATE_DONE;
+        return UPDATE_COMPLETE;
+        }
+      if(g_opcode>DELTA_SEEK)
+        return UPDATE_FAILED;
+      g_value = 0;
+      g_shift = 0;
+      g_state = UPDATE_ARGUMENT;
+      return UPDATE_MORE;
+    case UPDATE_ARGUMENT:
+      if(g_shift>=(DELTA_VARINT_MAX * 7))
+        return UPDATE_FAILED;
+      g_value |= (uint32_t)(data & 0x7f) << g_shift;
+      g_shift += 7;
+      if((data&0x80)||updateCommand())
+        return UPDATE_MORE;
+      return UPDATE_FAILED;
+    case UPDATE_DATA:
+      if(!updateOutput(&data, 1))
+        return UPDATE_FAILED;
+      if(--g_value==0)
+        g_state = UPDATE_OPCODE;
+      return UPDATE_MORE;
+    default:
+      return UPDATE_FAILED;
+    }
+  }
+
+/** Start applying a delta
+ *
+ * Checks the new image will fit. The running image must then be checked
+ * with 'updateCheck()' before the delta can be applied.
+ *
+ * @param oldSize the size of the image the delta applies to.
+ * @param newSize the size of the image the delta produces.
+ * @param oldCrc the CRC32 of the image the delta applies to.
+ * @param newCrc the CRC32 of the image the delta produces.
+ *
+ * @return true if the update was started.
+ */
+bool updateStart(uint32_t oldSize, uint32_t newSize, uint32_t oldCrc, uint32_t newCrc) {
+  g_state = UPDATE_IDLE;
+  if((oldSize>(uint32_t)(&APP_END - &APP_START))||(newSize==0))
+    return false;
+  if((newSize>(uint32_t)(&UPDATE_END - &UPDATE_START))||(newSize>(uint32_t)(&APP_END - &APP_START)))
+    return false;
+  g_oldSize = oldSize;
+  g_newSize = newSize;
+  g_oldCrc = oldCrc;
+  g_newCrc = newCrc;
+  g_position = 0;
+  g_written = 0;
+  g_value = 0;
+  g_crc = DELTA_CRC_INIT;
+  g_state = UPDATE_CHECK;
+  return true;
+  }
+
+/** Check the next part of the running image
+ *
+ * Called repeatedly after 'updateStart()' until the whole of the running
+ * image has been checked, only UPDATE_CHECK_SIZE bytes are processed by
+ * each call.
+ *
+ * @return UPDATE_MORE if the check is still in progress, UPDATE_COMPLETE if
+ *         the delta applies to the running image or UPDATE_FAILED.
+ */
+int updateCheck() {
+  if(g_state!=UPDATE_CHECK)
+    return (g_state==UPDATE_IDLE) ? UPDATE_FAILED : UPDATE_COMPLETE;
+  uint32_t count = g_oldSize - g_position;
+  if(count>UPDATE_CHECK_SIZE)
+    count = UPDATE_CHECK_SIZE;
+  g_crc = deltaCrcUpdate(g_crc, &APP_START + g_position, count);
+  g_position += count;
+  if(g_position<g_oldSize)
+    return UPDATE_MORE;
+  if(~g_crc!=g_oldCrc) {
+    g_state = UPDATE_IDLE;
+    return UPDATE_FAILED;
+    }
+  g_position = 0;
+  g_crc = DELTA_CRC_INIT;
+  g_state = UPDATE_HEADER;
+  return UPDATE_COMPLETE;
+  }
+
+/** Apply the next part of the delta
+ *
+ * @param pData the delta bytes (following on from the previous call).
+ * @param length the number of bytes.
+ *
+ * @return UPDATE_MORE if more data is needed, UPDATE_COMPLETE once the new
+ *         image has been verified and the boot record written (restart to
+ *         install it) or UPDATE_FAILED.
+ */
+int updateWrite(const uint8_t *pData, int length) {
+  int result = (g_state==UPDATE_IDLE) ? UPDATE_FAILED : UPDATE_MORE;
+  for(int i=0; (result==UPDATE_MORE)&&(i<length); i++)
+    result = updateByte(pData[i]);
+  if(result==UPDATE_FAILED)
+    g_state = UPDATE_IDLE;
+  return result;
+  }
+
+/** Abandon the update in progress
+ */
+void updateCancel() {
+  g_state = UPDATE_IDLE;
+  }
@@ -8,6 +8,9 @@
 #include <sensnode.h>
 #include <drivers/mcp23008.h>
 
+// Largest register block transferred in a single transaction
+#define MCP_MAX_BLOCK 11
+
 /** Constructor
  *
  * The constructor specifies the communication devices to use to talk to
@@ -19,55 +22,53 @@ MCP23008::MCP23008(uint8_t address) {
   m_address = address;
   }
 
-/** Initialise the digital pin interface
+/** Write a sequence of registers
  *
- * Configure the interface prior to use. Note that the core implementations
- * are initialised at start up and do not require explicit initialisation by
- * the application.
- *
- * @return true if the initialise succeeded.
- */
-bool MCP23008::init() {
-  // TODO: Implement this
-  return false;
-  }
-
-/** Configure a GPIO pin
+ * The register address and data are sent in a single I2C write.
  *
- * @param pin the pin to configure
- * @param mode the requested mode for the pin
- * @param flags optional flags for the pin.
+ * @param reg the first register to write.
+ * @param pData the values to write.
+ * @param count the number of registers to write.
  *
- * @return true if the pin was configured as requested.
+ * @return true if the write succeeded.
  */
-bool MCP23008::pinConfig(uint8_t pin, PIN_MODE mode, uint8_t flags) {
-  // TODO: Implement this
-  return false;
+bool MCP23008::writeRegisters(uint8_t reg, const uint8_t *pData, int count) {
+  uint8_t buffer[MCP_MAX_BLOCK + 1];
+  if((count<=0)||(count>MCP_MAX_BLOCK))
+    return false;
+  buffer[0] = reg;
+  memcpy(&buffer[1], pData, count);
+  return i2cSendTo(m_address, buffer, count + 1)==(count + 1);
   }
 
-/** Read the value of a digital pin.
+/** Read a sequence of registers
  *
- * To use this function the pin must be configured as DIGITAL_INPUT. If the pin
- * was configured for a different mode the result will always be false.
+ * The register address is written and the data read back in a single
+ * transaction using a repeated start.
  *
- * @param pin the pin to read
+ * @param reg the first register to read.
+ * @param pData buffer to receive the values.
+ * @param count the number of registers to read.
  *
- * @return the current state of the pin.
+ * @return true if the read succeeded.
  */
-bool MCP23008::pinRead(uint8_t pin) {
-  // TODO: Implement this
-  return false
+bool MCP23008::readRegisters(uint8_t reg, uint8_t *pData, int count) {
+  if((count<=0)||(count>MCP_MAX_BLOCK))
+    return false;
+  I2C_TXN txn = { m_address, 1, (uint8_t)count, I2C_IDLE, &reg, pData, 0, NULL, NULL };
+  return i2cExecute(&txn)==I2C_DONE;
   }
 
-/** Change the state of a digital pin.
+/** Initialise the digital pin interface
  *
- * To use this function the pin must be configured as DIGITAL_OUTPUT. If the
- * pin was configured for a different mode the function will have no effect.
+ * Configure the interface prior to use. Note that the core implementations
+ * are initialised at start up and do not require explicit initialisation by
+ * the application.
  *
- * @param pin the pin to change the state of
- * @param value the value to set the pin to (true = high, false = low)
+ * @return true if the initialise succeeded.
  */
-void MCP23008::pinWrite(uint8_t pin, bool value) {
-  // TODO: Implement this
+bool MCP23008::init() {
+  if(!i2cConfig())
+    return false;
+  return MCP23X08::init();
   }
-
@@ -6,7 +6,11 @@
 * Provides a Digital interface using the 8 bit Microchip IO expanders.
 *---------------------------------------------------------------------------*/
 #include <sensnode.h>
-#include <drivers/MCP23S08.h>
+#include <drivers/mcp23008.h>
+
+// SPI opcodes (hardware address pins A0/A1 tied low)
+#define MCP_WRITE 0x40
+#define MCP_READ  0x41
 
 /** Constructor
  *
@@ -19,55 +23,52 @@ MCP23S08::MCP23S08(PIN select) {
   m_select = select;
   }
 
-/** Initialise the digital pin interface
- *
- * Configure the interface prior to use. Note that the core implementations
- * are initialised at start up and do not require explicit initialisation by
- * the application.
- *
- * @return true if the initialise succeeded.
- */
-bool MCP23S08::init() {
-  // TODO: Implement this
-  return false;
-  }
-
-/** Configure a GPIO pin
+/** Write a sequence of registers
  *
- * @param pin the pin to configure
- * @param mode the requested mode for the pin
- * @param flags optional flags for the pin.
+ * @param reg the first register to write.
+ * @param pData the values to write.
+ * @param count the number of registers to write.
  *
- * @return true if the pin was configured as requested.
+ * @return true if the write succeeded.
  */
-bool MCP23S08::pinConfig(uint8_t pin, PIN_MODE mode, uint8_t flags) {
-  // TODO: Implement this
-  return false;
+bool MCP23S08::writeRegisters(uint8_t reg, const uint8_t *pData, int count) {
+  uint8_t header[2] = { MCP_WRITE, reg };
+  ::pinWrite(m_select, false);
+  spiWrite(header, 2);
+  spiWrite(pData, count);
+  ::pinWrite(m_select, true);
+  return true;
   }
 
-/** Read the value of a digital pin.
- *
- * To use this function the pin must be configured as DIGITAL_INPUT. If the pin
- * was configured for a different mode the result will always be false.
+/** Read a sequence of registers
  *
- * @param pin the pin to read
+ * @param reg the first register to read.
+ * @param pData buffer to receive the values.
+ * @param count the number of registers to read.
  *
- * @return the current state of the pin.
+ * @return true if the read succeeded.
  */
-bool MCP23S08::pinRead(uint8_t pin) {
-  // TODO: Implement this
-  return false
+bool MCP23S08::readRegisters(uint8_t reg, uint8_t *pData, int count) {
+  uint8_t header[2] = { MCP_READ, reg };
+  ::pinWrite(m_select, false);
+  spiWrite(header, 2);
+  spiRead(pData, count);
+  ::pinWrite(m_select, true);
+  return true;
   }
 
-/** Change the state of a digital pin.
+/** Initialise the digital pin interface
  *
- * To use this function the pin must be configured as DIGITAL_OUTPUT. If the
- * pin was configured for a different mode the function will have no effect.
+ * Configure the interface prior to use. Note that the core implementations
+ * are initialised at start up and do not require explicit initialisation by
+ * the application.
  *
- * @param pin the pin to change the state of
- * @param value the value to set the pin to (true = high, false = low)
+ * @return true if the initialise succeeded.
  */
-void MCP23S08::pinWrite(uint8_t pin, bool value) {
-  // TODO: Implement this
+bool MCP23S08::init() {
+  if(!::pinConfig(m_select, DIGITAL_OUTPUT))
+    return false;
+  ::pinWrite(m_select, true);
+  spiConfig(false, false, true); // SPI mode 0,0
+  return MCP23X08::init();
   }
-
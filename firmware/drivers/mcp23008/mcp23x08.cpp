@@ -0,0 +1,325 @@
+/*--------------------------------------------------------------------------*
+* MCP23X08 Common Driver Implementation
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Register caching and interrupt-on-change handling shared by the I2C and
+* SPI versions of the 8 bit Microchip IO expanders.
+*---------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <drivers/mcp23008.h>
+
+// Register addresses
+#define MCP_IODIR   0x00
+#define MCP_GPINTEN 0x02
+#define MCP_GPPU    0x06
+#define MCP_INTF    0x07
+#define MCP_GPIO    0x09
+#define MCP_OLAT    0x0A
+
+// Dirty flags for the cached registers
+#define DIRTY_IODIR   0x01
+#define DIRTY_GPPU    0x02
+#define DIRTY_OLAT    0x04
+#define DIRTY_GPINTEN 0x08
+#define DIRTY_ALL     (DIRTY_IODIR|DIRTY_GPPU|DIRTY_OLAT|DIRTY_GPINTEN)
+
+// Maximum number of times to service INT before returning to the main loop
+#define MCP_INT_RETRIES 4
+
+// List of initialised devices (flushed at the end of each loop)
+static MCP23X08 *g_pDevices = NULL;
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Constructor
+ *
+ * Sets the shadow registers to the power on reset values of the device.
+ */
+MCP23X08::MCP23X08() {
+  m_iodir = 0xff;
+  m_gppu = 0;
+  m_olat = 0;
+  m_gpinten = 0;
+  m_dirty = 0;
+  m_inputs = 0;
+  m_irq = PINMAX;
+  m_pNext = NULL;
+  for(int pin=0; pin<8; pin++)
+    m_pfnChange[pin] = NULL;
+  }
+
+/** Write pending changes for all initialised devices
+ *
+ * Registered as a background task so buffered writes made during the
+ * application loop are sent when it finishes.
+ */
+void MCP23X08::flushAll() {
+  for(MCP23X08 *pDevice = g_pDevices; pDevice!=NULL; pDevice = pDevice->m_pNext) {
+    if(pDevice->m_dirty)
+      pDevice->flush();
+    }
+  }
+
+/** Change handler for the INT line
+ *
+ * Called from the main loop when an INT output goes low. Services every
+ * device attached to the pin.
+ *
+ * @param pin the SensNode pin that changed.
+ * @param value the new state of the pin (always low, only falling edges
+ *              are monitored).
+ */
+void MCP23X08::interruptHandler(PIN pin, bool /* value */) {
+  for(MCP23X08 *pDevice = g_pDevices; pDevice!=NULL; pDevice = pDevice->m_pNext) {
+    if(pDevice->m_irq==pin)
+      pDevice->processInterrupt();
+    }
+  }
+
+/** Deliver changes captured by the expander
+ *
+ * Reads INTF and INTCAP in a single transaction (reading INTCAP releases the
+ * INT output) and invokes the callback for every monitored input that is
+ * different from the last reported state. This is repeated while INT is
+ * still asserted so changes that happen during the read are not lost.
+ */
+void MCP23X08::processInterrupt() {
+  for(int retry=0; retry<MCP_INT_RETRIES; retry++) {
+    uint8_t regs[2]; // INTF, INTCAP
+    if(!readRegisters(MCP_INTF, regs, 2))
+      return;
+    uint8_t changed = (regs[1] ^ m_inputs) & m_gpinten;
+    m_inputs = (m_inputs & ~m_gpinten) | (regs[1] & m_gpinten);
+    for(int pin=0; changed!=0; pin++, changed >>= 1) {
+      if((changed&0x01)&&(m_pfnChange[pin]!=NULL))
+        (*m_pfnChange[pin])(this, pin, (m_inputs >> pin) & 0x01);
+      }
+    if(::pinRead((PIN)m_irq)) // INT released
+      return;
+    }
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Initialise the digital pin interface
+ *
+ * Writes the shadow registers to the device and adds it to the list of
+ * devices flushed at the end of each loop. Subclasses must set up the bus
+ * before calling this.
+ *
+ * @return true if the initialise succeeded.
+ */
+bool MCP23X08::init() {
+  m_dirty = DIRTY_ALL;
+  if(!flush())
+    return false;
+  // Add to the flush list (only once)
+  MCP23X08 *pDevice;
+  for(pDevice = g_pDevices; (pDevice!=NULL)&&(pDevice!=this); pDevice = pDevice->m_pNext);
+  if(pDevice==NULL) {
+    m_pNext = g_pDevices;
+    g_pDevices = this;
+    }
+  return addTask(flushAll);
+  }
+
+/** Configure a GPIO pin
+ *
+ * Only DISABLED, DIGITAL_INPUT (with optional PULLUP) and DIGITAL_OUTPUT
+ * are supported. The change is applied by the next flush().
+ *
+ * @param pin the pin to configure
+ * @param mode the requested mode for the pin
+ * @param flags optional flags for the pin.
+ *
+ * @return true if the pin was configured as requested.
+ */
+bool MCP23X08::pinConfig(uint8_t pin, PIN_MODE mode, uint8_t flags) {
+  if(pin>=8)
+    return false;
+  uint8_t mask = 1 << pin;
+  uint8_t iodir = m_iodir | mask, gppu = m_gppu & ~mask;
+  switch(mode) {
+    case DISABLED:
+      break;
+    case DIGITAL_INPUT:
+      if(flags&~PULLUP) // No pulldown or wakeup support
+        return false;
+      if(flags&PULLUP)
+        gppu |= mask;
+      break;
+    case DIGITAL_OUTPUT:
+      if(flags!=0)
+        return false;
+      iodir &= ~mask;
+      break;
+    default:
+      return false;
+    }
+  // Only inputs can generate change notifications
+  if(!(iodir&mask))
+    pinDetach(pin);
+  if(iodir!=m_iodir)
+    m_dirty |= DIRTY_IODIR;
+  if(gppu!=m_gppu)
+    m_dirty |= DIRTY_GPPU;
+  m_iodir = iodir;
+  m_gppu = gppu;
+  return true;
+  }
+
+/** Read the value of a digital pin.
+ *
+ * To use this function the pin must be configured as DIGITAL_INPUT. If the pin
+ * was configured for a different mode the result will always be false.
+ *
+ * @param pin the pin to read
+ *
+ * @return the current state of the pin.
+ */
+bool MCP23X08::pinRead(uint8_t pin) {
+  uint8_t mask = 1 << pin;
+  if((pin>=8)||!(m_iodir&mask))
+    return false;
+  // Monitored inputs are kept up to date by the interrupt
+  if(m_gpinten&mask)
+    return m_inputs & mask;
+  return readPort() & mask;
+  }
+
+/** Change the state of a digital pin.
+ *
+ * To use this function the pin must be configured as DIGITAL_OUTPUT. If the
+ * pin was configured for a different mode the function will have no effect.
+ * The new state is applied by the next flush().
+ *
+ * @param pin the pin to change the state of
+ * @param value the value to set the pin to (true = high, false = low)
+ */
+void MCP23X08::pinWrite(uint8_t pin, bool value) {
+  if((pin>=8)||(m_iodir&(1 << pin)))
+    return;
+  writePort(1 << pin, value ? 0xff : 0);
+  }
+
+/** Change the state of several pins
+ *
+ * The new state is applied by the next flush().
+ *
+ * @param mask the pins to change (bit n = pin n).
+ * @param value the new values for those pins.
+ */
+void MCP23X08::writePort(uint8_t mask, uint8_t value) {
+  uint8_t olat = (m_olat & ~mask) | (value & mask);
+  if(olat!=m_olat) {
+    m_olat = olat;
+    m_dirty |= DIRTY_OLAT;
+    }
+  }
+
+/** Read the state of all pins
+ *
+ * Any pending changes are written first so the result reflects the
+ * current configuration.
+ *
+ * @return the value of the GPIO register (bit n = pin n).
+ */
+uint8_t MCP23X08::readPort() {
+  uint8_t value = 0;
+  if(m_dirty)
+    flush();
+  readRegisters(MCP_GPIO, &value, 1);
+  return value;
+  }
+
+/** Write any pending changes to the device
+ *
+ * The output latch is written before the direction register so pins that
+ * become outputs start with the requested value.
+ *
+ * @return true if all changes were written successfully.
+ */
+bool MCP23X08::flush() {
+  if((m_dirty&DIRTY_OLAT)&&writeRegisters(MCP_OLAT, &m_olat, 1))
+    m_dirty &= ~DIRTY_OLAT;
+  if((m_dirty&DIRTY_GPPU)&&writeRegisters(MCP_GPPU, &m_gppu, 1))
+    m_dirty &= ~DIRTY_GPPU;
+  if((m_dirty&DIRTY_IODIR)&&writeRegisters(MCP_IODIR, &m_iodir, 1))
+    m_dirty &= ~DIRTY_IODIR;
+  if((m_dirty&DIRTY_GPINTEN)&&writeRegisters(MCP_GPINTEN, &m_gpinten, 1))
+    m_dirty &= ~DIRTY_GPINTEN;
+  return m_dirty==0;
+  }
+
+/** Enable interrupt-on-change support
+ *
+ * Configures the SensNode pin connected to the INT output of the expander
+ * as an input and monitors it for changes. The device must have been
+ * initialised first. The INT output is left in the default configuration
+ * (active low, push-pull). Any change already captured by the expander is
+ * cleared.
+ *
+ * @param irq the SensNode pin connected to the INT output.
+ *
+ * @return true if the interrupt line could be monitored.
+ */
+bool MCP23X08::attachInterrupt(PIN irq) {
+  MCP23X08 *pDevice;
+  for(pDevice = g_pDevices; (pDevice!=NULL)&&(pDevice!=this); pDevice = pDevice->m_pNext);
+  if((pDevice==NULL)||(m_irq!=PINMAX))
+    return false;
+  if(!::pinConfig(irq, DIGITAL_INPUT))
+    return false;
+  // No debounce, each INT assertion must be serviced
+  if(!::pinAttach(irq, EDGE_FALLING, interruptHandler, 0))
+    return false;
+  m_irq = irq;
+  // INT may already be asserted (so no edge will be seen), reading INTCAP
+  // releases it
+  processInterrupt();
+  return true;
+  }
+
+/** Attach a change callback to an expander input
+ *
+ * The pin must be configured as DIGITAL_INPUT and attachInterrupt() must
+ * have been called. The callback is invoked from the main loop whenever
+ * the pin changes state. While a callback is attached pinRead() returns
+ * the state captured by the last interrupt without accessing the bus.
+ *
+ * @param pin the expander pin to monitor (0 to 7).
+ * @param pfnCallback the function to call when the pin changes.
+ *
+ * @return true if the callback was attached.
+ */
+bool MCP23X08::pinAttach(uint8_t pin, FN_EXPANDERCHANGE pfnCallback) {
+  uint8_t mask = 1 << pin;
+  if((pin>=8)||(pfnCallback==NULL)||(m_irq==PINMAX)||!(m_iodir&mask))
+    return false;
+  // Start from the current state so the first change is reported correctly
+  if(!(m_gpinten&mask)) {
+    m_inputs = (m_inputs & ~mask) | (readPort() & mask);
+    m_gpinten |= mask;
+    m_dirty |= DIRTY_GPINTEN;
+    }
+  m_pfnChange[pin] = pfnCallback;
+  return true;
+  }
+
+/** Remove a change callback from an expander input
+ *
+ * @param pin the expander pin to stop monitoring.
+ */
+void MCP23X08::pinDetach(uint8_t pin) {
+  uint8_t mask = 1 << pin;
+  if((pin>=8)||!(m_gpinten&mask))
+    return;
+  m_gpinten &= ~mask;
+  m_dirty |= DIRTY_GPINTEN;
+  m_pfnChange[pin] = NULL;
+  }
@@ -0,0 +1,400 @@
+/*--------------------------------------------------------------------------*
+* NRF24L01 Driver Implementation
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Interrupt driven driver for the NRF24L01+ transceiver. Payloads are loaded
+* in a single SPI burst, acknowledgement and retransmission are handled by
+* the module. Every IRQ drains all received payloads into a RAM queue.
+* Transmit and receive time is reported to the energy accounting.
+*
+* Payloads to send are queued in RAM and handed to the module one at a time
+* so every acknowledgement and every failure is counted, a payload that runs
+* out of retries is dropped without losing the ones queued behind it.
+*
+* Boards without the IRQ line connected are serviced by calling poll() from
+* the main loop. The module can be powered down between transmissions, a
+* queued payload powers it up again.
+*---------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <drivers/nrf24l01.h>
+
+// SPI commands
+#define NRF_R_REGISTER    0x00
+#define NRF_W_REGISTER    0x20
+#define NRF_R_RX_PL_WID   0x60
+#define NRF_R_RX_PAYLOAD  0x61
+#define NRF_W_TX_PAYLOAD  0xA0
+#define NRF_FLUSH_TX      0xE1
+#define NRF_FLUSH_RX      0xE2
+#define NRF_NOP           0xFF
+
+// Registers
+#define NRF_CONFIG        0x00
+#define NRF_EN_AA         0x01
+#define NRF_EN_RXADDR     0x02
+#define NRF_SETUP_AW      0x03
+#define NRF_SETUP_RETR    0x04
+#define NRF_RF_CH         0x05
+#define NRF_RF_SETUP      0x06
+#define NRF_STATUS        0x07
+#define NRF_RX_ADDR_P0    0x0A
+#define NRF_RX_ADDR_P1    0x0B
+#define NRF_TX_ADDR       0x10
+#define NRF_FIFO_STATUS   0x17
+#define NRF_DYNPD         0x1C
+#define NRF_FEATURE       0x1D
+
+// CONFIG bits
+#define CONFIG_EN_CRC     0x08
+#define CONFIG_CRCO       0x04
+#define CONFIG_PWR_UP     0x02
+#define CONFIG_PRIM_RX    0x01
+#define CONFIG_DEFAULT    (CONFIG_EN_CRC|CONFIG_CRCO|CONFIG_PWR_UP)
+
+// STATUS bits
+#define STATUS_RX_DR      0x40
+#define STATUS_TX_DS      0x20
+#define STATUS_MAX_RT     0x10
+#define STATUS_IRQ        (STATUS_RX_DR|STATUS_TX_DS|STATUS_MAX_RT)
+
+// FIFO_STATUS bits
+#define FIFO_TX_FULL      0x20
+#define FIFO_TX_EMPTY     0x10
+#define FIFO_RX_EMPTY     0x01
+
+// Radio configuration
+#define NRF_RETRY_DELAY   1  // 500us between retries
+#define NRF_RETRY_COUNT   15 // Maximum retries
+#define NRF_RF_SETUP_1M   0x06 // 1Mbps, 0dBm
+#define NRF_RF_PWR        0x06 // RF_PWR field of RF_SETUP
+#define NRF_PIPES         0x03 // Pipes 0 (acknowledgements) and 1 (data)
+
+// Maximum number of times to service IRQ before returning to the main loop
+#define NRF_IRQ_RETRIES   4
+
+// The active driver instance
+static NRF24L01 *g_pRadio = NULL;
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Send a command to the module
+ *
+ * The command and any data are transferred with the module selected for
+ * the whole sequence.
+ *
+ * @param cmd the command byte.
+ * @param pOutput data to send after the command (or NULL).
+ * @param pInput buffer for data read after the command (or NULL).
+ * @param count the number of data bytes to transfer.
+ *
+ * @return the value of the STATUS register.
+ */
+uint8_t NRF24L01::command(uint8_t cmd, const uint8_t *pOutput, uint8_t *pInput, int count) {
+  uint8_t status;
+  spiConfig(false, false, true); // SPI mode 0,0
+  ::pinWrite(m_csn, false);
+  spiTransfer(&cmd, &status, 1);
+  if(pInput!=NULL)
+    spiRead(pInput, count);
+  else if(pOutput!=NULL)
+    spiWrite(pOutput, count);
+  ::pinWrite(m_csn, true);
+  return status;
+  }
+
+/** Read a single byte register
+ *
+ * @param reg the register to read.
+ *
+ * @return the register value.
+ */
+uint8_t NRF24L01::readRegister(uint8_t reg) {
+  uint8_t value = 0;
+  command(NRF_R_REGISTER | reg, NULL, &value, 1);
+  return value;
+  }
+
+/** Write a single byte register
+ *
+ * @param reg the register to write.
+ * @param value the value to write.
+ */
+void NRF24L01::writeRegister(uint8_t reg, uint8_t value) {
+  command(NRF_W_REGISTER | reg, &value, NULL, 1);
+  }
+
+/** Switch between transmit and receive mode
+ *
+ * CE stays high in both modes. In transmit mode the module sends everything
+ * in the transmit FIFO and then waits in standby. The module is powered up
+ * if needed, it starts operating once the oscillator is stable (1.5ms).
+ *
+ * @param transmit true for transmit mode, false for receive mode.
+ */
+void NRF24L01::setMode(bool transmit) {
+  ::pinWrite(m_ce, false);
+  writeRegister(NRF_CONFIG, transmit ? CONFIG_DEFAULT : (CONFIG_DEFAULT | CONFIG_PRIM_RX));
+  ::pinWrite(m_ce, true);
+  m_transmit = transmit;
+  m_powered = true;
+  energyActive(ENERGY_RADIO_TX, transmit);
+  energyActive(ENERGY_RADIO_RX, !transmit);
+  }
+
+/** Hand the next queued payload to the module
+ *
+ * Returns to receive mode once the queue is empty.
+ */
+void NRF24L01::loadPayload() {
+  if(m_txCount==0) {
+    setMode(false);
+    return;
+    }
+  if(!(m_transmit&&m_powered))
+    setMode(true);
+  NRF_PACKET *pPacket = &m_txQueue[m_txHead];
+  command(NRF_W_TX_PAYLOAD, pPacket->m_data, NULL, pPacket->m_length);
+  }
+
+/** Change handler for the IRQ line
+ *
+ * @param pin the pin that changed.
+ * @param value the new state of the pin (always low, only falling edges
+ *              are monitored).
+ */
+void NRF24L01::interruptHandler(PIN pin, bool /* value */) {
+  if((g_pRadio!=NULL)&&(g_pRadio->m_irq==pin))
+    g_pRadio->processInterrupt();
+  }
+
+/** Process the events signalled by the module
+ *
+ * The interrupt flags are cleared before the FIFOs are serviced so any new
+ * event generates another falling edge. All three receive FIFO slots are
+ * emptied on each pass.
+ */
+void NRF24L01::processInterrupt() {
+  for(int retry=0; retry<NRF_IRQ_RETRIES; retry++) {
+    uint8_t status = command(NRF_NOP, NULL, NULL, 0);
+    if(!(status&STATUS_IRQ))
+      return;
+    writeRegister(NRF_STATUS, status & STATUS_IRQ);
+    if(status&STATUS_RX_DR) {
+      while(!(readRegister(NRF_FIFO_STATUS)&FIFO_RX_EMPTY)) {
+        uint8_t length = 0;
+        command(NRF_R_RX_PL_WID, NULL, &length, 1);
+        if((length==0)||(length>NRF_PAYLOAD_MAX)) {
+          // Corrupted length, the datasheet requires the FIFO to be flushed
+          command(NRF_FLUSH_RX, NULL, NULL, 0);
+          break;
+          }
+        NRF_PACKET discard, *pPacket = &discard;
+        if(m_rxCount<NRF_RX_QUEUE)
+          pPacket = &m_rxQueue[(m_rxHead + m_rxCount++) % NRF_RX_QUEUE];
+        else
+          m_overflow++;
+        pPacket->m_length = length;
+        command(NRF_R_RX_PAYLOAD, NULL, pPacket->m_data, length);
+        }
+      }
+    // Only one payload is in the module so each event completes exactly one
+    if((status&(STATUS_TX_DS|STATUS_MAX_RT))&&(m_txCount>0)) {
+      if(status&STATUS_TX_DS)
+        m_sent++;
+      else {
+        // The failed payload stays in the FIFO until it is flushed
+        m_lost++;
+        command(NRF_FLUSH_TX, NULL, NULL, 0);
+        }
+      m_txHead = (m_txHead + 1) % NRF_TX_QUEUE;
+      m_txCount--;
+      loadPayload();
+      }
+    if((m_irq!=PINMAX)&&::pinRead(m_irq)) // IRQ released
+      return;
+    }
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Initialise the driver
+ *
+ * Configures the control pins, powers up the module and enters receive
+ * mode. This blocks for the power up delay of the module (about 2ms).
+ *
+ * @param ce the pin connected to CE.
+ * @param csn the pin connected to CSN.
+ * @param irq the pin connected to IRQ, PINMAX (or a pin that is not
+ *            available on the board) if the module is serviced by poll().
+ * @param channel the RF channel to use (0 to 125).
+ *
+ * @return true if the module was detected and initialised.
+ */
+bool NRF24L01::init(PIN ce, PIN csn, PIN irq, uint8_t channel) {
+  if(((g_pRadio!=NULL)&&(g_pRadio!=this))||(channel>125))
+    return false;
+  m_ce = ce;
+  m_csn = csn;
+  m_irq = irq;
+  m_transmit = false;
+  m_powered = false;
+  m_rxHead = 0;
+  m_rxCount = 0;
+  m_txHead = 0;
+  m_txCount = 0;
+  m_sent = 0;
+  m_lost = 0;
+  m_overflow = 0;
+  if(!(::pinConfig(ce, DIGITAL_OUTPUT)&&::pinConfig(csn, DIGITAL_OUTPUT)))
+    return false;
+  if(!::pinConfig(irq, DIGITAL_INPUT, PULLUP))
+    m_irq = PINMAX; // Not connected, rely on poll()
+  ::pinWrite(csn, true);
+  ::pinWrite(ce, false);
+  // Power down and verify the module is present
+  writeRegister(NRF_CONFIG, 0);
+  writeRegister(NRF_SETUP_AW, 0x03); // 5 byte addresses
+  if(readRegister(NRF_SETUP_AW)!=0x03)
+    return false;
+  // Auto acknowledge and dynamic payloads on pipes 0 (ack) and 1 (data)
+  writeRegister(NRF_EN_AA, NRF_PIPES);
+  writeRegister(NRF_EN_RXADDR, NRF_PIPES);
+  writeRegister(NRF_SETUP_RETR, (NRF_RETRY_DELAY << 4) | NRF_RETRY_COUNT);
+  writeRegister(NRF_RF_CH, channel);
+  writeRegister(NRF_RF_SETUP, NRF_RF_SETUP_1M);
+  writeRegister(NRF_FEATURE, 0x04); // EN_DPL
+  writeRegister(NRF_DYNPD, NRF_PIPES);
+  command(NRF_FLUSH_TX, NULL, NULL, 0);
+  command(NRF_FLUSH_RX, NULL, NULL, 0);
+  writeRegister(NRF_STATUS, STATUS_IRQ);
+  // Power up and start listening
+  writeRegister(NRF_CONFIG, CONFIG_DEFAULT | CONFIG_PRIM_RX);
+  delay(2, MILLISECOND);
+  g_pRadio = this;
+  if((m_irq!=PINMAX)&&!::pinAttach(m_irq, EDGE_FALLING, interruptHandler, 0)) {
+    g_pRadio = NULL;
+    writeRegister(NRF_CONFIG, 0);
+    return false;
+    }
+  setMode(false);
+  return true;
+  }
+
+/** Set the address this node receives on
+ *
+ * @param pAddress the address (NRF_ADDRESS_SIZE bytes).
+ */
+void NRF24L01::setAddress(const uint8_t *pAddress) {
+  command(NRF_W_REGISTER | NRF_RX_ADDR_P1, pAddress, NULL, NRF_ADDRESS_SIZE);
+  }
+
+/** Set the address to send packets to
+ *
+ * The same address is used on pipe 0 to receive the acknowledgements.
+ *
+ * @param pAddress the address (NRF_ADDRESS_SIZE bytes).
+ */
+void NRF24L01::setTarget(const uint8_t *pAddress) {
+  command(NRF_W_REGISTER | NRF_TX_ADDR, pAddress, NULL, NRF_ADDRESS_SIZE);
+  command(NRF_W_REGISTER | NRF_RX_ADDR_P0, pAddress, NULL, NRF_ADDRESS_SIZE);
+  }
+
+/** Set the transmit power
+ *
+ * @param level the power level from 0 (-18dBm) to 3 (0dBm, the default).
+ */
+void NRF24L01::setPower(uint8_t level) {
+  if(level>3)
+    level = 3;
+  writeRegister(NRF_RF_SETUP, (NRF_RF_SETUP_1M & ~NRF_RF_PWR) | (level << 1));
+  }
+
+/** Queue a payload for transmission
+ *
+ * The payload is copied to the transmit queue and sent in the background,
+ * each payload is written to the module in a single SPI transfer. Use
+ * sending() to determine when the queue is empty and sent()/lost() to check
+ * the results.
+ *
+ * @param pData the payload to send.
+ * @param length the size of the payload (1 to NRF_PAYLOAD_MAX bytes).
+ *
+ * @return true if the payload was queued, false if the transmit queue is
+ *         full or the length is invalid.
+ */
+bool NRF24L01::send(const uint8_t *pData, int length) {
+  if((g_pRadio!=this)||(length<=0)||(length>NRF_PAYLOAD_MAX))
+    return false;
+  if(m_txCount==NRF_TX_QUEUE)
+    return false;
+  NRF_PACKET *pPacket = &m_txQueue[(m_txHead + m_txCount++) % NRF_TX_QUEUE];
+  pPacket->m_length = length;
+  memcpy(pPacket->m_data, pData, length);
+  if(m_txCount==1)
+    loadPayload();
+  return true;
+  }
+
+/** Service the module without an interrupt
+ *
+ * Must be called regularly from the main loop if the IRQ line is not
+ * connected, otherwise it only handles events the interrupt has not seen
+ * yet. Does nothing while the module is powered down.
+ */
+void NRF24L01::poll() {
+  if((g_pRadio!=this)||!m_powered)
+    return;
+  if((m_irq==PINMAX)||!::pinRead(m_irq))
+    processInterrupt();
+  }
+
+/** Power down the module
+ *
+ * Clears PWR_UP and drives CE low, the module draws about 1uA until the
+ * next call to powerUp() or send(). A payload being sent is held in the
+ * module and sent after power up, received packets already in the queue
+ * are kept.
+ */
+void NRF24L01::powerDown() {
+  if((g_pRadio!=this)||!m_powered)
+    return;
+  ::pinWrite(m_ce, false);
+  writeRegister(NRF_CONFIG, CONFIG_DEFAULT & ~CONFIG_PWR_UP);
+  m_powered = false;
+  energyActive(ENERGY_RADIO_TX, false);
+  energyActive(ENERGY_RADIO_RX, false);
+  }
+
+/** Power up the module
+ *
+ * Returns to transmit mode if payloads are queued, otherwise starts
+ * listening. This does not block, the module starts operating 1.5ms later.
+ */
+void NRF24L01::powerUp() {
+  if((g_pRadio!=this)||m_powered)
+    return;
+  setMode(m_txCount!=0);
+  }
+
+/** Get the next received packet
+ *
+ * @param pData the buffer to receive the payload.
+ * @param size the size of the buffer. Longer payloads are truncated.
+ *
+ * @return the length of the payload or 0 if no packets are available.
+ */
+int NRF24L01::receive(uint8_t *pData, int size) {
+  if(m_rxCount==0)
+    return 0;
+  NRF_PACKET *pPacket = &m_rxQueue[m_rxHead];
+  int length = (pPacket->m_length<size) ? pPacket->m_length : size;
+  memcpy(pData, pPacket->m_data, length);
+  m_rxHead = (m_rxHead + 1) % NRF_RX_QUEUE;
+  m_rxCount--;
+  return length;
+  }
@@ -135,6 +135,13 @@
 #define FLASH_OBR	REGISTER_32(FLASH_BASE + 0x1c)
 #define FLASH_WRPR	REGISTER_32(FLASH_BASE + 0x20)
 
+// Flash geometry (erase and write units in bytes)
+#define FLASH_PAGE_SIZE		1024
+#define FLASH_BLOCK_SIZE	4
+
+// Size of the 'config' region in stm32f030.ld (bytes)
+#define CONFIG_SIZE		2048
+
 // RCC registers
 #define RCC_CR 		REGISTER_32(RCC_BASE + 0)
 #define RCC_CFGR	REGISTER_32(RCC_BASE + 4)
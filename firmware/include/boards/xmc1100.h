@@ -22,6 +22,13 @@
 #define TICKS_PER_SECOND 10000L
 #define TICKS_MAX        0xffffffffL
 
+// Flash geometry (erase and write units in bytes)
+#define FLASH_PAGE_SIZE  256
+#define FLASH_BLOCK_SIZE 16
+
+// Size of the 'config' region in xmc1100.ld (bytes)
+#define CONFIG_SIZE      2048
+
 #define NVIC_BASE 		0xe000e100
 #define SCS_BASE		0xe000ed00
 #define STK_BASE		0xe000e010
@@ -57,8 +64,31 @@
 #define NVIC_IPR6		REGISTER_32(NVIC_BASE + 0x318)
 #define NVIC_IPR7		REGISTER_32(NVIC_BASE + 0x31c)
 
+// NVM
+#define NVM_NVMSTATUS	REGISTER_32(NVM_BASE + 0x00)
+#define NVM_NVMPROG		REGISTER_32(NVM_BASE + 0x04)
+#define NVM_NVMCONF		REGISTER_32(NVM_BASE + 0x08)
+
+// Interrupt numbers (NVIC bit positions)
+#define IRQ_SCU_SR1		1
+#define IRQ_ERU0_SR0	3
+#define IRQ_ERU0_SR1	4
+#define IRQ_ERU0_SR2	5
+#define IRQ_ERU0_SR3	6
+#define IRQ_USIC0_SR0	9
+#define IRQ_USIC0_SR1	10
+#define IRQ_USIC0_SR2	11
+#define IRQ_USIC0_SR3	12
+#define IRQ_USIC0_SR4	13
+#define IRQ_USIC0_SR5	14
+#define IRQ_VADC0_C0_SR0	15
+#define IRQ_VADC0_C0_SR1	16
+#define IRQ_CCU40_SR0	21
+
 // SCS
 #define CPUID			REGISTER_32(SCS_BASE + 0)
+#define AIRCR			REGISTER_32(SCS_BASE + 0x0c)
+#define SCR				REGISTER_32(SCS_BASE + 0x10)
 // STK
 #define SYST_CSR		REGISTER_32(STK_BASE + 0)
 #define SYST_RVR		REGISTER_32(STK_BASE + 4)
@@ -75,6 +105,9 @@
 #define EXOCON1			REGISTER_32(ERU0_BASE + 0x24)
 #define EXOCON2			REGISTER_32(ERU0_BASE + 0x28)
 #define EXOCON3			REGISTER_32(ERU0_BASE + 0x2c)
+// EXICONx and EXOCONx as arrays of 4 words (index 0 to 3)
+#define EXICON			PTR_32(ERU0_BASE + 0x10)
+#define EXOCON			PTR_32(ERU0_BASE + 0x20)
 
 // PAU
 #define AVAIL0			REGISTER_32(PAU_BASE + 0x40)
@@ -236,23 +269,23 @@
 #define USIC0_CH1_IN		PTR_32(USIC0_CH1_BASE + 0x180)
 
 // VADC0
-#define VADC0_ID		REGISTER_32(VADC_BASE + 0x008)
-#define VADC0_CLC		REGISTER_32(VADC_BASE + 0x000)
-#define VADC0_OCS		REGISTER_32(VADC_BASE + 0x028)
-#define VADC0_GLOBCFG	REGISTER_32(VADC_BASE + 0x080)
-#define VADC0_BRSCTRL	REGISTER_32(VADC_BASE + 0x200)
-#define VADC0_BRSMR		REGISTER_32(VADC_BASE + 0x204)
-#define VADC0_BRSSEL0	REGISTER_32(VADC_BASE + 0x180)
-#define VADC0_BRSSEL1	REGISTER_32(VADC_BASE + 0x184)
-#define VADC0_BRSPND0	REGISTER_32(VADC_BASE + 0x1c0)
-#define VADC0_BRSPND1	REGISTER_32(VADC_BASE + 0x1c4)
-#define VADC0_GLOBICLASS0	REGISTER_32(VADC_BASE + 0x0a0)
-#define VADC0_GLOBICLASS1	REGISTER_32(VADC_BASE + 0x0a4)
-#define VADC0_GLOBRCR	REGISTER_32(VADC_BASE + 0x280)
-#define VADC0_GLOBRES	REGISTER_32(VADC_BASE + 0x300)
-#define VADC0_GLOBRESD	REGISTER_32(VADC_BASE + 0x380)
-#define VADC0_GLOBEFLAG	REGISTER_32(VADC_BASE + 0x0e0)
-#define VADC0_GLOBEVNP	REGISTER_32(VADC_BASE + 0x140)
+#define VADC0_ID		REGISTER_32(VADC0_BASE + 0x008)
+#define VADC0_CLC		REGISTER_32(VADC0_BASE + 0x000)
+#define VADC0_OCS		REGISTER_32(VADC0_BASE + 0x028)
+#define VADC0_GLOBCFG	REGISTER_32(VADC0_BASE + 0x080)
+#define VADC0_BRSCTRL	REGISTER_32(VADC0_BASE + 0x200)
+#define VADC0_BRSMR		REGISTER_32(VADC0_BASE + 0x204)
+#define VADC0_BRSSEL0	REGISTER_32(VADC0_BASE + 0x180)
+#define VADC0_BRSSEL1	REGISTER_32(VADC0_BASE + 0x184)
+#define VADC0_BRSPND0	REGISTER_32(VADC0_BASE + 0x1c0)
+#define VADC0_BRSPND1	REGISTER_32(VADC0_BASE + 0x1c4)
+#define VADC0_GLOBICLASS0	REGISTER_32(VADC0_BASE + 0x0a0)
+#define VADC0_GLOBICLASS1	REGISTER_32(VADC0_BASE + 0x0a4)
+#define VADC0_GLOBRCR	REGISTER_32(VADC0_BASE + 0x280)
+#define VADC0_GLOBRES	REGISTER_32(VADC0_BASE + 0x300)
+#define VADC0_GLOBRESD	REGISTER_32(VADC0_BASE + 0x380)
+#define VADC0_GLOBEFLAG	REGISTER_32(VADC0_BASE + 0x0e0)
+#define VADC0_GLOBEVNP	REGISTER_32(VADC0_BASE + 0x140)
 
 // SHS0
 #define SHS0_ID			REGISTER_32(SHS0_BASE + 0x008)
@@ -268,6 +301,7 @@
 #define	TSE_ANATSEMON	REGISTER_32(TSE_BASE + 0x040)
 
 // CCU4
+#define CCU4_BASE			CCU40_BASE
 #define CCU4_GCTRL			REGISTER_32(CCU4_BASE + 0x0000)
 #define CCU4_GSTAT			REGISTER_32(CCU4_BASE + 0x0004)
 #define CCU4_GIDLS			REGISTER_32(CCU4_BASE + 0x0008)
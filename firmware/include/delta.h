@@ -0,0 +1,118 @@
+/*--------------------------------------------------------------------------*
+* SensNode Firmware Delta Format
+*---------------------------------------------------------------------------*/
+#ifndef __DELTA_H
+#define __DELTA_H
+
+/** @file delta.h
+ *
+ * Defines the format of the firmware deltas used for over the air updates.
+ * This file only depends on the standard integer types so it can be shared
+ * by the firmware and the host side tools.
+ *
+ * A delta rebuilds a new application image from the image the node is
+ * running (an image is the contents of flash from APP_START, the boot
+ * loader and the per node NODEID and TYPEID stored with it are not
+ * included so every node running a build has the same image). It starts with a DELTA_HEADER identifying both
+ * images by size and CRC32 (see deltaCrc()) followed by a sequence of
+ * commands. Each command is an opcode byte followed by its arguments as
+ * varints (7 bits per byte, least significant first, the top bit set on
+ * all but the last byte) -
+ *
+ *   DELTA_COPY length        - copy 'length' bytes from the old image at
+ *                              the current position (which then advances)
+ *   DELTA_DATA length bytes  - append 'length' literal bytes
+ *   DELTA_SEEK offset        - move the old image position by 'offset'
+ *                              (signed, zigzag encoded)
+ *   DELTA_END                - the new image is complete
+ *
+ * The output is written sequentially so the node can apply the delta as it
+ * arrives without buffering more than a flash page.
+ */
+
+// Required definitions
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Identifies a delta
+#define DELTA_MAGIC0 'S'
+#define DELTA_MAGIC1 'N'
+#define DELTA_MAGIC2 'D'
+#define DELTA_MAGIC3 'F'
+
+/** Delta header
+ *
+ * All values are least significant byte first.
+ */
+typedef struct _DELTA_HEADER {
+  uint8_t m_magic[4];   //!< DELTA_MAGIC0 to DELTA_MAGIC3
+  uint8_t m_oldSize[4]; //!< Size of the image the delta applies to
+  uint8_t m_newSize[4]; //!< Size of the image the delta produces
+  uint8_t m_oldCrc[4];  //!< CRC32 of the old image
+  uint8_t m_newCrc[4];  //!< CRC32 of the new image
+  } DELTA_HEADER;
+
+/** Delta commands
+ */
+typedef enum {
+  DELTA_END  = 0x00, //!< End of the delta
+  DELTA_COPY = 0x01, //!< Copy from the old image
+  DELTA_DATA = 0x02, //!< Literal data
+  DELTA_SEEK = 0x03, //!< Move the old image position
+  } DELTA_OP;
+
+// Longest varint (32 bits)
+#define DELTA_VARINT_MAX 5
+
+// Initial value for deltaCrcUpdate()
+#define DELTA_CRC_INIT 0xffffffff
+
+/** Add data to a CRC32 calculation
+ *
+ * Images are checked with the IEEE 802.3 CRC32 rather than crcData(), a 16
+ * bit check is too weak to protect a whole image. The CRC is calculated four
+ * bits at a time with a 16 entry table, about four times faster than the
+ * bitwise version for 64 bytes of table. Start with DELTA_CRC_INIT and
+ * complement the result once all the data has been added, an image can be
+ * checked in parts this way.
+ *
+ * @param crc the CRC so far.
+ * @param pData the data to add.
+ * @param length the number of bytes.
+ *
+ * @return the updated CRC.
+ */
+static inline uint32_t deltaCrcUpdate(uint32_t crc, const uint8_t *pData, uint32_t length) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+    0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+    0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+    };
+  while(length--) {
+    crc ^= *pData++;
+    crc = (crc >> 4) ^ table[crc & 0x0f];
+    crc = (crc >> 4) ^ table[crc & 0x0f];
+    }
+  return crc;
+  }
+
+/** Calculate the CRC32 of an image
+ *
+ * @param pData the image data.
+ * @param length the size of the image.
+ *
+ * @return the CRC32 of the image.
+ */
+static inline uint32_t deltaCrc(const uint8_t *pData, uint32_t length) {
+  return ~deltaCrcUpdate(DELTA_CRC_INIT, pData, length);
+  }
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __DELTA_H */
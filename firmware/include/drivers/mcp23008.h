@@ -4,6 +4,15 @@
 * 08-Sep-2015 ShaneG
 *
 * Provides a Digital interface using the 8 bit Microchip IO expanders.
+*
+* 19-Oct-2026
+*
+* The configuration and output registers are now cached in RAM. Changes are
+* written to the device by flush() or automatically at the end of each pass
+* through the main loop.
+*
+* Inputs can also be monitored with the interrupt-on-change feature, the INT
+* output of the expander is connected to one of the SensNode pins.
 *---------------------------------------------------------------------------*/
 #ifndef __MCP23008_H
 #define __MCP23008_H
@@ -11,7 +20,66 @@
 // Bring in required definitions
 #include <sensnode.h>
 
+class MCP23X08;
+
+/** Prototype for expander pin change callbacks
+ *
+ * @param pDevice the expander the change was detected on.
+ * @param pin the expander pin that changed (0 to 7).
+ * @param value the new state of the pin.
+ */
+typedef void (*FN_EXPANDERCHANGE)(MCP23X08 *pDevice, uint8_t pin, bool value);
+
+/** Common implementation for the MCP23008 and MCP23S08 expanders
+ *
+ * The IODIR, GPPU and OLAT registers are shadowed in RAM. Pin configuration
+ * and output changes only update the shadow copies, the modified registers
+ * are written to the device when flush() is called (which happens
+ * automatically at the end of every main loop pass once the device has been
+ * initialised). Several pin writes in the same loop therefore cost a single
+ * bus transaction.
+ */
 class MCP23X08 {
+  private:
+    uint8_t   m_iodir;   // Shadow of IODIR (1 = input)
+    uint8_t   m_gppu;    // Shadow of GPPU (1 = pullup enabled)
+    uint8_t   m_olat;    // Shadow of OLAT
+    uint8_t   m_gpinten; // Shadow of GPINTEN (1 = interrupt on change)
+    uint8_t   m_dirty;   // Registers that need to be written
+    uint8_t   m_inputs;  // Last known state of the monitored inputs
+    uint8_t   m_irq;     // SensNode pin connected to INT (PINMAX if none)
+    MCP23X08 *m_pNext;   // Next initialised device
+    FN_EXPANDERCHANGE m_pfnChange[8]; // Change callbacks for each pin
+
+    static void flushAll();
+    static void interruptHandler(PIN pin, bool value);
+    void processInterrupt();
+
+  protected:
+    /** Constructor
+     */
+    MCP23X08();
+
+    /** Write a sequence of registers
+     *
+     * @param reg the first register to write.
+     * @param pData the values to write.
+     * @param count the number of registers to write.
+     *
+     * @return true if the write succeeded.
+     */
+    virtual bool writeRegisters(uint8_t reg, const uint8_t *pData, int count) = 0;
+
+    /** Read a sequence of registers
+     *
+     * @param reg the first register to read.
+     * @param pData buffer to receive the values.
+     * @param count the number of registers to read.
+     *
+     * @return true if the read succeeded.
+     */
+    virtual bool readRegisters(uint8_t reg, uint8_t *pData, int count) = 0;
+
   public:
     /** Initialise the digital pin interface
      *
@@ -21,9 +89,12 @@ class MCP23X08 {
      *
      * @return true if the initialise succeeded.
      */
-    virtual bool init() = 0;
+    virtual bool init();
 
     /** Configure a GPIO pin
+     *
+     * Only DISABLED, DIGITAL_INPUT (with optional PULLUP) and DIGITAL_OUTPUT
+     * are supported. The change is applied by the next flush().
      *
      * @param pin the pin to configure
      * @param mode the requested mode for the pin
@@ -31,7 +102,7 @@ class MCP23X08 {
      *
      * @return true if the pin was configured as requested.
      */
-    virtual bool pinConfig(uint8_t pin, PIN_MODE mode, uint8_t flags) = 0;
+    bool pinConfig(uint8_t pin, PIN_MODE mode, uint8_t flags = 0);
 
     /** Read the value of a digital pin.
      *
@@ -42,18 +113,75 @@ class MCP23X08 {
      *
      * @return the current state of the pin.
      */
-    virtual bool pinRead(uint8_t pin) = 0;
+    bool pinRead(uint8_t pin);
 
     /** Change the state of a digital pin.
      *
      * To use this function the pin must be configured as DIGITAL_OUTPUT. If the
      * pin was configured for a different mode the function will have no effect.
+     * The new state is applied by the next flush().
      *
      * @param pin the pin to change the state of
      * @param value the value to set the pin to (true = high, false = low)
      */
-    virtual void pinWrite(uint8_t pin, bool value) = 0;
-  }
+    void pinWrite(uint8_t pin, bool value);
+
+    /** Change the state of several pins
+     *
+     * The new state is applied by the next flush().
+     *
+     * @param mask the pins to change (bit n = pin n).
+     * @param value the new values for those pins.
+     */
+    void writePort(uint8_t mask, uint8_t value);
+
+    /** Read the state of all pins
+     *
+     * Any pending changes are written first so the result reflects the
+     * current configuration.
+     *
+     * @return the value of the GPIO register (bit n = pin n).
+     */
+    uint8_t readPort();
+
+    /** Write any pending changes to the device
+     *
+     * @return true if all changes were written successfully.
+     */
+    bool flush();
+
+    /** Enable interrupt-on-change support
+     *
+     * Configures the SensNode pin connected to the INT output of the expander
+     * as an input and monitors it for changes. The device must have been
+     * initialised first.
+     *
+     * @param irq the SensNode pin connected to the INT output.
+     *
+     * @return true if the interrupt line could be monitored.
+     */
+    bool attachInterrupt(PIN irq);
+
+    /** Attach a change callback to an expander input
+     *
+     * The pin must be configured as DIGITAL_INPUT and attachInterrupt() must
+     * have been called. The callback is invoked from the main loop whenever
+     * the pin changes state. While a callback is attached pinRead() returns
+     * the state captured by the last interrupt without accessing the bus.
+     *
+     * @param pin the expander pin to monitor (0 to 7).
+     * @param pfnCallback the function to call when the pin changes.
+     *
+     * @return true if the callback was attached.
+     */
+    bool pinAttach(uint8_t pin, FN_EXPANDERCHANGE pfnCallback);
+
+    /** Remove a change callback from an expander input
+     *
+     * @param pin the expander pin to stop monitoring.
+     */
+    void pinDetach(uint8_t pin);
+  };
 
 /** Digital interface for the I2C version of the MCP23008 expander
  *
@@ -64,6 +192,10 @@ class MCP23008 : public MCP23X08 {
   private:
     uint8_t m_address; // Slave address of the expander
 
+  protected:
+    virtual bool writeRegisters(uint8_t reg, const uint8_t *pData, int count);
+    virtual bool readRegisters(uint8_t reg, uint8_t *pData, int count);
+
   public:
     /** Constructor
      *
@@ -83,37 +215,6 @@ class MCP23008 : public MCP23X08 {
      * @return true if the initialise succeeded.
      */
     virtual bool init();
-
-    /** Configure a GPIO pin
-     *
-     * @param pin the pin to configure
-     * @param mode the requested mode for the pin
-     * @param flags optional flags for the pin.
-     *
-     * @return true if the pin was configured as requested.
-     */
-    virtual bool pinConfig(uint8_t pin, PIN_MODE mode, uint8_t flags);
-
-    /** Read the value of a digital pin.
-     *
-     * To use this function the pin must be configured as DIGITAL_INPUT. If the pin
-     * was configured for a different mode the result will always be false.
-     *
-     * @param pin the pin to read
-     *
-     * @return the current state of the pin.
-     */
-    virtual bool pinRead(uint8_t pin);
-
-    /** Change the state of a digital pin.
-     *
-     * To use this function the pin must be configured as DIGITAL_OUTPUT. If the
-     * pin was configured for a different mode the function will have no effect.
-     *
-     * @param pin the pin to change the state of
-     * @param value the value to set the pin to (true = high, false = low)
-     */
-    virtual void pinWrite(uint8_t pin, bool value);
   };
 
 /** Digital interface for the SPI version of the MCP23S08 expander
@@ -125,6 +226,10 @@ class MCP23S08 : public MCP23X08 {
   private:
     PIN m_select;  // The select pin to use for the chip
 
+  protected:
+    virtual bool writeRegisters(uint8_t reg, const uint8_t *pData, int count);
+    virtual bool readRegisters(uint8_t reg, uint8_t *pData, int count);
+
   public:
     /** Constructor
      *
@@ -144,38 +249,6 @@ class MCP23S08 : public MCP23X08 {
      * @return true if the initialise succeeded.
      */
     virtual bool init();
-
-    /** Configure a GPIO pin
-     *
-     * @param pin the pin to configure
-     * @param mode the requested mode for the pin
-     * @param flags optional flags for the pin.
-     *
-     * @return true if the pin was configured as requested.
-     */
-    virtual bool pinConfig(uint8_t pin, PIN_MODE mode, uint8_t flags);
-
-    /** Read the value of a digital pin.
-     *
-     * To use this function the pin must be configured as DIGITAL_INPUT. If the pin
-     * was configured for a different mode the result will always be false.
-     *
-     * @param pin the pin to read
-     *
-     * @return the current state of the pin.
-     */
-    virtual bool pinRead(uint8_t pin);
-
-    /** Change the state of a digital pin.
-     *
-     * To use this function the pin must be configured as DIGITAL_OUTPUT. If the
-     * pin was configured for a different mode the function will have no effect.
-     *
-     * @param pin the pin to change the state of
-     * @param value the value to set the pin to (true = high, false = low)
-     */
-    virtual void pinWrite(uint8_t pin, bool value);
   };
 
 #endif /* __MCP23008_H */
-
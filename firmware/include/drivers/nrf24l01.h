@@ -3,6 +3,13 @@
 *---------------------------------------------------------------------------*
 * 31-Aug-2015 ShaneG
 *
+* 19-Oct-2026
+*
+* Interrupt driven driver using the hardware auto acknowledge and retransmit
+* support. Received packets are buffered in RAM and transmission does not
+* block the caller, payloads to send are queued in RAM and given to the
+* module one at a time. Boards without the IRQ line use poll() instead and
+* the module can be powered down while the radio is not needed.
 *---------------------------------------------------------------------------*/
 #ifndef __NRF24L01_H
 #define __NRF24L01_H
@@ -10,12 +17,170 @@
 // Bring in required definitions
 #include <sensnode.h>
 
+// Size of addresses and maximum payload size (in bytes)
+#define NRF_ADDRESS_SIZE 5
+#define NRF_PAYLOAD_MAX  32
+
+// Number of received packets that can be buffered
+#define NRF_RX_QUEUE     4
+
+// Number of payloads that can be queued for transmission
+#define NRF_TX_QUEUE     3
+
+/** Driver for the NRF24L01+ 2.4GHz transceiver
+ *
+ * The module is left in receive mode and switches to transmit mode while
+ * there are payloads in the transmit queue. Payloads use dynamic lengths and
+ * are automatically acknowledged and retransmitted by the module. Changes
+ * are signalled through the IRQ line and processed from the main loop, all
+ * received payloads are copied to a RAM queue.
+ *
+ * Only a single instance of the driver can be initialised.
+ */
 class NRF24L01 {
+  private:
+    /** A received packet
+     */
+    typedef struct _NRF_PACKET {
+      uint8_t m_length;
+      uint8_t m_data[NRF_PAYLOAD_MAX];
+      } NRF_PACKET;
+
+    PIN        m_ce;          // Transmitter enable
+    PIN        m_csn;         // Chip select
+    PIN        m_irq;         // Interrupt output
+    bool       m_transmit;    // True if in transmit mode
+    bool       m_powered;     // True if PWR_UP is set
+    uint8_t    m_rxHead;      // Next packet to return
+    uint8_t    m_rxCount;     // Number of packets in the queue
+    uint8_t    m_txHead;      // Payload being sent
+    uint8_t    m_txCount;     // Number of payloads waiting to be sent
+    uint16_t   m_sent;        // Packets acknowledged
+    uint16_t   m_lost;        // Packets dropped after all retries
+    uint16_t   m_overflow;    // Received packets dropped (queue full)
+    NRF_PACKET m_rxQueue[NRF_RX_QUEUE];
+    NRF_PACKET m_txQueue[NRF_TX_QUEUE];
+
+    static void interruptHandler(PIN pin, bool value);
+    void processInterrupt();
+    uint8_t command(uint8_t cmd, const uint8_t *pOutput, uint8_t *pInput, int count);
+    uint8_t readRegister(uint8_t reg);
+    void writeRegister(uint8_t reg, uint8_t value);
+    void setMode(bool transmit);
+    void loadPayload();
+
   public:
-    /** Initialise the driver on a specific SPI interface
+    /** Initialise the driver
+     *
+     * Configures the control pins, powers up the module and enters receive
+     * mode. This blocks for the power up delay of the module (about 2ms).
+     *
+     * @param ce the pin connected to CE.
+     * @param csn the pin connected to CSN.
+     * @param irq the pin connected to IRQ, PINMAX (or a pin that is not
+     *            available on the board) if the module is serviced by poll().
+     * @param channel the RF channel to use (0 to 125).
+     *
+     * @return true if the module was detected and initialised.
      */
-    bool init(PIN csn, PIN select);
-  }
+    bool init(PIN ce = PIN_CE, PIN csn = PIN_CSN, PIN irq = PIN_IRQ, uint8_t channel = 76);
 
-#endif /* __NRF24L01_H */
+    /** Set the address this node receives on
+     *
+     * @param pAddress the address (NRF_ADDRESS_SIZE bytes).
+     */
+    void setAddress(const uint8_t *pAddress);
 
+    /** Set the address to send packets to
+     *
+     * The same address is used on pipe 0 to receive the acknowledgements.
+     *
+     * @param pAddress the address (NRF_ADDRESS_SIZE bytes).
+     */
+    void setTarget(const uint8_t *pAddress);
+
+    /** Set the transmit power
+     *
+     * @param level the power level from 0 (-18dBm) to 3 (0dBm, the default).
+     */
+    void setPower(uint8_t level);
+
+    /** Queue a payload for transmission
+     *
+     * The payload is copied to the transmit queue and sent in the background,
+     * each payload is written to the module in a single SPI transfer. Use
+     * sending() to determine when the queue is empty and sent()/lost() to
+     * check the results.
+     *
+     * @param pData the payload to send.
+     * @param length the size of the payload (1 to NRF_PAYLOAD_MAX bytes).
+     *
+     * @return true if the payload was queued, false if the transmit queue is
+     *         full or the length is invalid.
+     */
+    bool send(const uint8_t *pData, int length);
+
+    /** Determine if there are payloads waiting to be sent
+     *
+     * @return true if the module is still transmitting.
+     */
+    bool sending() { return m_txCount!=0; }
+
+    /** Service the module without an interrupt
+     *
+     * Must be called regularly from the main loop if the IRQ line is not
+     * connected, otherwise it only handles events the interrupt has not seen
+     * yet. Does nothing while the module is powered down.
+     */
+    void poll();
+
+    /** Power down the module
+     *
+     * Clears PWR_UP and drives CE low, the module draws about 1uA until the
+     * next call to powerUp() or send(). A payload being sent is held in the
+     * module and sent after power up, received packets already in the queue
+     * are kept.
+     */
+    void powerDown();
+
+    /** Power up the module
+     *
+     * Returns to transmit mode if payloads are queued, otherwise starts
+     * listening. This does not block, the module starts operating 1.5ms
+     * later.
+     */
+    void powerUp();
+
+    /** Determine if the module is powered up
+     */
+    bool powered() { return m_powered; }
+
+    /** Get the number of received packets waiting
+     *
+     * @return the number of packets in the receive queue.
+     */
+    int available() { return m_rxCount; }
+
+    /** Get the next received packet
+     *
+     * @param pData the buffer to receive the payload.
+     * @param size the size of the buffer. Longer payloads are truncated.
+     *
+     * @return the length of the payload or 0 if no packets are available.
+     */
+    int receive(uint8_t *pData, int size);
+
+    /** Get the number of payloads that have been acknowledged
+     */
+    uint16_t sent() { return m_sent; }
+
+    /** Get the number of payloads dropped after all retries
+     */
+    uint16_t lost() { return m_lost; }
+
+    /** Get the number of received payloads dropped because the queue was full
+     */
+    uint16_t overflow() { return m_overflow; }
+  };
+
+#endif /* __NRF24L01_H */
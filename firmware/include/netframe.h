@@ -0,0 +1,362 @@
+/*--------------------------------------------------------------------------*
+* SensNode Network Frame Format
+*---------------------------------------------------------------------------*/
+#ifndef __NETFRAME_H
+#define __NETFRAME_H
+
+/** @file netframe.h
+ *
+ * Defines the over the air frame format used between SensNode devices and
+ * the base station. This file only depends on the standard integer types so
+ * it can be shared by the firmware and the host side tools.
+ *
+ * The network is a simple star. Every frame fits in a single NRF24L01
+ * payload and consists of a 4 byte header, up to NET_PAYLOAD_MAX bytes of
+ * payload and a CCITT CRC16 (see crcData()) calculated over the header and
+ * payload. All multi-byte values are sent least significant byte first.
+ *
+ * A node joins the network by sending NET_JOIN (containing its NODEID) to
+ * the gateway. The gateway replies with NET_ACCEPT (containing the NODEID
+ * and the assigned 16 bit address) and the node then reports its TYPEID
+ * with NET_TYPE. Sensor readings are sent in NET_READINGS frames which
+ * carry up to NET_READINGS_MAX readings each.
+ *
+ * Connected nodes keep their clocks in step with the gateway by sending
+ * NET_TIME_REQUEST with their local tick count. The gateway echoes the
+ * value back in NET_TIME_RESPONSE along with the times it received the
+ * request and sent the response so the node can remove the round trip
+ * delay from the result.
+ *
+ * Access to the radio is shared with a TDMA schedule. Network time is split
+ * into superframes of m_slotCount slots, each m_slotTime milliseconds long,
+ * with the first superframe starting at 1/1/1970. The gateway assigns every
+ * node a slot in NET_ACCEPT and, once its clock is synchronised, the node
+ * only transmits during the first half of that slot (see netSlotStart()).
+ * NET_JOIN is the exception, it is sent whenever the node needs to.
+ *
+ * Readings made while a node cannot reach the gateway are stored with a
+ * timestamp and uploaded later in NET_SAMPLES frames. The payload is a
+ * sequence of records (see netSampleEncode()) holding the channel, the
+ * change in time since the previous record and the change in value since
+ * the previous record for the same channel, both as zigzag varints. The
+ * first record in each frame is relative to a time and values of zero so
+ * every frame can be decoded on its own.
+ *
+ * Firmware updates are offered to a node in NET_UPDATE_OFFER after a time
+ * response. The offer identifies a delta (see delta.h) by the size and CRC
+ * of the image it applies to and the image it produces (the values from
+ * the DELTA_HEADER). A node that can
+ * apply the delta replies with NET_UPDATE_STATUS (NET_UPDATE_ACCEPTED) and
+ * then fetches it with NET_UPDATE_REQUEST frames, one at a time, each
+ * answered by a NET_UPDATE_DATA frame holding up to NET_UPDATE_DATA_MAX
+ * bytes from the requested offset. The update ends with a final
+ * NET_UPDATE_STATUS from the node. Update frames are not restricted to the
+ * transmit slot.
+ */
+
+// Required definitions
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame layout
+#define NET_FRAME_MAX       32
+#define NET_HEADER_SIZE     4
+#define NET_CRC_SIZE        2
+#define NET_PAYLOAD_MAX     (NET_FRAME_MAX - NET_HEADER_SIZE - NET_CRC_SIZE)
+
+// Size of the NODEID and TYPEID values
+#define NET_UUID_SIZE       16
+
+// Special node addresses
+#define NET_ADDRESS_NONE    0x0000 //!< Not yet joined
+#define NET_ADDRESS_GATEWAY 0xffff //!< The base station
+
+// Size of radio addresses
+#define NET_RADIO_ADDRESS   5
+
+/** Marker values for the NODEID and TYPEID
+ *
+ * The firmware is built with these values in place of the identifiers so
+ * the flashing tool can locate and replace them in the image.
+ */
+#define NET_NODEID_MARKER { '#', 'S', 'E', 'N', 'S', 'N', 'O', 'D', 'E', '-', 'N', 'O', 'D', 'E', 'I', 'D' }
+#define NET_TYPEID_MARKER { '#', 'S', 'E', 'N', 'S', 'N', 'O', 'D', 'E', '-', 'T', 'Y', 'P', 'E', 'I', 'D' }
+
+/** Frame types
+ */
+typedef enum {
+  NET_JOIN           = 0x01, //!< Node -> gateway: NODEID
+  NET_ACCEPT         = 0x02, //!< Gateway -> node: NODEID, address
+  NET_TYPE           = 0x03, //!< Node -> gateway: TYPEID
+  NET_TIME_REQUEST   = 0x04, //!< Node -> gateway: origin (node ticks, 32 bits)
+  NET_TIME_RESPONSE  = 0x05, //!< Gateway -> node: NET_TIME_PAYLOAD
+  NET_UPDATE_OFFER   = 0x06, //!< Gateway -> node: NET_UPDATE_OFFER_PAYLOAD
+  NET_UPDATE_DATA    = 0x07, //!< Gateway -> node: offset (32 bits), delta bytes
+  NET_READINGS       = 0x10, //!< Node -> gateway: sequence of NET_READING
+  NET_SAMPLES        = 0x11, //!< Node -> gateway: timestamped sample records
+  NET_UPDATE_REQUEST = 0x12, //!< Node -> gateway: offset (32 bits)
+  NET_UPDATE_STATUS  = 0x13, //!< Node -> gateway: NET_UPDATE_RESULT
+  } NET_FRAME_TYPE;
+
+/** Result of a firmware update (sent in NET_UPDATE_STATUS)
+ */
+typedef enum {
+  NET_UPDATE_ACCEPTED = 0x00, //!< The delta will be fetched
+  NET_UPDATE_REJECTED = 0x01, //!< The delta does not apply to this node
+  NET_UPDATE_FAILED   = 0x02, //!< The delta was corrupt or could not be stored
+  NET_UPDATE_COMPLETE = 0x03, //!< The new image is stored, the node is restarting
+  } NET_UPDATE_RESULT;
+
+/** Frame header
+ *
+ * The address is the node address for both directions (the source for
+ * frames sent by a node, the destination for frames sent by the gateway).
+ */
+typedef struct _NET_HEADER {
+  uint8_t m_type;       //!< Frame type (NET_FRAME_TYPE)
+  uint8_t m_sequence;   //!< Sequence number (per sender)
+  uint8_t m_address[2]; //!< Node address
+  } NET_HEADER;
+
+/** Payload of a NET_ACCEPT frame
+ */
+typedef struct _NET_ACCEPT_PAYLOAD {
+  uint8_t m_nodeID[NET_UUID_SIZE]; //!< NODEID of the joining node
+  uint8_t m_address[2];            //!< Address assigned to the node
+  uint8_t m_slot[2];               //!< Transmit slot assigned to the node
+  uint8_t m_slotCount[2];          //!< Slots per superframe (0 = no schedule)
+  uint8_t m_slotTime[2];           //!< Length of a slot (milliseconds)
+  } NET_ACCEPT_PAYLOAD;
+
+/** A point in time (gateway clock)
+ */
+typedef struct _NET_TIME {
+  uint8_t m_seconds[4]; //!< Seconds since 1/1/1970
+  uint8_t m_millis[2];  //!< Milliseconds (0 to 999)
+  } NET_TIME;
+
+/** Payload of a NET_TIME_RESPONSE frame
+ */
+typedef struct _NET_TIME_PAYLOAD {
+  uint8_t  m_origin[4]; //!< Value sent in the NET_TIME_REQUEST
+  NET_TIME m_receive;   //!< Time the request was received
+  NET_TIME m_transmit;  //!< Time the response was sent
+  } NET_TIME_PAYLOAD;
+
+/** Payload of a NET_UPDATE_OFFER frame
+ */
+typedef struct _NET_UPDATE_OFFER_PAYLOAD {
+  uint8_t m_oldSize[4]; //!< Size of the image the delta applies to
+  uint8_t m_newSize[4]; //!< Size of the image the delta produces
+  uint8_t m_oldCrc[4];  //!< CRC32 of the old image
+  uint8_t m_newCrc[4];  //!< CRC32 of the new image
+  uint8_t m_length[4];  //!< Size of the delta (including the header)
+  } NET_UPDATE_OFFER_PAYLOAD;
+
+// Delta bytes carried by a NET_UPDATE_DATA frame
+#define NET_UPDATE_DATA_MAX (NET_PAYLOAD_MAX - 4)
+
+/** A single sensor reading
+ */
+typedef struct _NET_READING {
+  uint8_t m_channel;  //!< Application defined channel number
+  uint8_t m_value[2]; //!< Signed 16 bit value
+  } NET_READING;
+
+// Number of readings that fit in a single frame
+#define NET_READINGS_MAX    (NET_PAYLOAD_MAX / sizeof(NET_READING))
+
+// Channels tracked for value deltas in a NET_SAMPLES frame
+#define NET_SAMPLE_CHANNELS 8
+
+// Largest encoded sample record (channel, 5 byte time, 3 byte value)
+#define NET_SAMPLE_RECORD_MAX 9
+
+/** Encoder/decoder state for sample records
+ *
+ * Holds the time of the previous record and the previous value for up to
+ * NET_SAMPLE_CHANNELS channels (in the order they first appear). Values for
+ * further channels are encoded relative to zero.
+ */
+typedef struct _NET_SAMPLE_STATE {
+  uint32_t m_time;                           //!< Time of the previous record
+  uint8_t  m_channels;                       //!< Number of channels tracked
+  uint8_t  m_channel[NET_SAMPLE_CHANNELS];   //!< Channel numbers
+  int16_t  m_value[NET_SAMPLE_CHANNELS];     //!< Previous value for each channel
+  } NET_SAMPLE_STATE;
+
+/** Read a 16 bit value from a frame
+ */
+static inline uint16_t netGet16(const uint8_t *pData) {
+  return (uint16_t)(pData[0] | (pData[1] << 8));
+  }
+
+/** Write a 16 bit value into a frame
+ */
+static inline void netPut16(uint8_t *pData, uint16_t value) {
+  pData[0] = (uint8_t)value;
+  pData[1] = (uint8_t)(value >> 8);
+  }
+
+/** Read a 32 bit value from a frame
+ */
+static inline uint32_t netGet32(const uint8_t *pData) {
+  return (uint32_t)netGet16(pData) | ((uint32_t)netGet16(&pData[2]) << 16);
+  }
+
+/** Write a 32 bit value into a frame
+ */
+static inline void netPut32(uint8_t *pData, uint32_t value) {
+  netPut16(pData, (uint16_t)value);
+  netPut16(&pData[2], (uint16_t)(value >> 16));
+  }
+
+/** Generate the radio address for a node or the gateway
+ *
+ * Nodes that have not yet joined use an address derived from the last two
+ * bytes of their NODEID (which are random for version 4 UUIDs).
+ *
+ * @param pRadio buffer to receive the NET_RADIO_ADDRESS byte address.
+ * @param address the node address (or NET_ADDRESS_NONE / NET_ADDRESS_GATEWAY).
+ * @param pNodeID the NODEID (only used if address is NET_ADDRESS_NONE).
+ */
+static inline void netRadioAddress(uint8_t *pRadio, uint16_t address, const uint8_t *pNodeID) {
+  pRadio[0] = 'S';
+  pRadio[1] = 'N';
+  if(address==NET_ADDRESS_NONE) {
+    pRadio[2] = 'J';
+    pRadio[3] = pNodeID[NET_UUID_SIZE - 2];
+    pRadio[4] = pNodeID[NET_UUID_SIZE - 1];
+    }
+  else {
+    pRadio[2] = (address==NET_ADDRESS_GATEWAY) ? 'G' : 'N';
+    netPut16(&pRadio[3], address);
+    }
+  }
+
+/** Find the start of the next transmit slot for a node
+ *
+ * @param time the network time (milliseconds since 1/1/1970).
+ * @param slot the slot assigned to the node.
+ * @param slotCount the number of slots per superframe (must not be 0).
+ * @param slotTime the length of a slot in milliseconds.
+ *
+ * @return the network time the next slot starts at (at or after time).
+ */
+static inline uint64_t netSlotStart(uint64_t time, uint16_t slot, uint16_t slotCount, uint16_t slotTime) {
+  uint32_t superframe = (uint32_t)slotCount * slotTime;
+  uint64_t start = time - (time % superframe) + ((uint32_t)slot * slotTime);
+  if(start<time)
+    start += superframe;
+  return start;
+  }
+
+/** Reset the sample record state
+ *
+ * @param pState the state to reset (start of a frame or buffer).
+ */
+static inline void netSampleReset(NET_SAMPLE_STATE *pState) {
+  pState->m_time = 0;
+  pState->m_channels = 0;
+  }
+
+/** Find the previous value for a channel
+ *
+ * Channels are added to the state as they are seen until it is full.
+ *
+ * @param pState the encoder or decoder state.
+ * @param channel the channel number.
+ *
+ * @return the index of the channel in the state or -1 if it is not tracked.
+ */
+static inline int netSampleChannel(NET_SAMPLE_STATE *pState, uint8_t channel) {
+  int index;
+  for(index=0; index<pState->m_channels; index++) {
+    if(pState->m_channel[index]==channel)
+      return index;
+    }
+  if(index==NET_SAMPLE_CHANNELS)
+    return -1;
+  pState->m_channel[index] = channel;
+  pState->m_value[index] = 0;
+  pState->m_channels++;
+  return index;
+  }
+
+/** Encode a sample record
+ *
+ * @param pState the encoder state (updated).
+ * @param pData buffer to receive the record (NET_SAMPLE_RECORD_MAX bytes).
+ * @param channel the channel number.
+ * @param time the time of the sample (seconds since 1/1/1970).
+ * @param value the value of the sample.
+ *
+ * @return the size of the record.
+ */
+static inline int netSampleEncode(NET_SAMPLE_STATE *pState, uint8_t *pData, uint8_t channel, uint32_t time, int16_t value) {
+  int32_t delta[2];
+  int index = netSampleChannel(pState, channel);
+  int length = 0, field;
+  delta[0] = (int32_t)(time - pState->m_time);
+  delta[1] = (int32_t)value - ((index<0) ? 0 : pState->m_value[index]);
+  pData[length++] = channel;
+  for(field=0; field<2; field++) {
+    uint32_t zigzag = ((uint32_t)delta[field] << 1) ^ (uint32_t)(delta[field] >> 31);
+    while(zigzag>=0x80) {
+      pData[length++] = (uint8_t)(zigzag | 0x80);
+      zigzag >>= 7;
+      }
+    pData[length++] = (uint8_t)zigzag;
+    }
+  pState->m_time = time;
+  if(index>=0)
+    pState->m_value[index] = value;
+  return length;
+  }
+
+/** Decode a sample record
+ *
+ * @param pState the decoder state (updated).
+ * @param pData the encoded record.
+ * @param length the number of bytes available.
+ * @param pChannel receives the channel number.
+ * @param pTime receives the time of the sample.
+ * @param pValue receives the value of the sample.
+ *
+ * @return the size of the record or 0 if it is incomplete or invalid.
+ */
+static inline int netSampleDecode(NET_SAMPLE_STATE *pState, const uint8_t *pData, int length, uint8_t *pChannel, uint32_t *pTime, int16_t *pValue) {
+  int32_t delta[2];
+  int used = 0, field, index;
+  if(length<3)
+    return 0;
+  *pChannel = pData[used++];
+  for(field=0; field<2; field++) {
+    uint32_t zigzag = 0;
+    int shift;
+    for(shift=0; ; shift+=7) {
+      if((used>=length)||(shift>28))
+        return 0;
+      zigzag |= (uint32_t)(pData[used] & 0x7f) << shift;
+      if(!(pData[used++]&0x80))
+        break;
+      }
+    delta[field] = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    }
+  index = netSampleChannel(pState, *pChannel);
+  pState->m_time += (uint32_t)delta[0];
+  *pTime = pState->m_time;
+  *pValue = (int16_t)(((index<0) ? 0 : pState->m_value[index]) + delta[1]);
+  if(index>=0)
+    pState->m_value[index] = *pValue;
+  return used;
+  }
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __NETFRAME_H */
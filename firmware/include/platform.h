@@ -97,6 +97,405 @@ void initTICK();
  */
 void initSERIAL();
 
+/** Initialise the network subsystem
+ */
+void initNetwork();
+
+//---------------------------------------------------------------------------
+// Time keeping
+//---------------------------------------------------------------------------
+
+/** Advance the system tick count
+ *
+ * Used to account for periods where the tick timer was stopped (deep
+ * sleep for example).
+ *
+ * @param ticks the number of ticks to add.
+ */
+void tickAdvance(uint32_t ticks);
+
+/** Get the processor cycle count
+ *
+ * The Cortex-M0 has no cycle counter so the count is made up from the tick
+ * count and the current value of the SysTick counter. It wraps around every
+ * 2^32 cycles (about two minutes at 32MHz). Implemented by the target.
+ *
+ * @return the number of processor cycles since power up.
+ */
+uint32_t getCycles();
+
+/** Get the number of processor cycles in a tick
+ *
+ * Implemented by the target.
+ *
+ * @return the SysTick reload period in cycles.
+ */
+uint32_t getCyclesPerTick();
+
+//---------------------------------------------------------------------------
+// Profiling (only available if built with PROFILE defined)
+//---------------------------------------------------------------------------
+
+#ifdef PROFILE
+/** Record the duration of a single run of a profiled function
+ *
+ * @param slot the profile slot (PROFILE_SLOT).
+ * @param cycles the duration in processor cycles.
+ */
+void profileRecord(int slot, uint32_t cycles);
+
+/** Associate an identifier with a profile slot
+ *
+ * Used to record the address of the driver task in each task slot.
+ *
+ * @param slot the profile slot (PROFILE_SLOT).
+ * @param id the identifier to report with the slot.
+ */
+void profileTag(int slot, uint32_t id);
+
+/** Make a call and record how long it took
+ */
+#  define PROFILE_CALL(slot, call) \
+     do { uint32_t _start = getCycles(); call; profileRecord(slot, getCycles() - _start); } while(0)
+#else
+#  define PROFILE_CALL(slot, call) call
+#endif
+
+//---------------------------------------------------------------------------
+// Flash programming
+//
+// The reserved region between CONFIG_START and CONFIG_END (defined by the
+// linker script) is erased in FLASH_PAGE_SIZE pages and written in
+// FLASH_BLOCK_SIZE blocks. A block can only be written once after an erase.
+//---------------------------------------------------------------------------
+
+/** Erase a page of flash
+ *
+ * Target specific.
+ *
+ * @param pPage the address of the page (aligned to FLASH_PAGE_SIZE).
+ *
+ * @return true if the page was erased.
+ */
+bool flashErase(const void *pPage);
+
+/** Write a block of flash
+ *
+ * Target specific. The block must have been erased.
+ *
+ * @param pBlock the address of the block (aligned to FLASH_BLOCK_SIZE).
+ * @param pData the data to write (FLASH_BLOCK_SIZE bytes).
+ *
+ * @return true if the block was written and verified.
+ */
+bool flashWrite(const void *pBlock, const uint32_t *pData);
+
+//---------------------------------------------------------------------------
+// Firmware update
+//
+// The application is linked at APP_START. An update is built in the staging
+// area between UPDATE_START and UPDATE_END (defined by the linker script)
+// and announced with a boot record at BOOT_RECORD_START. The boot loader
+// copies the staging area over the application at the next reset.
+//---------------------------------------------------------------------------
+
+// Marks a boot record ("BOOT")
+#define BOOT_MAGIC      0x544f4f42
+
+/** Boot record
+ *
+ * Fits in a single 16 byte flash block.
+ */
+typedef struct _BOOT_RECORD {
+  uint32_t m_magic;    //!< BOOT_MAGIC if an update is waiting
+  uint32_t m_size;     //!< Size of the new image
+  uint32_t m_crc;      //!< CRC32 of the new image (see deltaCrc())
+  uint32_t m_check;    //!< Complement of m_crc
+  } BOOT_RECORD;
+
+// Results from updateCheck() and updateWrite()
+#define UPDATE_FAILED   -1 //!< The delta is invalid or the flash could not be written
+#define UPDATE_MORE      0 //!< More data is needed
+#define UPDATE_COMPLETE  1 //!< The new image has been staged
+
+/** Start applying a delta
+ *
+ * Checks the new image will fit. The running image must then be checked
+ * with 'updateCheck()' before the delta can be applied.
+ *
+ * @param oldSize the size of the image the delta applies to.
+ * @param newSize the size of the image the delta produces.
+ * @param oldCrc the CRC32 of the image the delta applies to.
+ * @param newCrc the CRC32 of the image the delta produces.
+ *
+ * @return true if the update was started.
+ */
+bool updateStart(uint32_t oldSize, uint32_t newSize, uint32_t oldCrc, uint32_t newCrc);
+
+/** Check the next part of the running image
+ *
+ * Called repeatedly after 'updateStart()' until the whole of the running
+ * image has been checked, each call only processes a small part of it.
+ *
+ * @return UPDATE_MORE if the check is still in progress, UPDATE_COMPLETE if
+ *         the delta applies to the running image or UPDATE_FAILED.
+ */
+int updateCheck();
+
+/** Apply the next part of the delta
+ *
+ * @param pData the delta bytes (following on from the previous call).
+ * @param length the number of bytes.
+ *
+ * @return UPDATE_MORE if more data is needed, UPDATE_COMPLETE once the new
+ *         image has been verified and the boot record written (restart to
+ *         install it) or UPDATE_FAILED.
+ */
+int updateWrite(const uint8_t *pData, int length);
+
+/** Abandon the update in progress
+ */
+void updateCancel();
+
+//---------------------------------------------------------------------------
+// Sample storage
+//---------------------------------------------------------------------------
+
+/** Clear the sample buffer
+ */
+void sampleReset();
+
+/** Add a sample to the buffer
+ *
+ * @param channel the channel number.
+ * @param value the value of the sample.
+ * @param time the time of the sample (seconds since 1/1/1970).
+ *
+ * @return true if the sample was stored.
+ */
+bool sampleStore(uint8_t channel, int16_t value, uint32_t time);
+
+/** Build a NET_SAMPLES payload from the oldest samples
+ *
+ * @param pPayload buffer to receive the payload.
+ * @param size the size of the buffer.
+ * @param pLength receives the length of the payload.
+ *
+ * @return the number of samples in the payload.
+ */
+int samplePack(uint8_t *pPayload, int size, int *pLength);
+
+/** Remove the oldest samples
+ *
+ * @param count the number of samples to remove.
+ */
+void sampleDrop(int count);
+
+//---------------------------------------------------------------------------
+// Retained state
+//---------------------------------------------------------------------------
+
+/** Check for retained state at startup
+ *
+ * Called once from 'main()' before any retained variables are used.
+ *
+ * @return true if the retained data is valid and this is a warm boot.
+ */
+bool retainRestore();
+
+//---------------------------------------------------------------------------
+// Indicator
+//---------------------------------------------------------------------------
+
+/** Pause the indicator
+ *
+ * Target specific. Called before and after deep sleep so the LED is not
+ * left on while the processor sleeps.
+ *
+ * @param suspend true to pause the indicator, false to resume it.
+ */
+void indicatorSuspend(bool suspend);
+
+//---------------------------------------------------------------------------
+// Network time
+//---------------------------------------------------------------------------
+
+/** Get the network time at a given tick count
+ *
+ * @param ticks the tick count.
+ *
+ * @return the network time in milliseconds since 1/1/1970 or 0 if the clock
+ *         has not been synchronised.
+ */
+uint64_t netTimeAt(uint32_t ticks);
+
+/** Update the network clock
+ *
+ * Called when a time response is received from the gateway.
+ *
+ * @param ticks the tick count when the response was received.
+ * @param time the gateway time (milliseconds since 1/1/1970) at that tick
+ *             count with the transmission delay removed.
+ */
+void netTimeUpdate(uint32_t ticks, uint64_t time);
+
+/** Align a wake up time with the transmit slot
+ *
+ * @param ticks the earliest tick count to wake at.
+ *
+ * @return the tick count at the start of the next slot (at or after the
+ *         requested time) or the requested time if there is no schedule.
+ */
+uint32_t netSlotAlign(uint32_t ticks);
+
+// Time the radio is powered up before the slot starts (milliseconds), the
+// module needs 1.5ms to start
+#define NET_WAKE_AHEAD 3
+
+/** Prepare the radio for sleep
+ *
+ * Gives queued frames a short time to be sent and powers the radio down.
+ */
+void netSleep();
+
+/** Power the radio up again after sleeping
+ *
+ * Called NET_WAKE_AHEAD milliseconds before the wake up time, the radio is
+ * only powered up if it will be needed.
+ */
+void netWake();
+
+//---------------------------------------------------------------------------
+// Pin change events
+//
+// These use the types from sensnode.h so are only available to C++ sources
+// that include it first (init.c does not need them).
+//---------------------------------------------------------------------------
+#ifdef __SENSNODE_H
+
+/** Enable edge detection for a pin
+ *
+ * Target specific. Routes the pin to an external interrupt line and enables
+ * the interrupt for the requested edges. When an edge is detected the
+ * interrupt handler must call pinEventSignal().
+ *
+ * @param pin the pin to monitor.
+ * @param edge the edges that should raise the interrupt.
+ *
+ * @return true if the interrupt was enabled, false if the pin cannot be used
+ *         or no interrupt lines are available.
+ */
+bool pinEventEnable(PIN pin, PIN_EDGE edge);
+
+/** Disable edge detection for a pin
+ *
+ * Target specific. Releases the interrupt line associated with the pin.
+ *
+ * @param pin the pin to stop monitoring.
+ */
+void pinEventDisable(PIN pin);
+
+/** Record an edge on a pin
+ *
+ * Called from the interrupt handler to queue a change event for the main
+ * loop. This is safe to call from interrupt context.
+ *
+ * @param pin the pin that generated the interrupt.
+ */
+void pinEventSignal(PIN pin);
+
+/** Deliver pending pin change events
+ *
+ * Called from the main loop to debounce queued edges and invoke the attached
+ * callbacks.
+ */
+void taskPinEvents();
+
+/** Determine if there are pin change events waiting
+ *
+ * @return true if an edge has been recorded but not yet delivered.
+ */
+bool pinEventPending();
+
+/** Enable or disable wake up on the WAKEUP pins
+ *
+ * Target specific. Called before and after deep sleep to monitor the pins
+ * configured with the WAKEUP flag that do not already have a change
+ * callback attached. Edges on these pins are recorded as pin change events.
+ *
+ * @param enable true before sleeping, false after waking.
+ */
+void pinWakeEnable(bool enable);
+
+/** Assign a pin to a peripheral function
+ *
+ * Target specific. Connects the pin to one of the alternate output functions
+ * of the processor and marks it as used (see pinMarkUsed()).
+ *
+ * @param pin the pin to assign.
+ * @param function the target specific alternate function number.
+ * @param openDrain true if the output should be open drain rather than
+ *                  push-pull.
+ *
+ * @return true if the pin was assigned, false if it is already in use.
+ */
+bool pinAlternate(PIN pin, uint8_t function, bool openDrain);
+
+#endif /* __SENSNODE_H */
+
+//---------------------------------------------------------------------------
+// Background tasks
+//---------------------------------------------------------------------------
+
+/** Deliver completed I2C transactions
+ *
+ * Called from the main loop to invoke the completion callbacks for any
+ * asynchronous I2C transactions that have finished.
+ */
+void taskI2C();
+
+/** Check if the I2C channel is idle
+ *
+ * Used before the USIC0 clock is stopped. A stalled bus is reset so the
+ * queue always drains.
+ *
+ * @return true if no transaction is in progress or queued.
+ */
+bool i2cIdle();
+
+/** Network processing
+ *
+ * Called from the main loop to process received frames, manage joining the
+ * network and send buffered readings.
+ */
+void taskNetwork();
+
+/** Battery monitoring
+ *
+ * Called from the main loop to sample the battery voltage when it is due.
+ */
+void taskBattery();
+
+//---------------------------------------------------------------------------
+// Power saving
+//---------------------------------------------------------------------------
+
+/** Stretch a sleep period to save power
+ *
+ * @param seconds the requested sleep period.
+ *
+ * @return the sleep period to use for the current battery level.
+ */
+uint32_t batteryStretch(uint32_t seconds);
+
+/** Set the radio transmit power
+ *
+ * A level set before the radio has started is applied when it starts.
+ *
+ * @param level the power level from 0 (lowest) to 3 (highest).
+ */
+void netPower(uint8_t level);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -93,7 +93,8 @@ void delay(uint32_t duration, TIMEUNIT units);
 // These functions are used to measure longer time periods related to the
 // current time of day. Each processor board features a real time clock which
 // is initialised to a common network time when the network link is
-// established. The accuracy of this time value depends on the network.
+// established (see 'netTime()'). The accuracy of this time value depends on
+// the network.
 //---------------------------------------------------------------------------
 
 /** Complete date time record.
@@ -190,6 +191,55 @@ typedef enum {
  */
 void shutdown();
 
+/** Place a variable in RAM that is kept over a warm restart
+ *
+ * Retained variables are not initialised at startup, their contents are
+ * only meaningful if 'warmBoot()' returns true.
+ */
+#define RETAINED __attribute__((section(".noinit")))
+
+/** Start up priorities
+ *
+ * Static constructors and STARTUP functions are run by 'init()' before
+ * 'main()' in priority order (lowest first), anything without a priority
+ * runs after all of them. Values up to 100 are reserved by the compiler.
+ */
+#define STARTUP_POWER       101 //!< Power latch (always first)
+#define STARTUP_PLATFORM    200 //!< Target hardware
+#define STARTUP_DRIVER      300 //!< Device drivers
+#define STARTUP_APPLICATION 400 //!< Application
+
+/** Run a function at startup
+ *
+ * Hardware can be set up once here instead of checking on every call.
+ *
+ * @param priority the start up priority (STARTUP_PLATFORM, etc).
+ */
+#define STARTUP(priority) __attribute__((constructor(priority)))
+
+/** Reset the processor
+ *
+ * A warm restart keeps the RETAINED variables, a cold restart behaves like a
+ * power cycle. This function does not return.
+ *
+ * The hardware is reset either way so static constructors, STARTUP functions,
+ * the power pin set up and 'setup()' always run again ('setup()' can use
+ * 'warmBoot()' to keep its RETAINED state). A warm restart only skips the
+ * start up indication and joining the network, use it to recover from an
+ * error without losing the connection or the stored samples. Waking from
+ * 'sleep()' does not reset the processor and never goes through this path.
+ *
+ * @param warm true to keep the retained state.
+ */
+void restart(bool warm);
+
+/** Determine if this is a warm boot
+ *
+ * @return true if the device was started by 'restart(true)' and the RETAINED
+ *         variables are valid.
+ */
+bool warmBoot();
+
 /** Put the processor into sleep mode
  *
  * This function puts the CPU into sleep mode for the specified period of
@@ -203,6 +253,10 @@ void shutdown();
  * trigger waking) this function will behave like the 'delay()' function using
  * SECONDS as the time unit.
  *
+ * If the node has been assigned a network transmit slot the sleep is
+ * extended to the start of the next slot so buffered readings are sent as
+ * soon as it wakes.
+ *
  * @param seconds the amount of time (in seconds) to sleep for
  */
 WAKE_REASON sleep(uint32_t seconds);
@@ -217,15 +271,310 @@ WAKE_REASON sleep(uint32_t seconds);
  * If a pattern is already running it will be terminated at the current step
  * and the new pattern started instead.
  *
- * @param pattern the 16 bit pattern to start.
+ * The pattern is stepped by a hardware timer so it does not use any time in
+ * the application loop and continues during 'delay()'. It is paused while
+ * the processor is in deep sleep.
+ *
+ * @param pattern the 16 bit pattern to start (the most significant bit is
+ *                the first step).
  * @param repeat if true the pattern will be repeated until a new pattern is
  *               set.
  */
 void indicate(uint16_t pattern, bool repeat);
 
+/** Set the brightness of the indicator LED
+ *
+ * The LED is driven with a PWM signal while it is on, lower levels reduce
+ * the current it draws.
+ *
+ * @param level the brightness from 0 (off) to 255 (fully on).
+ */
+void indicateBrightness(uint8_t level);
+
 //--- Some standard patterns
 #define PATTERN_FULL 0xffff
 
+/** Maximum number of background tasks that can be registered
+ */
+#define MAX_TASKS 4
+
+/** Prototype for background task functions
+ */
+typedef void (*FN_TASK)();
+
+/** Add a background task
+ *
+ * Background tasks are called at the end of every pass through the main loop
+ * (including the passes made while in 'delay()'). Drivers use them to write
+ * back buffered changes once the application loop has finished. Adding the
+ * same task more than once has no effect.
+ *
+ * @param pfnTask the function to call.
+ *
+ * @return true if the task was added, false if there is no more room.
+ */
+bool addTask(FN_TASK pfnTask);
+
+//---------------------------------------------------------------------------
+// Battery monitoring
+//
+// The battery voltage is sampled in the background, more often while it is
+// falling quickly. When it drops below BATTERY_LOW_MV the node starts saving
+// power ('sleep()' periods are doubled and the radio transmit power is
+// reduced), below BATTERY_CRITICAL_MV sleep periods are doubled again and
+// the radio uses its lowest power. Below BATTERY_CUTOFF_MV the node shuts
+// down. The thresholds can be changed at build time.
+//---------------------------------------------------------------------------
+
+/** Battery levels
+ */
+typedef enum {
+  BATTERY_NORMAL = 0, //!< No power saving
+  BATTERY_LOW,        //!< Below BATTERY_LOW_MV
+  BATTERY_CRITICAL,   //!< Below BATTERY_CRITICAL_MV
+  } BATTERY_LEVEL;
+
+/** Value returned by 'batteryRuntime()' if no estimate is available
+ */
+#define BATTERY_RUNTIME_UNKNOWN 0xffffffffUL
+
+/** Get the battery voltage
+ *
+ * @return the filtered battery voltage in millivolts or 0 if it has not
+ *         been measured yet.
+ */
+uint16_t batteryVoltage();
+
+/** Get the battery level
+ *
+ * @return the current battery level.
+ */
+BATTERY_LEVEL batteryLevel();
+
+/** Get the rate the battery voltage is changing
+ *
+ * @return the rate of change in millivolts per hour (negative while the
+ *         battery is discharging).
+ */
+int32_t batteryTrend();
+
+/** Estimate the remaining run time
+ *
+ * The estimate assumes the voltage keeps falling at the current rate.
+ *
+ * @return the estimated time until the battery reaches the cutoff voltage in
+ *         minutes or BATTERY_RUNTIME_UNKNOWN if the voltage is not falling.
+ */
+uint32_t batteryRuntime();
+
+//---------------------------------------------------------------------------
+// Configuration storage
+//
+// Small values (sample intervals, calibration constants, etc) can be kept in
+// flash so they survive a power cycle or a new firmware image. Each value is
+// identified by a key chosen by the application. Values are appended to a
+// log so changing one rarely needs a page erase, reading a value is a direct
+// lookup.
+//---------------------------------------------------------------------------
+
+// Number of keys available (0 to CONFIG_KEYS - 1), a value can be stored
+// for every key with room to spare in a bank
+#define CONFIG_KEYS 24
+
+// Largest value that can be stored (bytes)
+#define CONFIG_VALUE_MAX 26
+
+/** Read a configuration value
+ *
+ * @param key the key of the value (less than CONFIG_KEYS).
+ * @param pValue the buffer to receive the value.
+ * @param length the size of the buffer.
+ *
+ * @return the length of the stored value (which may be more than was copied)
+ *         or -1 if there is no value for the key.
+ */
+int configRead(uint8_t key, void *pValue, int length);
+
+/** Store a configuration value
+ *
+ * Writing the value that is already stored does not use any flash.
+ *
+ * @param key the key of the value (less than CONFIG_KEYS).
+ * @param pValue the value to store.
+ * @param length the length of the value (1 to CONFIG_VALUE_MAX bytes).
+ *
+ * @return true if the value was stored.
+ */
+bool configWrite(uint8_t key, const void *pValue, int length);
+
+/** Remove a configuration value
+ *
+ * @param key the key of the value to remove.
+ *
+ * @return true if there is no longer a value for the key.
+ */
+bool configDelete(uint8_t key);
+
+//---------------------------------------------------------------------------
+// Energy accounting
+//
+// The library records the time spent in each power state and combines it
+// with the typical supply current for that state to estimate the charge
+// used. The processor is always in exactly one of the ENERGY_LOOP to
+// ENERGY_SLEEP states, the peripheral states are counted independently
+// while the peripheral is active.
+//---------------------------------------------------------------------------
+
+/** Power states
+ */
+typedef enum {
+  ENERGY_LOOP = 0,  //!< Running the application ('setup()' and 'loop()')
+  ENERGY_TASKS,     //!< Running the library and driver background tasks
+  ENERGY_DELAY,     //!< Waiting in 'delay()' (including background tasks)
+  ENERGY_SLEEP,     //!< Processor in deep sleep
+  ENERGY_RADIO_TX,  //!< Radio transmitting
+  ENERGY_RADIO_RX,  //!< Radio listening
+  ENERGY_ADC,       //!< Analog converter running
+  ENERGY_STATES,    //!< Number of states (not a valid state)
+  } ENERGY_STATE;
+
+/** Change the processor power state
+ *
+ * Used by the library and drivers, must not be called from an interrupt
+ * handler.
+ *
+ * @param state the new processor state (ENERGY_LOOP to ENERGY_SLEEP).
+ *
+ * @return the previous processor state so it can be restored.
+ */
+ENERGY_STATE energySwitch(ENERGY_STATE state);
+
+/** Mark a peripheral as active or inactive
+ *
+ * Used by the library and drivers, must not be called from an interrupt
+ * handler.
+ *
+ * @param state the peripheral state (ENERGY_RADIO_TX to ENERGY_ADC).
+ * @param active true if the peripheral is now active.
+ */
+void energyActive(ENERGY_STATE state, bool active);
+
+/** Set the supply current for a state
+ *
+ * The defaults are typical datasheet figures and can be changed at build
+ * time (ENERGY_CURRENT_RUN, ENERGY_CURRENT_SLEEP, ENERGY_CURRENT_TX,
+ * ENERGY_CURRENT_RX and ENERGY_CURRENT_ADC) or with this function once the
+ * actual figures for a board have been measured.
+ *
+ * @param state the state to set the current for.
+ * @param microamps the supply current in that state.
+ */
+void energyCurrent(ENERGY_STATE state, uint32_t microamps);
+
+/** Get the time spent in a state
+ *
+ * @param state the state to query.
+ *
+ * @return the time spent in the state since the last 'energyReset()' in
+ *         milliseconds.
+ */
+uint32_t energyTime(ENERGY_STATE state);
+
+/** Get the estimated charge used
+ *
+ * @return the charge used since the last 'energyReset()' in microamp hours.
+ */
+uint32_t energyCharge();
+
+/** Get the estimated average supply current
+ *
+ * @return the average current since the last 'energyReset()' in microamps.
+ */
+uint32_t energyAverage();
+
+/** Clear the accumulated times
+ */
+void energyReset();
+
+/** Write an energy report to the serial port
+ *
+ * Lists the time and charge for each state followed by the totals and an
+ * energy estimate based on the ENERGY_SUPPLY_MV supply voltage.
+ */
+void energyPrint();
+
+/** Send the average current to the base station
+ *
+ * Queues a reading with the average supply current (in microamps, limited
+ * to 32767) on the given channel.
+ *
+ * @param channel the application defined channel number for the reading.
+ *
+ * @return true if the reading was queued.
+ */
+bool energySend(uint8_t channel);
+
+//---------------------------------------------------------------------------
+// Loop profiling
+//
+// When the library is built with PROFILE defined ('make PROFILE=1') the
+// duration of 'setup()', 'loop()', each background task and each complete
+// pass through the main loop is measured in processor cycles. Each slot
+// keeps the minimum, maximum and mean durations and a histogram with one
+// bucket per power of two.
+//---------------------------------------------------------------------------
+
+#ifdef PROFILE
+/** Profile slots
+ */
+typedef enum {
+  PROFILE_SETUP = 0, //!< 'setup()'
+  PROFILE_LOOP,      //!< 'loop()'
+  PROFILE_PINEVENTS, //!< Pin change delivery
+  PROFILE_I2C,       //!< I2C transaction completion
+  PROFILE_BATTERY,   //!< Battery monitoring
+  PROFILE_NETWORK,   //!< Network processing
+  PROFILE_TASK,      //!< First driver task (tagged with the task address)
+  PROFILE_PASS = PROFILE_TASK + MAX_TASKS, //!< A complete main loop pass
+  PROFILE_SLOTS,     //!< Number of slots (not a valid slot)
+  } PROFILE_SLOT;
+
+/** Number of histogram buckets
+ *
+ * Bucket 0 counts durations of 0 cycles, bucket n counts durations from
+ * 2^(n-1) to 2^n - 1 cycles. The last bucket also counts everything longer.
+ */
+#define PROFILE_BUCKETS 24
+
+/** Clear the collected profile
+ */
+void profileReset();
+
+/** Write the collected profile to the serial port
+ *
+ * The profile is written as a binary record, all values are sent least
+ * significant byte first:
+ *
+ *   'P', 'F'              - marker
+ *   uint8_t version       - format version (1)
+ *   uint8_t slots         - number of slots (PROFILE_SLOTS)
+ *   uint32_t cycles       - processor cycles per tick
+ *   uint32_t ticks        - ticks since the profile was reset
+ *
+ * followed by one entry for each slot:
+ *
+ *   uint32_t id           - task address (driver task slots) or 0
+ *   uint32_t count        - number of runs (the pass rate for PROFILE_PASS)
+ *   uint32_t min          - shortest run (cycles)
+ *   uint32_t max          - longest run (cycles)
+ *   uint32_t mean         - average run (cycles)
+ *   uint16_t histogram[]  - PROFILE_BUCKETS counts (saturating)
+ *
+ * and a CRC16 (see 'crcData()') of everything before it.
+ */
+void profileDump();
+#endif
+
 //---------------------------------------------------------------------------
 // GPIO interface
 //---------------------------------------------------------------------------
@@ -243,11 +592,12 @@ typedef enum {
   PIN_LATCH,      //!< Power latch output
   PIN_INDICATOR,  //!< Indicator LED output
   PIN_BATTERY,    //!< Battery voltage analog input
-  PIN_CE,         //!< Select pin for NRF24L01 module
-  PIN_CSN,        //!< Transmitter enable pin for NRF24L01 module
+  PIN_CE,         //!< Transmitter enable pin for NRF24L01 module
+  PIN_CSN,        //!< Select pin for NRF24L01 module
   PIN_SCK,        //!< Pin for SPI clock
   PIN_MISO,       //!< Pin for SPI input
   PIN_MOSI,       //!< Pin for SPI output
+  PIN_IRQ,        //!< Interrupt output from NRF24L01 module
   PINMAX
   } PIN;
 
@@ -330,18 +680,145 @@ void pinWrite(PIN pin, bool value);
  * The value returned by this function is always scaled to a full 16 bit value
  * regardless of the resolution of the underlying ADC.
  *
- * The function allows the caller to sample and discard a number of samples
- * before reading and to take a group of samples and return the average. This
- * can improve the accuracy of the final result.
+ * Analog pins are converted continuously in the background once they have
+ * been configured and each new conversion is folded into a running filtered
+ * value for the pin (an exponential average over ADC_FILTER_SAMPLES samples).
+ * This function simply returns the latest filtered value so it never waits
+ * for a conversion. The first few values after configuring the pin will be
+ * less accurate while the filter settles.
  *
  * @param pin the pin to sample the input from.
- * @param average the number of samples to average to get the final result.
- * @param skip the number of samples to skip before averaging.
+ * @param average unused, retained for source compatibility.
+ * @param skip unused, retained for source compatibility.
+ *
+ * @return the filtered sample for the pin. This will be shifted left if
+ *         needed to fully occupy a 16 bit value.
+ */
+uint16_t pinSample(PIN pin, int average = 0, int skip = 0);
+
+//! Number of conversions averaged by the background sampler (power of 2)
+#define ADC_FILTER_SAMPLES 16
+
+/** Resolved register access for a digital pin
+ *
+ * A handle caches the port registers and bit mask for a pin so reading or
+ * writing it becomes a single load or store. Both supported targets provide
+ * an atomic set/reset register where the low 16 bits set outputs and the high
+ * 16 bits clear them.
+ *
+ * Use 'pinHandle()' to get a handle after the pin has been configured. The
+ * handle becomes stale if the pin is reconfigured.
+ */
+typedef struct _PIN_HANDLE {
+  volatile uint32_t *m_modify; //!< Output set/reset register
+  volatile uint32_t *m_input;  //!< Input data register
+  uint32_t           m_mask;   //!< Bit mask for the pin within the port
+  } PIN_HANDLE;
+
+/** Get the register level handle for a digital pin
+ *
+ * If the pin is not configured as DIGITAL_INPUT or DIGITAL_OUTPUT the handle
+ * is still filled in but reads will always return false and writes will have
+ * no effect.
+ *
+ * @param pin the pin to get the handle for.
+ * @param pHandle pointer to the structure to receive the handle.
+ *
+ * @return true if the pin is configured for digital IO.
+ */
+bool pinHandle(PIN pin, PIN_HANDLE *pHandle);
+
+/** Read the value of a digital pin using a handle
+ *
+ * @param pHandle the handle for the pin (from 'pinHandle()').
+ *
+ * @return the current state of the pin.
+ */
+static inline bool pinFastRead(const PIN_HANDLE *pHandle) {
+  return (*pHandle->m_input & pHandle->m_mask) != 0;
+  }
+
+/** Change the state of a digital pin using a handle
+ *
+ * @param pHandle the handle for the pin (from 'pinHandle()').
+ * @param value the value to set the pin to (true = high, false = low)
+ */
+static inline void pinFastWrite(const PIN_HANDLE *pHandle, bool value) {
+  *pHandle->m_modify = value ? pHandle->m_mask : (pHandle->m_mask << 16);
+  }
+
+/** Change the state of multiple digital pins at once
+ *
+ * Each bit in the mask and value corresponds to a pin (bit 0 is PIN0, bit 1
+ * is PIN1, etc). Pins that share a physical port are updated with a single
+ * register write so they change state at the same time. Pins not configured
+ * as DIGITAL_OUTPUT are ignored.
+ *
+ * @param mask the set of pins to update.
+ * @param value the new values for the pins.
+ */
+void portWrite(uint32_t mask, uint32_t value);
+
+//---------------------------------------------------------------------------
+// Pin change notification
+//
+// Rather than polling an input with 'pinRead()' every time through the loop
+// an application can ask to be notified when the state of a pin changes. The
+// edge is detected by a hardware interrupt, debounced and then delivered to
+// the callback from the main loop (never from interrupt context). Because the
+// edge interrupt also wakes the processor there is no need to stay awake just
+// to watch an input.
+//---------------------------------------------------------------------------
+
+/** Edge selection for pin change notification
+ */
+typedef enum {
+  EDGE_RISING  = 0x01, //!< Notify when the pin goes from low to high
+  EDGE_FALLING = 0x02, //!< Notify when the pin goes from high to low
+  EDGE_BOTH    = 0x03, //!< Notify on any change of state
+  } PIN_EDGE;
+
+//! Default debounce period for pin change notifications (in milliseconds)
+#define PIN_DEBOUNCE 20
+
+/** Function prototype for pin change notifications
+ *
+ * @param pin the pin that changed state.
+ * @param value the new state of the pin (true = high, false = low)
+ */
+typedef void (*FN_PINCHANGE)(PIN pin, bool value);
+
+/** Attach a pin change callback to a digital input
+ *
+ * The pin must already be configured as DIGITAL_INPUT. Once attached the
+ * callback will be invoked from the main loop whenever the pin changes to a
+ * state matching the requested edge and has remained stable for the debounce
+ * period. If the debounce period is 0 every matching edge is reported as soon
+ * as possible without checking for stability - this is intended for signals
+ * driven by other chips (interrupt lines, etc) rather than switches.
+ *
+ * Not every pin can generate interrupts and the number of pins that can be
+ * attached at the same time is limited by the hardware.
+ *
+ * @param pin the pin to monitor.
+ * @param edge the edge (or edges) to report.
+ * @param pfnCallback the function to call when the pin changes.
+ * @param debounce the time (in milliseconds) the pin must remain stable
+ *                 before the change is reported.
+ *
+ * @return true if the callback was attached, false if the pin does not
+ *         support change notification or no more interrupts are available.
+ */
+bool pinAttach(PIN pin, PIN_EDGE edge, FN_PINCHANGE pfnCallback, uint32_t debounce = PIN_DEBOUNCE);
+
+/** Remove a pin change callback
+ *
+ * Stops monitoring the pin and releases the associated interrupt. Any change
+ * that has been detected but not yet reported is discarded.
  *
- * @return the sample read from the pin. This will be shifted left if needed
- *         to fully occupy a 16 bit value.
+ * @param pin the pin to stop monitoring.
  */
-uint16_t pinSample(PIN pin, int average, int skip);
+void pinDetach(PIN pin);
 
 //---------------------------------------------------------------------------
 // SPI Operations
@@ -432,6 +909,71 @@ int i2cSendTo(uint8_t address, const uint8_t *pData, int count);
  */
 int i2cReadFrom(uint8_t address, uint8_t *pData, int count);
 
+/** Status of an I2C transaction
+ */
+typedef enum {
+  I2C_IDLE = 0, //!< Not yet submitted
+  I2C_PENDING,  //!< Queued or in progress
+  I2C_DONE,     //!< Completed successfully
+  I2C_NACK,     //!< The slave did not acknowledge
+  I2C_ERROR,    //!< Bus error or arbitration lost
+  } I2C_STATUS;
+
+struct _I2C_TXN;
+
+/** Prototype for I2C completion callbacks
+ *
+ * Called from the main loop (never from interrupt context) once the
+ * transaction has finished. The transaction may be resubmitted from the
+ * callback.
+ */
+typedef void (*FN_I2CCOMPLETE)(struct _I2C_TXN *pTxn);
+
+/** An asynchronous I2C transaction
+ *
+ * The write phase (if any) is sent first followed by the read phase (if any)
+ * using a repeated start between them. The structure is owned by the caller
+ * and must remain valid until the transaction completes.
+ */
+typedef struct _I2C_TXN {
+  uint8_t             m_address;     //!< 7 bit slave address
+  uint8_t             m_writeCount;  //!< Number of bytes to write
+  uint8_t             m_readCount;   //!< Number of bytes to read
+  volatile uint8_t    m_status;      //!< Current status (I2C_STATUS)
+  const uint8_t      *m_pWrite;      //!< Data to write
+  uint8_t            *m_pRead;       //!< Buffer for data read
+  volatile uint8_t    m_transferred; //!< Bytes transferred in the current phase
+  FN_I2CCOMPLETE      m_pfnCallback; //!< Completion callback (internal)
+  struct _I2C_TXN    *m_pNext;       //!< Queue link (internal)
+  } I2C_TXN;
+
+/** Queue an I2C transaction
+ *
+ * The transaction is performed in the background by the I2C interrupt and
+ * the callback invoked from the main loop when it is complete. Transactions
+ * are performed in the order they were submitted.
+ *
+ * @param pTxn the transaction to perform.
+ * @param pfnCallback the function to call on completion (may be NULL).
+ *
+ * @return true if the transaction was queued, false if I2C has not been
+ *         configured, the transaction is already queued (or its callback has
+ *         not been made yet) or it is invalid.
+ */
+bool i2cSubmit(I2C_TXN *pTxn, FN_I2CCOMPLETE pfnCallback = NULL);
+
+/** Perform an I2C transaction and wait for it to complete
+ *
+ * The transaction is queued behind any asynchronous transactions. If the bus
+ * stalls it is reset and the transaction fails with I2C_ERROR.
+ *
+ * @param pTxn the transaction to perform.
+ *
+ * @return the final status of the transaction (I2C_ERROR if it could not be
+ *         queued).
+ */
+I2C_STATUS i2cExecute(I2C_TXN *pTxn);
+
 //---------------------------------------------------------------------------
 // Serial port operations
 //
@@ -654,6 +1196,68 @@ uint32_t shiftIn(bool polarity, bool phase, bool msbFirst, PIN clock, PIN input,
  */
 uint32_t shiftInOut(bool polarity, bool phase, bool msbFirst, PIN clock, PIN input, PIN output, uint32_t data, int bits);
 
+//---------------------------------------------------------------------------
+// Network operations
+//
+// SensNode devices join a star network through the NRF24L01 transceiver.
+// Joining happens in the background, readings are buffered and sent to the
+// base station in batches (all readings made in a single pass through the
+// application loop share a frame where possible). The base station assigns
+// each node a transmit slot, once the network time is available readings
+// are only sent during that slot and 'sleep()' wakes at the start of it.
+// Readings that cannot be sent are stored with a timestamp (once the network
+// time is known) and uploaded in bursts when the gateway can be reached.
+//---------------------------------------------------------------------------
+
+/** Determine if the node has joined the network
+ *
+ * @return true if the node has been accepted by the base station.
+ */
+bool netConnected();
+
+/** Queue a sensor reading for transmission
+ *
+ * Readings are buffered until the end of the current loop pass (or until a
+ * frame is full) and then sent together. If the node is not connected (or
+ * the frame cannot be sent) the reading is stored for a later upload.
+ *
+ * @param channel the application defined channel number.
+ * @param value the value of the reading.
+ *
+ * @return true if the reading was queued or stored, false if the node has
+ *         no radio or has never had the network time.
+ */
+bool netReading(uint8_t channel, int16_t value);
+
+/** Get the number of stored readings
+ *
+ * @return the number of readings waiting to be uploaded.
+ */
+uint16_t sampleCount();
+
+/** Send any buffered readings immediately
+ *
+ * If the node has been assigned a transmit slot the readings are held until
+ * the slot starts.
+ *
+ * @return true if the readings were sent (or there were none to send).
+ */
+bool netFlush();
+
+/** Get the current network time
+ *
+ * The network time is synchronised with the base station shortly after the
+ * node joins the network and kept up to date while it remains connected.
+ * Small differences are corrected gradually so the time never jumps by less
+ * than a second. The RTC is set from the network time.
+ *
+ * @param pMillis optional pointer to receive the milliseconds (0 to 999).
+ *
+ * @return the network time in seconds since 1/1/1970 or 0 if the time has
+ *         not been synchronised yet.
+ */
+uint32_t netTime(uint16_t *pMillis = NULL);
+
 //---------------------------------------------------------------------------
 // Application interface
 //---------------------------------------------------------------------------
@@ -2,11 +2,15 @@ void init(void);
 void Default_Handler(void);
 
 // The following are 'declared' in the linker script
-extern unsigned char  INIT_DATA_VALUES;
-extern unsigned char  INIT_DATA_START;
-extern unsigned char  INIT_DATA_END;
-extern unsigned char  BSS_START;
-extern unsigned char  BSS_END;
+// (word aligned, see stm32f030.ld)
+extern unsigned long  INIT_DATA_VALUES;
+extern unsigned long  INIT_DATA_START;
+extern unsigned long  INIT_DATA_END;
+extern unsigned long  BSS_START;
+extern unsigned long  BSS_END;
+// static constructors, sorted by priority (see stm32f030.ld)
+extern void (*__init_array_start[])(void);
+extern void (*__init_array_end[])(void);
 // the section "vectors" is placed at the beginning of flash 
 // by the linker script
 const void * Vectors[] __attribute__((section(".vectors"))) ={
@@ -59,20 +63,39 @@ const void * Vectors[] __attribute__((section(".vectors"))) ={
 };
 void init()
 {
-// do global/static data initialization
-	unsigned char *src;
-	unsigned char *dest;
-	unsigned len;
+// do global/static data initialization (four words at a time)
+	unsigned long *src;
+	unsigned long *dest;
+	unsigned long *end;
 	src= &INIT_DATA_VALUES;
 	dest= &INIT_DATA_START;
-	len= &INIT_DATA_END-&INIT_DATA_START;
-	while (len--)
+	end= &INIT_DATA_END;
+	while ((end - dest) >= 4) {
+		dest[0] = src[0];
+		dest[1] = src[1];
+		dest[2] = src[2];
+		dest[3] = src[3];
+		dest += 4;
+		src += 4;
+	}
+	while (dest < end)
 		*dest++ = *src++;
 // zero out the uninitialized global/static variables
 	dest = &BSS_START;
-	len = &BSS_END - &BSS_START;
-	while (len--)
+	end = &BSS_END;
+	while ((end - dest) >= 4) {
+		dest[0] = 0;
+		dest[1] = 0;
+		dest[2] = 0;
+		dest[3] = 0;
+		dest += 4;
+	}
+	while (dest < end)
 		*dest++=0;
+// call the static constructors
+	void (**ctor)(void);
+	for (ctor = __init_array_start; ctor < __init_array_end; ctor++)
+		(*ctor)();
 	main();
 }
 
@@ -0,0 +1,37 @@
+/*---------------------------------------------------------------------------*
+* SensNode - Cycle counter for STM32F030
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Provides the processor cycle count used for profiling. The count is made
+* up from the system tick count (see common/timer.cpp) and the SysTick
+* counter.
+*---------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+/** Get the processor cycle count
+ *
+ * The Cortex-M0 has no cycle counter so the count is made up from the tick
+ * count and the current value of the SysTick counter. It wraps around every
+ * 2^32 cycles.
+ *
+ * @return the number of processor cycles since power up.
+ */
+uint32_t getCycles() {
+  uint32_t ticks, count;
+  do { // Repeat if the counter reloaded between the two reads
+    ticks = getTicks();
+    count = STK_CVR;
+    } while(ticks!=getTicks());
+  uint32_t reload = STK_RVR;
+  return (ticks * (reload + 1)) + (reload - count);
+  }
+
+/** Get the number of processor cycles in a tick
+ *
+ * @return the SysTick reload period in cycles.
+ */
+uint32_t getCyclesPerTick() {
+  return STK_RVR + 1;
+  }
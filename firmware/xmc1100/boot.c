@@ -0,0 +1,159 @@
+/*---------------------------------------------------------------------------*
+* SensNode - Boot loader for XMC1100
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Occupies the start of flash (the 'boot' region in xmc1100.ld) and runs
+* before the application on every reset. If a boot record has been written
+* (see common/update.cpp) and the staged image passes its CRC check the
+* image is copied over the application a page at a time, the record is only
+* erased once the copy has been verified so a reset part way through simply
+* starts the copy again. If the copy cannot be verified after BOOT_ATTEMPTS
+* tries the loader stops rather than start a partly written application,
+* the power latch is never set so the node switches off and the next power
+* up tries again. Otherwise the application is started through its own
+* vector table.
+*
+* Everything here is placed in the '.boot' section and must not use any
+* library code or initialised data - it runs before the C runtime has been
+* set up and has to keep working whatever application is installed.
+*---------------------------------------------------------------------------*/
+#include <platform.h>
+
+// Place code in the boot region
+#define BOOT __attribute__((section(".boot")))
+
+// NVMPROG actions and flags (see xmc1100/flash.cpp)
+#define NVM_ACTION_IDLE   0x00
+#define NVM_ACTION_WRITE  0x51
+#define NVM_ACTION_ERASE  0x52
+#define NVM_RSTVERR       BIT14
+#define NVM_RSTECC        BIT15
+
+// NVMSTATUS bits
+#define NVM_BUSY          BIT0
+#define NVM_ERRORS        (BIT2 | BIT3 | BIT6)
+
+// Number of times the copy is tried before giving up
+#define BOOT_ATTEMPTS     3
+
+// Flash regions (defined by the linker script)
+extern uint32_t APP_START;
+extern uint32_t APP_END;
+extern uint32_t UPDATE_START;
+extern uint32_t UPDATE_END;
+extern uint32_t BOOT_RECORD_START;
+
+// Forward declarations
+void bootReset(void);
+
+/** Startup vectors for the boot ROM
+ *
+ * The boot ROM always starts from the beginning of flash so these replace
+ * the application vectors in xmc1100/init.c and must use the same clock
+ * configuration.
+ */
+const void *BootVectors[] __attribute__((section(".boot.vectors"))) = {
+  (void *)0x20004000,      /* @0x10001000 Top of stack  */
+  bootReset,               /* @0x10001004 Reset Handler */
+  (void *)0,               /* @0x10001008 (reserved) */
+  (void *)0,               /* @0x1000100c (reserved) */
+  (void *)0x00000000,      /* @0x10001010 CLK_VAL1    */
+  (void *)((1<<2)|(1<<9))  /* @0x10001014 CLK_VAL2    */
+  };
+
+//----------------------------------------------------------------------------
+// Internal implementation
+//----------------------------------------------------------------------------
+
+/** Calculate the CRC32 of a region of flash
+ *
+ * Gives the same result as deltaCrc() (see delta.h) but needs no table and
+ * is placed in '.boot'.
+ *
+ * @param pData the start of the region.
+ * @param length the number of bytes.
+ *
+ * @return the CRC32 of the data.
+ */
+static uint32_t BOOT bootCRC(const uint8_t *pData, uint32_t length) {
+  uint32_t crc = 0xffffffff;
+  while(length--) {
+    crc ^= *pData++;
+    for(int bit=0; bit<8; bit++)
+      crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+    }
+  return ~crc;
+  }
+
+/** Run an NVM one-shot operation
+ *
+ * @param action the NVMPROG action.
+ * @param pDest the first word to write.
+ * @param pData the data to write.
+ * @param words the number of words to write.
+ *
+ * @return true if the operation completed without errors.
+ */
+static bool BOOT bootProgram(uint32_t action, volatile uint32_t *pDest, const uint32_t *pData, int words) {
+  NVM_NVMPROG = NVM_RSTVERR | NVM_RSTECC | action;
+  for(int i=0; i<words; i++)
+    pDest[i] = pData[i];
+  while(NVM_NVMSTATUS&NVM_BUSY);
+  bool ok = !(NVM_NVMSTATUS&NVM_ERRORS);
+  NVM_NVMPROG = NVM_ACTION_IDLE;
+  return ok;
+  }
+
+/** Copy the staged image over the application
+ *
+ * @param size the size of the image.
+ *
+ * @return true if every page was erased and written.
+ */
+static bool BOOT bootInstall(uint32_t size) {
+  const uint32_t zero = 0;
+  volatile uint32_t *pDest = &APP_START;
+  const uint32_t *pSource = &UPDATE_START;
+  for(uint32_t offset=0; offset<size; offset+=FLASH_PAGE_SIZE) {
+    if(!bootProgram(NVM_ACTION_ERASE, pDest, &zero, 1))
+      return false;
+    for(int block=0; block<FLASH_PAGE_SIZE; block+=FLASH_BLOCK_SIZE) {
+      if(!bootProgram(NVM_ACTION_WRITE, pDest, pSource, FLASH_BLOCK_SIZE / 4))
+        return false;
+      pDest += FLASH_BLOCK_SIZE / 4;
+      pSource += FLASH_BLOCK_SIZE / 4;
+      }
+    }
+  return true;
+  }
+
+/** Boot loader entry point
+ *
+ * Installs a pending update and starts the application. The application is
+ * only started once the installed copy matches the CRC in the boot record,
+ * if the copy keeps failing the loader stops here.
+ */
+void BOOT bootReset(void) {
+  const BOOT_RECORD *pRecord = (const BOOT_RECORD *)&BOOT_RECORD_START;
+  uint32_t size = pRecord->m_size;
+  if((pRecord->m_magic==BOOT_MAGIC)&&(pRecord->m_check==~pRecord->m_crc)&&
+    (size<=(uint32_t)((uint8_t *)&APP_END - (uint8_t *)&APP_START))&&
+    (size<=(uint32_t)((uint8_t *)&UPDATE_END - (uint8_t *)&UPDATE_START))&&
+    (bootCRC((const uint8_t *)&UPDATE_START, size)==pRecord->m_crc)) {
+    int attempt = 0;
+    while(!bootInstall(size)||(bootCRC((const uint8_t *)&APP_START, size)!=pRecord->m_crc)) {
+      // The application is incomplete, never start it
+      if(++attempt>=BOOT_ATTEMPTS)
+        while(true);
+      }
+    const uint32_t zero = 0;
+    bootProgram(NVM_ACTION_ERASE, &BOOT_RECORD_START, &zero, 1);
+    }
+  // Start the application with its own stack
+  const uint32_t *pVectors = &APP_START;
+  asm volatile(
+    " msr msp, %0 \n"
+    " bx %1 \n"
+    : : "r" (pVectors[0]), "r" (pVectors[1]));
+  }
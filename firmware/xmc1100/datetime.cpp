@@ -4,10 +4,94 @@
 * 30-Oct-2015 ShaneG
 *
 * Provides the hardware specific functions for the RTC module on the XMC1100.
+*
+* 19-Oct-2026
+*
+* Implemented reading and setting the RTC and the alarm. The RTC is clocked
+* from the internal 32.768kHz oscillator (see init.c). The alarm and the
+* periodic seconds event are handled in sleep.cpp.
+*
+* The RTC is started at 1/1/1970 during start up (unless it is already
+* running) so 'sleep()' can use it on nodes that never get the network time,
+* the network clock sets the real time once it is synchronised.
 *---------------------------------------------------------------------------*/
 #include <sensnode.h>
 #include <platform.h>
 
+// RTC_CTR bits
+#define RTC_CTR_ENB     BIT0
+#define RTC_CTR_TAE     BIT2
+#define RTC_CTR_DIV     (0x7fff << 16) // 32.768kHz to 1Hz
+
+// RTC_MSKSR/RTC_CLRSR alarm bit and the matching SCU service request bit
+#define RTC_SR_AI       BIT8
+#define SCU_SR_AI       BIT2
+
+// SCU_MIRRSTS bits for the RTC timer registers
+#define MIRRSTS_RTC_CTR  BIT1
+#define MIRRSTS_RTC_ATIM0 BIT2
+#define MIRRSTS_RTC_ATIM1 BIT3
+#define MIRRSTS_RTC_TIM0 BIT4
+#define MIRRSTS_RTC_TIM1 BIT5
+
+// SCU_CGATSTAT0 bit for the RTC
+#define CGAT_RTC        BIT10
+
+// Flag to indicate the RTC is running
+static bool g_rtcValid = false;
+
+/** Pack a date and time into the TIM0/ATIM0 register format
+ */
+static uint32_t rtcTime0(DATETIME *pDateTime) {
+  return pDateTime->m_second | (pDateTime->m_minute << 8) | (pDateTime->m_hour << 16) | ((pDateTime->m_day - 1) << 24);
+  }
+
+/** Pack a date and time into the TIM1/ATIM1 register format
+ */
+static uint32_t rtcTime1(DATETIME *pDateTime) {
+  return ((pDateTime->m_month - 1) << 8) | (pDateTime->m_year << 16);
+  }
+
+/** Wait for pending writes to the RTC registers to complete
+ *
+ * The RTC registers are mirrored in the standby clock domain and writes take
+ * a few 32.768kHz clock cycles to be transferred.
+ *
+ * @param mask the SCU_MIRRSTS bits to wait for.
+ */
+static void rtcWait(uint32_t mask) {
+  while(SCU_MIRRSTS&mask);
+  }
+
+/** Enable the clock to the RTC registers
+ */
+static void rtcUngate() {
+  if(SCU_CGATSTAT0&CGAT_RTC) {
+    // The SCU registers are write protected
+    SCU_PASSWD = 0xc0;
+    SCU_CGATCLR0 = CGAT_RTC;
+    SCU_PASSWD = 0xc3;
+    }
+  }
+
+/** Start the RTC
+ *
+ * The RTC keeps running through a processor reset, if it is already running
+ * the time is kept. Otherwise it starts at 1/1/1970 00:00:00.
+ */
+static void rtcInit() STARTUP(STARTUP_PLATFORM);
+static void rtcInit() {
+  rtcUngate();
+  rtcWait(MIRRSTS_RTC_CTR);
+  if(RTC_CTR&RTC_CTR_ENB) {
+    g_rtcValid = true;
+    return;
+    }
+  DATETIME epoch;
+  fromTimestamp(&epoch, 0);
+  setDateTime(&epoch);
+  }
+
 /** Get the current date and time according to the RTC
  *
  * @param pDateTime pointer to a structure to receive the date and time data.
@@ -15,8 +99,21 @@
  * @return true on success, false on failure.
  */
 bool getDateTime(DATETIME *pDateTime) {
-  // TODO: Implement this
-  return false;
+  if(!g_rtcValid)
+    return false;
+  // Read until stable (the registers may change between the two reads)
+  uint32_t tim0, tim1;
+  do {
+    tim0 = RTC_TIM0;
+    tim1 = RTC_TIM1;
+    } while(tim0!=RTC_TIM0);
+  pDateTime->m_second = tim0 & 0x3f;
+  pDateTime->m_minute = (tim0 >> 8) & 0x3f;
+  pDateTime->m_hour = (tim0 >> 16) & 0x1f;
+  pDateTime->m_day = ((tim0 >> 24) & 0x1f) + 1;
+  pDateTime->m_month = ((tim1 >> 8) & 0x0f) + 1;
+  pDateTime->m_year = tim1 >> 16;
+  return true;
   }
 
 /** Set the current date and time in the RTC
@@ -26,8 +123,21 @@ bool getDateTime(DATETIME *pDateTime) {
  * @return true on success, false on failure.
  */
 bool setDateTime(DATETIME *pDateTime) {
-  // TODO: Implement this
-  return false;
+  if(!isDateTimeValid(pDateTime))
+    return false;
+  rtcUngate();
+  // Stop the timer while it is updated (other control bits are kept)
+  rtcWait(MIRRSTS_RTC_CTR);
+  uint32_t control = (RTC_CTR & ~RTC_CTR_ENB) | RTC_CTR_DIV;
+  RTC_CTR = control;
+  rtcWait(MIRRSTS_RTC_CTR|MIRRSTS_RTC_TIM0);
+  RTC_TIM0 = rtcTime0(pDateTime);
+  rtcWait(MIRRSTS_RTC_TIM1);
+  RTC_TIM1 = rtcTime1(pDateTime);
+  rtcWait(MIRRSTS_RTC_TIM0|MIRRSTS_RTC_TIM1);
+  RTC_CTR = control | RTC_CTR_ENB;
+  g_rtcValid = true;
+  return true;
   }
 
 /** Set an alarm
@@ -41,7 +151,19 @@ bool setDateTime(DATETIME *pDateTime) {
  * @return true on success, false on failure.
  */
 bool setAlarm(DATETIME *pDateTime) {
-  // TODO: Implement this
-  return false;
+  if(!g_rtcValid||!isDateTimeValid(pDateTime))
+    return false;
+  rtcWait(MIRRSTS_RTC_ATIM0|MIRRSTS_RTC_ATIM1);
+  RTC_ATIM0 = rtcTime0(pDateTime);
+  RTC_ATIM1 = rtcTime1(pDateTime);
+  // Clear any old alarm and route the new one to SCU.SR1
+  RTC_CLRSR = RTC_SR_AI;
+  SCU_SRCLR = SCU_SR_AI;
+  RTC_MSKSR |= RTC_SR_AI;
+  SCU_SRMSK |= SCU_SR_AI;
+  rtcWait(MIRRSTS_RTC_CTR|MIRRSTS_RTC_ATIM0|MIRRSTS_RTC_ATIM1);
+  RTC_CTR |= RTC_CTR_TAE;
+  NVIC_ISER = 1 << IRQ_SCU_SR1;
+  return true;
   }
 
@@ -0,0 +1,81 @@
+/*---------------------------------------------------------------------------*
+* SensNode - Flash programming for the XMC1100
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Erases and writes the flash through the NVM module. Both operations use
+* one-shot actions, the erase is started by writing to any word in the page
+* and the write by storing the last word of the block. Code keeps running
+* from flash, the bus simply waits while the NVM is busy.
+*---------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+// NVMPROG actions
+#define NVM_ACTION_IDLE   0x00
+#define NVM_ACTION_WRITE  0x51 // One-shot write
+#define NVM_ACTION_ERASE  0x52 // One-shot page erase
+
+// NVMPROG bits
+#define NVM_RSTVERR       BIT14 // Clear the verify error
+#define NVM_RSTECC        BIT15 // Clear the ECC errors
+
+// NVMSTATUS bits
+#define NVM_BUSY          BIT0
+#define NVM_VERR          (BIT2 | BIT3)
+#define NVM_WRPERR        BIT6
+
+//----------------------------------------------------------------------------
+// Internal implementation
+//----------------------------------------------------------------------------
+
+/** Wait for the current operation and return to the idle state
+ *
+ * @return true if the operation completed without errors.
+ */
+static bool flashComplete() {
+  while(NVM_NVMSTATUS&NVM_BUSY);
+  bool ok = !(NVM_NVMSTATUS&(NVM_VERR | NVM_WRPERR));
+  NVM_NVMPROG = NVM_ACTION_IDLE;
+  return ok;
+  }
+
+/** Erase a page of flash
+ *
+ * @param pPage the address of the page (aligned to FLASH_PAGE_SIZE).
+ *
+ * @return true if the page was erased.
+ */
+bool flashErase(const void *pPage) {
+  if((uint32_t)(uintptr_t)pPage&(FLASH_PAGE_SIZE - 1))
+    return false;
+  disable_interrupts();
+  NVM_NVMPROG = NVM_RSTVERR | NVM_RSTECC | NVM_ACTION_ERASE;
+  *(volatile uint32_t *)pPage = 0;
+  bool ok = flashComplete();
+  enable_interrupts();
+  return ok;
+  }
+
+/** Write a block of flash
+ *
+ * @param pBlock the address of the block (aligned to FLASH_BLOCK_SIZE).
+ * @param pData the data to write (FLASH_BLOCK_SIZE bytes).
+ *
+ * @return true if the block was written and verified.
+ */
+bool flashWrite(const void *pBlock, const uint32_t *pData) {
+  if((uint32_t)(uintptr_t)pBlock&(FLASH_BLOCK_SIZE - 1))
+    return false;
+  volatile uint32_t *pDest = (volatile uint32_t *)pBlock;
+  disable_interrupts();
+  NVM_NVMPROG = NVM_RSTVERR | NVM_RSTECC | NVM_ACTION_WRITE;
+  for(int i=0; i<(FLASH_BLOCK_SIZE / 4); i++)
+    pDest[i] = pData[i];
+  bool ok = flashComplete();
+  enable_interrupts();
+  // Check what was written
+  for(int i=0; ok&&(i<(FLASH_BLOCK_SIZE / 4)); i++)
+    ok = (pDest[i]==pData[i]);
+  return ok;
+  }
@@ -4,6 +4,13 @@
 * 29-Oct-2015 ShaneG
 *
 * Provides the GPIO interface functions for the XMC1100 based board.
+*
+* 19-Oct-2026
+*
+* The VADC clock is only ungated while an analog input is in use, the
+* converter is calibrated each time it is powered up. The pin table follows
+* the board schematic (hardware/cpu/xmc1100), pins that are not connected to
+* the CPU are rejected instead of falling back to P0.0.
 *---------------------------------------------------------------------------*/
 #include <sensnode.h>
 #include <platform.h>
@@ -20,6 +27,36 @@ typedef enum {
   CAN_INTERNAL = 0x40, //!< Pin has an internal function (eg: I2C)
   } PINCAP_FLAG;
 
+// ERU0 event request input routing for a pin (channel 0-3, input A or B and
+// the source selection for that input).
+#define ERU_A                         0
+#define ERU_B                         1
+#define ERU_INPUT(channel, ab, source) (0x80 | ((channel) << 3) | ((ab) << 2) | (source))
+#define ERU_NONE                      0x00
+
+// VADC channel for an analog pin (group 0 or 1 and the channel in the group)
+#define ADC_CHANNEL(group, channel)   (0x80 | ((group) << 3) | (channel))
+#define ADC_NONE                      0x00
+
+// Port register layout (offsets from the port base address)
+#define PORT_COUNT     3
+#define PORT_BASE(n)   (P0_BASE + ((n) * 0x100))
+#define PORT_OMR       0x0004
+#define PORT_IOCR      0x0010
+#define PORT_IN        0x0024
+#define PORT_PDISC     0x0060
+
+// Port for table entries that have not been mapped to a physical pin
+#define PORT_NONE      0x0f
+
+// Port control codes for the IOCR registers (PCx field, bits 3 to 7)
+#define IOCR_INPUT     (0x00 << 3)
+#define IOCR_PULLDOWN  (0x01 << 3)
+#define IOCR_PULLUP    (0x02 << 3)
+#define IOCR_OUTPUT    (0x10 << 3)
+#define IOCR_OPENDRAIN (0x18 << 3)
+#define IOCR_ALTERNATE(n) ((n) << 3)
+
 /** Information about each configurable pin
  */
 typedef struct _PININFO {
@@ -27,31 +64,321 @@ typedef struct _PININFO {
   uint8_t m_current      : 8;  //!< What the pin is configured for
   uint8_t m_port         : 4;  //!< Which port is it attached to
   uint8_t m_pin          : 4;  //!< Which pin on that port is it
+  uint8_t m_eru          : 8;  //!< ERU0 input for edge detection (or ERU_NONE)
+  uint8_t m_adc          : 8;  //!< VADC channel for analog input (or ADC_NONE)
   } PININFO;
 
 /** Pin definition table
  *
  * This table maps pin IO ports and capabilities to it's current state. There
- * is one entry per pin (the pins defined in the PIN enum).
+ * is one entry per pin (the pins defined in the PIN enum). The assignments
+ * follow the schematic in hardware/cpu/xmc1100 (TSSOP-16 package). Entries
+ * with a port of PORT_NONE are not connected to the CPU on this board, they
+ * are rejected by pinConfig() rather than reprogramming another pin.
  */
 static PININFO g_pininfo[] = {
-  { CAN_INPUT|CAN_OUTPUT|CAN_INTERNAL, 0, 0, 7 }, // PIN0 (SDA)
-  { CAN_INPUT|CAN_OUTPUT|CAN_INTERNAL, 0, 0, 8 }, // PIN1 (SCL)
-  { CAN_INPUT|CAN_OUTPUT|CAN_ANALOG,   0, 0, 0 }, // PIN2
-  { CAN_INPUT|CAN_OUTPUT|CAN_ANALOG,   0, 0, 0 }, // PIN3
-  { CAN_INPUT|CAN_OUTPUT|CAN_ANALOG,   0, 0, 0 }, // PIN4
+  { CAN_INPUT|CAN_OUTPUT|CAN_INTERNAL,          0, 0,         7,  ERU_NONE,               ADC_NONE          }, // PIN0 (SDA, P0.7)
+  { CAN_INPUT|CAN_OUTPUT|CAN_INTERNAL,          0, 0,         8,  ERU_NONE,               ADC_NONE          }, // PIN1 (SCL, P0.8)
+  { CAN_INPUT|CAN_OUTPUT|CAN_ANALOG|CAN_WAKEUP, 0, 2,         0,  ERU_INPUT(0, ERU_A, 0), ADC_CHANNEL(0, 5) }, // PIN2 (P2.0)
+  { CAN_INPUT|CAN_OUTPUT|CAN_ANALOG|CAN_WAKEUP, 0, PORT_NONE, 0,  ERU_NONE,               ADC_NONE          }, // PIN3 (sensor connector only)
+  { CAN_INPUT|CAN_OUTPUT|CAN_ANALOG|CAN_WAKEUP, 0, PORT_NONE, 0,  ERU_NONE,               ADC_NONE          }, // PIN4 (sensor connector only)
   //-- Pins used internally
-  { CAN_INPUT,                         0, 0, 0 }, // PIN_ACTION
-  { CAN_OUTPUT,                        0, 0, 0 }, // PIN_LATCH
-  { CAN_OUTPUT,                        0, 0, 0 }, // PIN_INDICATOR
-  { CAN_ANALOG,                        0, 0, 0 }, // PIN_BATTERY
-  { CAN_OUTPUT,                        0, 0, 0 }, // PIN_CE
-  { CAN_OUTPUT,                        0, 0, 0 }, // PIN_CSN
-  { CAN_OUTPUT,                        0, 0, 0 }, // PIN_SCK
-  { CAN_INPUT,                         0, 0, 0 }, // PIN_MISO
-  { CAN_OUTPUT,                        0, 0, 0 }, // PIN_MOSI
+  { CAN_INPUT|CAN_WAKEUP,                       0, 2,         6,  ERU_INPUT(2, ERU_A, 1), ADC_NONE          }, // PIN_ACTION (P2.6)
+  { CAN_OUTPUT,                                 0, 0,         6,  ERU_NONE,               ADC_NONE          }, // PIN_LATCH (P0.6)
+  { CAN_OUTPUT,                                 0, 0,         9,  ERU_NONE,               ADC_NONE          }, // PIN_INDICATOR (P0.9)
+  { CAN_ANALOG,                                 0, 2,         7,  ERU_NONE,               ADC_CHANNEL(1, 1) }, // PIN_BATTERY (P2.7)
+  { CAN_OUTPUT,                                 0, 2,         10, ERU_NONE,               ADC_NONE          }, // PIN_CE (P2.10)
+  { CAN_OUTPUT,                                 0, 2,         11, ERU_NONE,               ADC_NONE          }, // PIN_CSN (P2.11)
+  { CAN_OUTPUT,                                 0, 0,         5,  ERU_NONE,               ADC_NONE          }, // PIN_SCK (P0.5)
+  { CAN_INPUT,                                  0, 2,         9,  ERU_NONE,               ADC_NONE          }, // PIN_MISO (P2.9)
+  { CAN_OUTPUT,                                 0, 0,         0,  ERU_NONE,               ADC_NONE          }, // PIN_MOSI (P0.0)
+  { CAN_INPUT,                                  0, PORT_NONE, 0,  ERU_NONE,               ADC_NONE          }, // PIN_IRQ (not connected)
   };
 
+// Target for reads and writes of pins that are not configured for them
+static volatile uint32_t g_unused = 0;
+
+/** Resolved register access for each pin
+ *
+ * Filled in by pinConfig() so the read and write functions do not need to
+ * decode the pin definition table.
+ */
+static PIN_HANDLE g_handles[PINMAX] = {
+  { &g_unused, &g_unused, 0 }, // PIN0
+  { &g_unused, &g_unused, 0 }, // PIN1
+  { &g_unused, &g_unused, 0 }, // PIN2
+  { &g_unused, &g_unused, 0 }, // PIN3
+  { &g_unused, &g_unused, 0 }, // PIN4
+  { &g_unused, &g_unused, 0 }, // PIN_ACTION
+  { &g_unused, &g_unused, 0 }, // PIN_LATCH
+  { &g_unused, &g_unused, 0 }, // PIN_INDICATOR
+  { &g_unused, &g_unused, 0 }, // PIN_BATTERY
+  { &g_unused, &g_unused, 0 }, // PIN_CE
+  { &g_unused, &g_unused, 0 }, // PIN_CSN
+  { &g_unused, &g_unused, 0 }, // PIN_SCK
+  { &g_unused, &g_unused, 0 }, // PIN_MISO
+  { &g_unused, &g_unused, 0 }, // PIN_MOSI
+  { &g_unused, &g_unused, 0 }, // PIN_IRQ
+  };
+
+// Number of ERU0 channels (and therefore pins that can be monitored)
+#define ERU_CHANNELS 4
+
+/** Pin currently attached to each ERU0 channel (PINMAX if unused)
+ */
+static uint8_t g_eruOwner[ERU_CHANNELS] = { PINMAX, PINMAX, PINMAX, PINMAX };
+
+// Pins configured with the WAKEUP flag and those monitored while asleep
+static uint32_t g_wakeup = 0;
+static uint32_t g_wakeActive = 0;
+
+//----------------------------------------------------------------------------
+// Pin change events
+//----------------------------------------------------------------------------
+
+/** Common ERU0 service request handler
+ *
+ * Clears the event flag for the channel and queues the edge for the main
+ * loop.
+ *
+ * @param channel the ERU0 channel that raised the interrupt.
+ */
+static void eruHandler(int channel) {
+  EXICON[channel] &= ~BIT7; // Clear FL
+  if(g_eruOwner[channel]<PINMAX)
+    pinEventSignal((PIN)g_eruOwner[channel]);
+  }
+
+//--- Interrupt entry points (referenced from the jump table in init.c)
+extern "C" void ERU0_0_Handler() { eruHandler(0); }
+extern "C" void ERU0_1_Handler() { eruHandler(1); }
+extern "C" void ERU0_2_Handler() { eruHandler(2); }
+extern "C" void ERU0_3_Handler() { eruHandler(3); }
+
+/** Enable edge detection for a pin
+ *
+ * Each ERU0 channel has an event trigger logic unit (ETL) which is connected
+ * to the output gating unit (OGU) of the same number to raise a service
+ * request. The input for the channel is selected with EXISEL.
+ *
+ * @param pin the pin to monitor.
+ * @param edge the edges that should raise the interrupt.
+ *
+ * @return true if the interrupt was enabled, false if the pin cannot be used
+ *         or the ERU0 channel is already in use.
+ */
+bool pinEventEnable(PIN pin, PIN_EDGE edge) {
+  if(pin>=PINMAX)
+    return false;
+  uint8_t eru = g_pininfo[pin].m_eru;
+  if((eru==ERU_NONE)||(g_pininfo[pin].m_port==PORT_NONE))
+    return false;
+  int channel = (eru >> 3) & 0x03;
+  if((g_eruOwner[channel]!=PINMAX)&&(g_eruOwner[channel]!=pin))
+    return false;
+  // Select the source for input A or B of the channel
+  int shift = (channel * 4) + ((eru & 0x04) ? 2 : 0);
+  EXISEL = (EXISEL & ~(0x03 << shift)) | ((eru & 0x03) << shift);
+  // Configure the ETL for the requested edges, trigger OGU 'channel'
+  EXICON[channel] =
+    BIT0 |                                // PE - generate trigger pulse
+    ((edge & EDGE_RISING) ? BIT2 : 0) |   // RE - rising edge
+    ((edge & EDGE_FALLING) ? BIT3 : 0) |  // FE - falling edge
+    (channel << 4) |                      // OCS - output channel
+    ((eru & 0x04) ? BIT8 : 0);            // SS - input A or B
+  EXOCON[channel] = BIT4; // GP = 01, service request on every trigger
+  g_eruOwner[channel] = pin;
+  NVIC_ISER = 1 << (IRQ_ERU0_SR0 + channel);
+  return true;
+  }
+
+/** Disable edge detection for a pin
+ *
+ * Releases the ERU0 channel associated with the pin.
+ *
+ * @param pin the pin to stop monitoring.
+ */
+void pinEventDisable(PIN pin) {
+  for(int channel=0; channel<ERU_CHANNELS; channel++) {
+    if(g_eruOwner[channel]!=pin)
+      continue;
+    NVIC_ICER = 1 << (IRQ_ERU0_SR0 + channel);
+    EXOCON[channel] = 0;
+    EXICON[channel] = 0;
+    g_eruOwner[channel] = PINMAX;
+    }
+  }
+
+/** Enable or disable wake up on the WAKEUP pins
+ *
+ * Pins that already have a change callback wake the processor through their
+ * own ERU0 channel. The remaining WAKEUP pins are given their channel for
+ * the duration of the sleep if it is free.
+ *
+ * @param enable true before sleeping, false after waking.
+ */
+void pinWakeEnable(bool enable) {
+  for(int pin=0; pin<PINMAX; pin++) {
+    uint32_t mask = 1 << pin;
+    if(enable) {
+      if(!(g_wakeup&mask))
+        continue;
+      uint8_t eru = g_pininfo[pin].m_eru;
+      if((eru==ERU_NONE)||(g_eruOwner[(eru >> 3) & 0x03]!=PINMAX))
+        continue;
+      if(pinEventEnable((PIN)pin, EDGE_BOTH))
+        g_wakeActive |= mask;
+      }
+    else if(g_wakeActive&mask) {
+      pinEventDisable((PIN)pin);
+      g_wakeActive &= ~mask;
+      }
+    }
+  }
+
+//----------------------------------------------------------------------------
+// Background analog sampling
+//
+// Every pin configured as ANALOG is added to the VADC background scan which
+// converts the selected channels continuously. Each result is folded into an
+// exponential average in the result interrupt so pinSample() only has to read
+// the latest value.
+//----------------------------------------------------------------------------
+
+// Converter resolution and filter length (log2 of ADC_FILTER_SAMPLES)
+#define ADC_BITS         12
+#define ADC_FILTER_SHIFT 4
+#define ADC_CHANNELS     16 // Eight in each of the two groups
+
+// SCU_CGATSET0 and SCU_CGATCLR0 bit for the VADC
+#define CGAT_VADC        BIT0
+
+#if (1 << ADC_FILTER_SHIFT) != ADC_FILTER_SAMPLES
+#  error ADC_FILTER_SHIFT does not match ADC_FILTER_SAMPLES
+#endif
+
+/** Filter state for each channel
+ *
+ * Each entry holds ADC_FILTER_SAMPLES times the average result for the
+ * channel (so it has ADC_BITS + ADC_FILTER_SHIFT bits of resolution). A value
+ * of zero means no conversion has completed yet.
+ */
+static volatile uint32_t g_adcFilter[ADC_CHANNELS];
+static uint32_t          g_adcChannels = 0; // Channels in the background scan
+
+/** VADC result interrupt
+ *
+ * Called for every completed background conversion.
+ */
+extern "C" void VADC0_C0_0_Handler() {
+  uint32_t result = VADC0_GLOBRES;
+  if(!(result&BIT31)) // VF - no new result
+    return;
+  int channel = (((result >> 16) & 0x0f) * 8) + ((result >> 20) & 0x1f); // GNR, CHNR
+  if(channel>=ADC_CHANNELS)
+    return;
+  uint32_t sample = result & ((1 << ADC_BITS) - 1);
+  uint32_t filter = g_adcFilter[channel];
+  if(filter==0) // Seed the filter with the first sample
+    filter = sample << ADC_FILTER_SHIFT;
+  else
+    filter = filter - (filter >> ADC_FILTER_SHIFT) + sample;
+  g_adcFilter[channel] = filter;
+  }
+
+/** Power the converter up or down
+ *
+ * Powering up ungates the VADC clock, starts the calibration and the
+ * background scan. The scan runs continuously but converts nothing until a
+ * channel is added.
+ *
+ * @param on true to power up, false to gate the clock again.
+ */
+static void adcPower(bool on) {
+  if(!on) {
+    NVIC_ICER = 1 << IRQ_VADC0_C0_SR0;
+    NVIC_ICPR = 1 << IRQ_VADC0_C0_SR0;
+    }
+  // The SCU registers are write protected
+  SCU_PASSWD = 0xc0;
+  if(on)
+    SCU_CGATCLR0 = CGAT_VADC;
+  else
+    SCU_CGATSET0 = CGAT_VADC;
+  SCU_PASSWD = 0xc3;
+  if(!on)
+    return;
+  VADC0_CLC = 0;                // Enable the module
+  VADC0_GLOBCFG = BIT31;        // SUCAL - start up calibration
+  VADC0_GLOBRCR = BIT31;        // SRGEN - service request on each result
+  VADC0_GLOBEVNP = 0;           // Result event to service request 0
+  VADC0_BRSMR = BIT0 | BIT4;    // ENGT = 01, SCAN - continuous autoscan
+  NVIC_ISER = 1 << IRQ_VADC0_C0_SR0;
+  }
+
+/** Add or remove a channel from the background scan
+ *
+ * Channels 0 to 7 are in group 0 and 8 to 15 in group 1.
+ *
+ * @param channel the VADC channel to change.
+ * @param enable true to add the channel to the scan, false to remove it.
+ */
+static void adcScan(int channel, bool enable) {
+  uint32_t channels = enable ? (g_adcChannels | (1 << channel)) : (g_adcChannels & ~(1 << channel));
+  g_adcFilter[channel] = 0;
+  if(channels==g_adcChannels)
+    return;
+  if(g_adcChannels==0)
+    adcPower(true);
+  g_adcChannels = channels;
+  VADC0_BRSSEL0 = channels & 0xff;
+  VADC0_BRSSEL1 = channels >> 8;
+  VADC0_BRSMR |= BIT9;            // LDEV - load the new selection
+  if(channels==0)
+    adcPower(false);
+  energyActive(ENERGY_ADC, channels!=0);
+  }
+
+/** Update the port control field for a pin
+ *
+ * @param pInfo the pin information.
+ * @param control the value for the IOCR byte field (IOCR_* codes).
+ */
+static void pinControl(const PININFO *pInfo, uint8_t control) {
+  if(pInfo->m_port==PORT_NONE)
+    return;
+  int shift = (pInfo->m_pin & 0x03) * 8;
+  volatile uint32_t *pIOCR = PTR_32(PORT_BASE(pInfo->m_port) + PORT_IOCR) + (pInfo->m_pin >> 2);
+  *pIOCR = (*pIOCR & ~(0xff << shift)) | (control << shift);
+  }
+
+/** Assign a pin to a peripheral function
+ *
+ * Connects the pin to one of the alternate output functions (ALT1 to ALT7)
+ * and marks it as used (see pinMarkUsed()). The pin input is always
+ * connected to the peripherals so it does not need any further set up.
+ *
+ * @param pin the pin to assign.
+ * @param function the alternate function number (1 to 7).
+ * @param openDrain true if the output should be open drain rather than
+ *                  push-pull.
+ *
+ * @return true if the pin was assigned, false if it is already in use.
+ */
+bool pinAlternate(PIN pin, uint8_t function, bool openDrain) {
+  if((pin>=PINMAX)||(function<1)||(function>7))
+    return false;
+  PININFO *pInfo = &g_pininfo[pin];
+  if((pInfo->m_port==PORT_NONE)||(pInfo->m_current!=0))
+    return false;
+  pinControl(pInfo, (openDrain ? IOCR_OPENDRAIN : IOCR_OUTPUT) | IOCR_ALTERNATE(function));
+  // Port 2 needs the digital input enabled for the peripheral to see it
+  if(pInfo->m_port==2)
+    REGISTER_32(PORT_BASE(2) + PORT_PDISC) &= ~(1 << pInfo->m_pin);
+  pinMarkUsed(pin);
+  return true;
+  }
+
 //----------------------------------------------------------------------------
 // Public API
 //----------------------------------------------------------------------------
@@ -65,38 +392,120 @@ static PININFO g_pininfo[] = {
  * @return true if the pin was configured as requested.
  */
 bool pinConfig(PIN pin, PIN_MODE mode, uint8_t flags) {
-/* TODO: Revisit this
   if(pin>=PINMAX)
     return false;
-  // Configure the pin
-  uint8_t config = 0;
+  PININFO *pInfo = &g_pininfo[pin];
+  if(pInfo->m_port==PORT_NONE)
+    return false; // Not connected on this board
+  if(pInfo->m_current==CAN_INTERNAL)
+    return false; // Reserved for a peripheral
+  // Determine the port configuration
+  uint8_t config, control = IOCR_INPUT;
   switch(mode) {
+    case DISABLED:
+      config = 0;
+      break;
     case ANALOG:
-      if(!(g_pininfo[pin].m_capabilities&CAN_ANALOG))
+      if(!(pInfo->m_capabilities&CAN_ANALOG)||(pInfo->m_adc==ADC_NONE))
         return false;
       if(flags!=0) // No flags allowed for analog pins
         return false;
       config = CAN_ANALOG;
       break;
     case DIGITAL_INPUT:
-      if(!(g_pininfo[pin].m_capabilities&CAN_INPUT))
+      if(!(pInfo->m_capabilities&CAN_INPUT))
+        return false;
+      if((flags&WAKEUP)&&!(pInfo->m_capabilities&CAN_WAKEUP))
         return false;
+      if(flags&PULLUP)
+        control = IOCR_PULLUP;
+      else if(flags&PULLDOWN)
+        control = IOCR_PULLDOWN;
       config = CAN_INPUT;
       break;
     case DIGITAL_OUTPUT:
-      if(!(g_pininfo[pin].m_capabilities&CAN_OUTPUT))
-        return false;
-      break;
-    case SPECIAL_FUNCTION:
-      if(!(g_pininfo[pin].m_capabilities&CAN_INTERNAL))
+      if(!(pInfo->m_capabilities&CAN_OUTPUT))
         return false;
+      control = IOCR_OUTPUT;
+      config = CAN_OUTPUT;
       break;
     default:
       return false;
     }
-*/
-  // TODO: Implement this
-  return false;
+  // Update the port control register for the pin
+  uint32_t base = PORT_BASE(pInfo->m_port);
+  pinControl(pInfo, control);
+  // Port 2 shares pins with the ADC, the digital pad is only disconnected
+  // for analog inputs and unused pins.
+  if(pInfo->m_port==2) {
+    if((config==CAN_INPUT)||(config==CAN_OUTPUT))
+      REGISTER_32(base + PORT_PDISC) &= ~(1 << pInfo->m_pin);
+    else
+      REGISTER_32(base + PORT_PDISC) |= (1 << pInfo->m_pin);
+    }
+  // Update the background scan if the pin is (or was) an analog input
+  if((config==CAN_ANALOG)!=(pInfo->m_current==CAN_ANALOG))
+    adcScan(pInfo->m_adc & 0x0f, config==CAN_ANALOG);
+  pInfo->m_current = config;
+  if((config==CAN_INPUT)&&(flags&WAKEUP))
+    g_wakeup |= (1 << pin);
+  else
+    g_wakeup &= ~(1 << pin);
+  // Resolve the registers for pinRead()/pinWrite()
+  PIN_HANDLE *pHandle = &g_handles[pin];
+  pHandle->m_mask = 1 << pInfo->m_pin;
+  pHandle->m_modify = (config==CAN_OUTPUT) ? (volatile uint32_t *)(base + PORT_OMR) : &g_unused;
+  pHandle->m_input = (config==CAN_INPUT) ? (volatile uint32_t *)(base + PORT_IN) : &g_unused;
+  return true;
+  }
+
+/** Determine if a GPIO pin has been configured or not
+ *
+ * @param pin the GPIO pin to test.
+ *
+ * @return true if the pin has not yet been configured.
+ */
+bool pinAvailable(PIN pin) {
+  if(pin>=PINMAX)
+    return false;
+  return g_pininfo[pin].m_current==0;
+  }
+
+/** Mark a pin as being used
+ *
+ * This does no actual configuration of the pin but simply marks it as being
+ * in use and prevents future configuration.
+ *
+ * @param pin the GPIO pin to mark as being used.
+ */
+void pinMarkUsed(PIN pin) {
+  if(pin>=PINMAX)
+    return;
+  g_pininfo[pin].m_current = CAN_INTERNAL;
+  g_handles[pin].m_modify = &g_unused;
+  g_handles[pin].m_input = &g_unused;
+  }
+
+/** Get the register level handle for a digital pin
+ *
+ * If the pin is not configured as DIGITAL_INPUT or DIGITAL_OUTPUT the handle
+ * is still filled in but reads will always return false and writes will have
+ * no effect.
+ *
+ * @param pin the pin to get the handle for.
+ * @param pHandle pointer to the structure to receive the handle.
+ *
+ * @return true if the pin is configured for digital IO.
+ */
+bool pinHandle(PIN pin, PIN_HANDLE *pHandle) {
+  if(pin>=PINMAX) {
+    pHandle->m_modify = &g_unused;
+    pHandle->m_input = &g_unused;
+    pHandle->m_mask = 0;
+    return false;
+    }
+  *pHandle = g_handles[pin];
+  return g_pininfo[pin].m_current&(CAN_INPUT|CAN_OUTPUT);
   }
 
 /** Read the value of a digital pin.
@@ -109,8 +518,9 @@ bool pinConfig(PIN pin, PIN_MODE mode, uint8_t flags) {
  * @return the current state of the pin.
  */
 bool pinRead(PIN pin) {
-  // TODO: Implement this
-  return false;
+  if(pin>=PINMAX)
+    return false;
+  return pinFastRead(&g_handles[pin]);
   }
 
 /** Change the state of a digital pin.
@@ -122,7 +532,32 @@ bool pinRead(PIN pin) {
  * @param value the value to set the pin to (true = high, false = low)
  */
 void pinWrite(PIN pin, bool value) {
-  // TODO: Implement this
+  if(pin>=PINMAX)
+    return;
+  pinFastWrite(&g_handles[pin], value);
+  }
+
+/** Change the state of multiple digital pins at once
+ *
+ * Each bit in the mask and value corresponds to a pin (bit 0 is PIN0, bit 1
+ * is PIN1, etc). The changes are collected into a single OMR value for each
+ * port so pins on the same port change state together.
+ *
+ * @param mask the set of pins to update.
+ * @param value the new values for the pins.
+ */
+void portWrite(uint32_t mask, uint32_t value) {
+  uint32_t modify[PORT_COUNT] = { 0, 0, 0 };
+  for(int pin=0; mask&&(pin<PINMAX); pin++, mask>>=1, value>>=1) {
+    if(!(mask&1)||(g_pininfo[pin].m_current!=CAN_OUTPUT))
+      continue;
+    uint32_t bit = g_handles[pin].m_mask;
+    modify[g_pininfo[pin].m_port] |= (value&1) ? bit : (bit << 16);
+    }
+  for(int port=0; port<PORT_COUNT; port++) {
+    if(modify[port])
+      REGISTER_32(PORT_BASE(port) + PORT_OMR) = modify[port];
+    }
   }
 
 /** Sample the value of a analog input
@@ -133,19 +568,28 @@ void pinWrite(PIN pin, bool value) {
  * The value returned by this function is always scaled to a full 16 bit value
  * regardless of the resolution of the underlying ADC.
  *
- * The function allows the caller to sample and discard a number of samples
- * before reading and to take a group of samples and return the average. This
- * can improve the accuracy of the final result.
+ * Analog pins are converted continuously in the background once they have
+ * been configured and each new conversion is folded into a running filtered
+ * value for the pin (an exponential average over ADC_FILTER_SAMPLES samples).
+ * This function simply returns the latest filtered value so it never waits
+ * for a conversion. The first few values after configuring the pin will be
+ * less accurate while the filter settles.
  *
  * @param pin the pin to sample the input from.
- * @param average the number of samples to average to get the final result.
- * @param skip the number of samples to skip before averaging.
+ * @param average unused, retained for source compatibility.
+ * @param skip unused, retained for source compatibility.
  *
- * @return the sample read from the pin. This will be shifted left if needed
- *         to fully occupy a 16 bit value.
+ * @return the filtered sample for the pin. This will be shifted left if
+ *         needed to fully occupy a 16 bit value.
  */
-uint16_t pinSample(PIN pin, int average, int skip) {
-  // TODO: Implement this
-  return 0;
+uint16_t pinSample(PIN pin, int /* average */, int /* skip */) {
+  if((pin>=PINMAX)||(g_pininfo[pin].m_current!=CAN_ANALOG))
+    return 0;
+  uint32_t value = g_adcFilter[g_pininfo[pin].m_adc & 0x0f];
+#if (ADC_BITS + ADC_FILTER_SHIFT) >= 16
+  return (uint16_t)(value >> (ADC_BITS + ADC_FILTER_SHIFT - 16));
+#else
+  return (uint16_t)(value << (16 - ADC_BITS - ADC_FILTER_SHIFT));
+#endif
   }
 
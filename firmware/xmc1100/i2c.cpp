@@ -4,8 +4,277 @@
 * 29-Oct-2015 ShaneG
 *
 * Provides the I2C interface functions for the XMC1100 based board.
+*
+* 19-Oct-2026
+*
+* Transactions are now queued and driven by the USIC0 channel 1 interrupt.
+* The blocking functions are implemented on top of the queue. If the bus
+* stalls (no event for I2C_TIMEOUT) the channel is reset, the active
+* transaction fails and the queue moves on.
 *---------------------------------------------------------------------------*/
 #include <sensnode.h>
+#include <platform.h>
+
+// Pin mapping for USIC0 channel 1 (see the XMC1100 port function tables)
+#define I2C_ALTERNATE   7  // DOUT0 on the SDA pin, SCLKOUT on the SCL pin
+#define I2C_SDA_DSEL    3  // DX0D - SDA input
+#define I2C_SCL_DSEL    1  // DX1B - SCL input
+
+// Bus clock (100kHz standard mode from a 32MHz peripheral clock)
+#define I2C_PCLK        32000000L
+#define I2C_BAUD        100000L
+
+// Service request line used for all channel events
+#define I2C_SR          2
+
+// Time without a bus event before the bus is reset (ms)
+#define I2C_TIMEOUT     20
+
+// Transmit data format codes (TBUF bits 8 to 10)
+#define TDF_SEND        (0x0 << 8)
+#define TDF_RX_ACK      (0x2 << 8)
+#define TDF_RX_NACK     (0x3 << 8)
+#define TDF_START       (0x4 << 8)
+#define TDF_RESTART     (0x5 << 8)
+#define TDF_STOP        (0x6 << 8)
+
+// Protocol status flags (PSR and PSCR)
+#define PSR_PCR         BIT4   // Stop condition
+#define PSR_NACK        BIT5   // Not acknowledged
+#define PSR_ARL         BIT6   // Arbitration lost
+#define PSR_ERR         BIT8   // Bus error
+#define PSR_ACK         BIT9   // Acknowledged
+#define PSR_RIF         BIT14  // Receive
+#define PSR_AIF         BIT15  // Alternate receive
+
+/** Transaction phases
+ */
+typedef enum {
+  PHASE_WRITE,   //!< Address (write) or data sent, waiting for ACK
+  PHASE_ADDRESS, //!< Address (read) sent, waiting for ACK
+  PHASE_READ,    //!< Waiting for a data byte
+  } I2C_PHASE;
+
+// Configuration state
+static bool g_configured = false;
+
+// Bus state (a stop condition must be seen before the next start)
+static volatile bool g_busy = false;
+static volatile uint32_t g_lastEvent; // Tick count of the last bus event
+static I2C_TXN *g_pActive = NULL;
+static uint8_t g_phase;
+
+// Queue of transactions waiting to start
+static I2C_TXN *g_pQueueHead = NULL;
+static I2C_TXN *g_pQueueTail = NULL;
+
+// Completed transactions waiting for their callback
+static I2C_TXN *g_pDoneHead = NULL;
+static I2C_TXN *g_pDoneTail = NULL;
+
+//----------------------------------------------------------------------------
+// Internal implementation
+//----------------------------------------------------------------------------
+
+/** Start the next queued transaction
+ *
+ * Must be called with interrupts disabled (or from the interrupt handler)
+ * when the bus is idle.
+ */
+static void i2cStart() {
+  I2C_TXN *pTxn = g_pQueueHead;
+  if(pTxn==NULL)
+    return;
+  g_pQueueHead = pTxn->m_pNext;
+  if(g_pQueueHead==NULL)
+    g_pQueueTail = NULL;
+  pTxn->m_pNext = NULL;
+  pTxn->m_transferred = 0;
+  g_pActive = pTxn;
+  g_busy = true;
+  g_lastEvent = getTicks();
+  // A transaction without a write phase starts with the read address
+  if((pTxn->m_writeCount>0)||(pTxn->m_readCount==0)) {
+    g_phase = PHASE_WRITE;
+    USIC0_CH1_TBUF[0] = TDF_START | (pTxn->m_address << 1);
+    }
+  else {
+    g_phase = PHASE_ADDRESS;
+    USIC0_CH1_TBUF[0] = TDF_START | (pTxn->m_address << 1) | 1;
+    }
+  }
+
+/** Finish the active transaction
+ *
+ * Transactions with a callback are moved to the completed list for the main
+ * loop, the next transaction starts when the stop condition is detected.
+ *
+ * @param status the final status of the transaction.
+ * @param stop true if a stop condition should be generated.
+ */
+static void i2cFinish(I2C_STATUS status, bool stop) {
+  I2C_TXN *pTxn = g_pActive;
+  g_pActive = NULL;
+  if(stop)
+    USIC0_CH1_TBUF[0] = TDF_STOP;
+  if(pTxn->m_pfnCallback!=NULL) {
+    if(g_pDoneTail==NULL)
+      g_pDoneHead = pTxn;
+    else
+      g_pDoneTail->m_pNext = pTxn;
+    g_pDoneTail = pTxn;
+    }
+  pTxn->m_status = status;
+  }
+
+/** Request the next byte from the slave
+ *
+ * The last byte of the transaction is not acknowledged.
+ *
+ * @param pTxn the active transaction.
+ */
+static void i2cReceive(I2C_TXN *pTxn) {
+  USIC0_CH1_TBUF[0] = ((pTxn->m_transferred + 1)<pTxn->m_readCount) ? TDF_RX_ACK : TDF_RX_NACK;
+  }
+
+/** USIC0 service request 2 (I2C channel events)
+ */
+extern "C" void USIC0_2_Handler() {
+  uint32_t status = USIC0_CH1_PSR;
+  USIC0_CH1_PSCR = status;
+  g_lastEvent = getTicks();
+  I2C_TXN *pTxn = g_pActive;
+  if(pTxn!=NULL) {
+    // Arbitration lost - the other master will release the bus. A bus error
+    // leaves us as master so try to release it, if no stop condition is seen
+    // i2cRecover() resets the channel.
+    if(status&(PSR_ARL|PSR_ERR))
+      i2cFinish(I2C_ERROR, (status&PSR_ERR)&&!(status&PSR_ARL));
+    else if(status&PSR_NACK) {
+      // The last byte sent was not accepted
+      if((g_phase==PHASE_WRITE)&&(pTxn->m_transferred>0))
+        pTxn->m_transferred--;
+      i2cFinish(I2C_NACK, true);
+      }
+    else if((status&PSR_ACK)&&(g_phase==PHASE_WRITE)) {
+      if(pTxn->m_transferred<pTxn->m_writeCount)
+        USIC0_CH1_TBUF[0] = TDF_SEND | pTxn->m_pWrite[pTxn->m_transferred++];
+      else if(pTxn->m_readCount>0) {
+        g_phase = PHASE_ADDRESS;
+        pTxn->m_transferred = 0;
+        USIC0_CH1_TBUF[0] = TDF_RESTART | (pTxn->m_address << 1) | 1;
+        }
+      else
+        i2cFinish(I2C_DONE, true);
+      }
+    else if((status&PSR_ACK)&&(g_phase==PHASE_ADDRESS)) {
+      g_phase = PHASE_READ;
+      i2cReceive(pTxn);
+      }
+    else if((status&(PSR_RIF|PSR_AIF))&&(g_phase==PHASE_READ)) {
+      pTxn->m_pRead[pTxn->m_transferred++] = USIC0_CH1_RBUF;
+      if(pTxn->m_transferred<pTxn->m_readCount)
+        i2cReceive(pTxn);
+      else
+        i2cFinish(I2C_DONE, true);
+      }
+    }
+  // Start the next transaction once the bus has been released
+  if(status&PSR_PCR) {
+    g_busy = false;
+    if(g_pActive==NULL)
+      i2cStart();
+    }
+  }
+
+/** Reset the bus if it has stalled
+ *
+ * If a transaction has been in progress for I2C_TIMEOUT without a bus event
+ * (a slave holding the clock, a lost stop condition after an error or
+ * arbitration loss) the active transaction fails with I2C_ERROR. Switching
+ * the channel out of I2C mode resets the protocol state machine and any
+ * pending transmit data, the next queued transaction is then started.
+ */
+static void i2cRecover() {
+  if(!g_busy||!timeExpired(g_lastEvent, I2C_TIMEOUT, MILLISECOND))
+    return;
+  disable_interrupts();
+  if(g_busy&&timeExpired(g_lastEvent, I2C_TIMEOUT, MILLISECOND)) {
+    if(g_pActive!=NULL)
+      i2cFinish(I2C_ERROR, false);
+    uint32_t mode = USIC0_CH1_CCR;
+    USIC0_CH1_CCR = 0;            // MODE = 0 - channel disabled
+    USIC0_CH1_PSCR = 0xffffffff;
+    USIC0_CH1_CCR = mode;
+    g_busy = false;
+    i2cStart();
+    }
+  enable_interrupts();
+  }
+
+/** Check if a transaction is waiting for its callback
+ *
+ * Must be called with interrupts disabled.
+ *
+ * @param pTxn the transaction to look for.
+ *
+ * @return true if the transaction is on the completed list.
+ */
+static bool i2cDelivering(const I2C_TXN *pTxn) {
+  for(const I2C_TXN *pDone = g_pDoneHead; pDone!=NULL; pDone = pDone->m_pNext) {
+    if(pDone==pTxn)
+      return true;
+    }
+  return false;
+  }
+
+/** Check if the I2C channel is idle
+ *
+ * Used before the USIC0 clock is stopped. A stalled bus is reset so the
+ * queue always drains.
+ *
+ * @return true if no transaction is in progress or queued.
+ */
+bool i2cIdle() {
+  i2cRecover();
+  return !g_busy;
+  }
+
+/** Deliver completed I2C transactions
+ *
+ * Called from the main loop to invoke the completion callbacks for any
+ * asynchronous I2C transactions that have finished and to recover the bus
+ * if it has stalled.
+ */
+void taskI2C() {
+  i2cRecover();
+  while(g_pDoneHead!=NULL) {
+    disable_interrupts();
+    I2C_TXN *pTxn = g_pDoneHead;
+    g_pDoneHead = pTxn->m_pNext;
+    if(g_pDoneHead==NULL)
+      g_pDoneTail = NULL;
+    enable_interrupts();
+    pTxn->m_pNext = NULL;
+    (*pTxn->m_pfnCallback)(pTxn);
+    }
+  }
+
+/** Run a transaction and wait for it to complete
+ *
+ * @param pTxn the transaction to perform.
+ *
+ * @return the number of bytes transferred in the last phase.
+ */
+static int i2cWait(I2C_TXN *pTxn) {
+  if(i2cExecute(pTxn)==I2C_ERROR)
+    return 0;
+  return pTxn->m_transferred;
+  }
+
+//----------------------------------------------------------------------------
+// Public API
+//----------------------------------------------------------------------------
 
 /** Initialise the I2C interface
  *
@@ -17,8 +286,89 @@
  *         or PIN0/PIN1 have already been configured.
  */
 bool i2cConfig() {
-  // TODO: Implement this
-  return false;
+  if(g_configured)
+    return true;
+  if(!(pinAvailable(PIN0)&&pinAvailable(PIN1)))
+    return false;
+  // Ungate the USIC clock (the SCU registers are write protected)
+  SCU_PASSWD = 0xc0;
+  SCU_CGATCLR0 = BIT3;
+  SCU_PASSWD = 0xc3;
+  // Set up the channel for I2C master operation
+  USIC0_CH1_KSCFG = BIT0 | BIT1;               // MODEN, BPMODEN
+  USIC0_CH1_CCR = 0;                           // Disabled while configuring
+  USIC0_CH1_FDR = BIT14 | 1023;                // Normal divider, fFD = fPCLK
+  USIC0_CH1_BRG = (9 << 10) | (((I2C_PCLK / (I2C_BAUD * 10)) - 1) << 16); // DCTQ = 9, PDIV
+  USIC0_CH1_DX0CR = I2C_SDA_DSEL;
+  USIC0_CH1_DX1CR = I2C_SCL_DSEL;
+  USIC0_CH1_SCTR = BIT0 | (3 << 8) | (0x3f << 16) | (7 << 24); // MSB first, TRM = 3, FLE = 63, WLE = 7
+  USIC0_CH1_TCSR = BIT8 | BIT10;               // TDSSM, TDEN = 1
+  USIC0_CH1_PCR = BIT20 | BIT21 | BIT22 | BIT24 | BIT30; // PCRIEN, NACKIEN, ARLIEN, ERRIEN, ACKIEN
+  USIC0_CH1_INPR = (I2C_SR << 8) | (I2C_SR << 12) | (I2C_SR << 16); // RINP, AINP, PINP
+  USIC0_CH1_PSCR = 0xffffffff;
+  USIC0_CH1_CCR = 4 | BIT14 | BIT15;           // MODE = I2C, RIEN, AIEN
+  // Connect the pins (open drain outputs)
+  pinAlternate(PIN0, I2C_ALTERNATE, true);
+  pinAlternate(PIN1, I2C_ALTERNATE, true);
+  NVIC_ISER = 1 << (IRQ_USIC0_SR0 + I2C_SR);
+  g_configured = true;
+  return true;
+  }
+
+/** Queue an I2C transaction
+ *
+ * The transaction is performed in the background by the I2C interrupt and
+ * the callback invoked from the main loop when it is complete. Transactions
+ * are performed in the order they were submitted.
+ *
+ * @param pTxn the transaction to perform.
+ * @param pfnCallback the function to call on completion (may be NULL).
+ *
+ * @return true if the transaction was queued, false if I2C has not been
+ *         configured, the transaction is already queued or it is invalid.
+ */
+bool i2cSubmit(I2C_TXN *pTxn, FN_I2CCOMPLETE pfnCallback) {
+  if((!g_configured)||(pTxn==NULL)||(pTxn->m_status==I2C_PENDING))
+    return false;
+  if(((pTxn->m_writeCount>0)&&(pTxn->m_pWrite==NULL))||((pTxn->m_readCount>0)&&(pTxn->m_pRead==NULL)))
+    return false;
+  disable_interrupts();
+  // Still linked into the completed list until the callback is made
+  if(i2cDelivering(pTxn)) {
+    enable_interrupts();
+    return false;
+    }
+  pTxn->m_pfnCallback = pfnCallback;
+  pTxn->m_pNext = NULL;
+  pTxn->m_transferred = 0;
+  pTxn->m_status = I2C_PENDING;
+  if(g_pQueueTail==NULL)
+    g_pQueueHead = pTxn;
+  else
+    g_pQueueTail->m_pNext = pTxn;
+  g_pQueueTail = pTxn;
+  if(!g_busy)
+    i2cStart();
+  enable_interrupts();
+  return true;
+  }
+
+/** Perform an I2C transaction and wait for it to complete
+ *
+ * The transaction is queued behind any asynchronous transactions. If the
+ * bus stalls it is reset after I2C_TIMEOUT and the transaction fails.
+ *
+ * @param pTxn the transaction to perform.
+ *
+ * @return the final status of the transaction (I2C_ERROR if it could not be
+ *         queued).
+ */
+I2C_STATUS i2cExecute(I2C_TXN *pTxn) {
+  if(!i2cSubmit(pTxn))
+    return I2C_ERROR;
+  while(pTxn->m_status==I2C_PENDING)
+    i2cRecover();
+  return (I2C_STATUS)pTxn->m_status;
   }
 
 /** Write a sequence of byte values to the i2c slave
@@ -30,8 +380,10 @@ bool i2cConfig() {
  * @return number of bytes sent
  */
 int i2cSendTo(uint8_t address, const uint8_t *pData, int count) {
-  // TODO: Implement this
-  return 0;
+  if((count<=0)||(count>255))
+    return 0;
+  I2C_TXN txn = { address, (uint8_t)count, 0, I2C_IDLE, pData, NULL, 0, NULL, NULL };
+  return i2cWait(&txn);
   }
 
 /** Read a sequence of bytes from the i2c slave
@@ -43,7 +395,8 @@ int i2cSendTo(uint8_t address, const uint8_t *pData, int count) {
  * @return the number of bytes read from the slave.
  */
 int i2cReadFrom(uint8_t address, uint8_t *pData, int count) {
-  // TODO: Implement this
-  return 0;
+  if((count<=0)||(count>255))
+    return 0;
+  I2C_TXN txn = { address, 0, (uint8_t)count, I2C_IDLE, NULL, pData, 0, NULL, NULL };
+  return i2cWait(&txn);
   }
-
@@ -0,0 +1,201 @@
+/*---------------------------------------------------------------------------*
+* SensNode - Indicator LED implementation for XMC1100
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Steps the indicator pattern from the CCU40 slice 0 interrupt so it needs
+* no time in the main loop and keeps running during 'delay()'. The slice
+* runs at 128Hz, the period match turns the LED on for the current step and
+* the compare match turns it off again to set the brightness. Each step of
+* the pattern lasts 16 periods (125ms). The timer is stopped and the CCU40
+* clock gated when there is no pattern to show.
+*---------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+// Timing (the CCU4 is clocked from PCLK = MCLK)
+#define INDICATOR_PRESCALE  3     // 32MHz / 2^3 = 4MHz
+#define INDICATOR_PERIOD    31250 // 4MHz / 31250 = 128Hz
+#define INDICATOR_PERIODS   16    // Periods per step (125ms)
+#define INDICATOR_STEPS     16    // Steps per pattern
+
+// CC40INTS, CC40INTE and CC40SWR bits
+#define CCU4_PM             BIT0 // Period match
+#define CCU4_CMU            BIT2 // Compare match (counting up)
+
+// CC40TCSET and CC40TCCLR bits
+#define CCU4_TRB            BIT0 // Timer run
+#define CCU4_TC             BIT1 // Timer clear
+
+// CCU4_GIDLC bits
+#define CCU4_CS0I           BIT0 // Slice 0 idle clear
+#define CCU4_SPRB           BIT8 // Prescaler run
+
+// SCU_CGATSET0 and SCU_CGATCLR0 bit for CCU40
+#define CGAT_CCU40          BIT2
+
+// Pattern state
+static PIN_HANDLE       g_led;
+static volatile uint16_t g_pattern = 0;
+static volatile uint8_t g_step;
+static volatile uint8_t g_count;
+static bool             g_repeat = false;
+static bool             g_running = false;
+static bool             g_suspended = false;
+static uint8_t          g_brightness = 255;
+
+//----------------------------------------------------------------------------
+// Internal implementation
+//----------------------------------------------------------------------------
+
+/** Show the current step of the pattern
+ */
+static void indicatorShow() {
+  pinFastWrite(&g_led, (g_brightness!=0)&&(g_pattern&(0x8000 >> g_step)));
+  }
+
+/** Start or stop the CCU40 clock
+ *
+ * The clock only runs while a pattern is shown, the slice is set up again
+ * each time it is started.
+ *
+ * @param on true to start the clock, false to stop it.
+ */
+static void indicatorPower(bool on) {
+  if(!on) {
+    NVIC_ICER = 1 << IRQ_CCU40_SR0;
+    NVIC_ICPR = 1 << IRQ_CCU40_SR0;
+    }
+  // The SCU registers are write protected
+  SCU_PASSWD = 0xc0;
+  if(on)
+    SCU_CGATCLR0 = CGAT_CCU40;
+  else
+    SCU_CGATSET0 = CGAT_CCU40;
+  SCU_PASSWD = 0xc3;
+  if(!on)
+    return;
+  CCU4_GIDLC = CCU4_SPRB | CCU4_CS0I;
+  CCU4_CC40TC = 0;           // Edge aligned, continuous
+  CCU4_CC40PSC = INDICATOR_PRESCALE;
+  CCU4_CC40PRS = INDICATOR_PERIOD - 1;
+  CCU4_CC40SRS = 0;          // Period and compare match to SR0
+  NVIC_ISER = 1 << IRQ_CCU40_SR0;
+  }
+
+/** Stop the timer and turn the LED off
+ */
+static void indicatorStop() {
+  CCU4_CC40TCCLR = CCU4_TRB | CCU4_TC;
+  CCU4_CC40INTE = 0;
+  CCU4_CC40SWR = CCU4_PM | CCU4_CMU;
+  pinFastWrite(&g_led, false);
+  indicatorPower(false);
+  }
+
+/** Start (or restart) the timer from the current step
+ */
+static void indicatorStart() {
+  indicatorPower(true);
+  // Load the compare value for the brightness (timer is stopped)
+  CCU4_CC40CRS = ((uint32_t)g_brightness * INDICATOR_PERIOD) >> 8;
+  CCU4_GCSS = BIT0;            // S0SE - shadow transfer for slice 0
+  indicatorShow();
+  CCU4_CC40INTE = (g_brightness<255) ? (CCU4_PM | CCU4_CMU) : CCU4_PM;
+  CCU4_CC40TCSET = CCU4_TRB;
+  }
+
+/** CCU40 SR0 interrupt handler
+ *
+ * Advances the pattern on the period match and turns the LED off on the
+ * compare match.
+ */
+extern "C" void CCU40_0_Handler() {
+  uint32_t events = CCU4_CC40INTS & (CCU4_PM | CCU4_CMU);
+  CCU4_CC40SWR = events;
+  if(events&CCU4_PM) {
+    if(++g_count>=INDICATOR_PERIODS) {
+      g_count = 0;
+      if(++g_step>=INDICATOR_STEPS) {
+        g_step = 0;
+        if(!g_repeat) {
+          g_running = false;
+          indicatorStop();
+          return;
+          }
+        }
+      }
+    indicatorShow();
+    }
+  if(events&CCU4_CMU)
+    pinFastWrite(&g_led, false);
+  }
+
+/** Pause the indicator
+ *
+ * Called before and after deep sleep (the CCU40 clock is stopped) so the
+ * LED is not left on while the processor sleeps. The pattern continues
+ * from the same step when resumed.
+ *
+ * @param suspend true to pause the indicator, false to resume it.
+ */
+void indicatorSuspend(bool suspend) {
+  if(suspend==g_suspended)
+    return;
+  g_suspended = suspend;
+  if(!g_running)
+    return;
+  if(suspend)
+    indicatorStop();
+  else
+    indicatorStart();
+  }
+
+//----------------------------------------------------------------------------
+// Public API
+//----------------------------------------------------------------------------
+
+/** Set the output indication sequence
+ *
+ * Every power adapter has an indication LED which is used to provide visual
+ * feedback. This function sets an indication pattern to run on the LED. A
+ * pattern consists of a sequence of 16 LED states (1 = on, 0 = off) which
+ * are stepped through every 125ms giving a total of 2s for each pattern.
+ *
+ * If a pattern is already running it will be terminated at the current step
+ * and the new pattern started instead.
+ *
+ * @param pattern the 16 bit pattern to start.
+ * @param repeat if true the pattern will be repeated until a new pattern is
+ *               set.
+ */
+void indicate(uint16_t pattern, bool repeat) {
+  if(g_running) {
+    g_running = false;
+    indicatorStop();
+    }
+  pinHandle(PIN_INDICATOR, &g_led);
+  g_pattern = pattern;
+  g_repeat = repeat;
+  g_step = 0;
+  g_count = 0;
+  if(pattern==0) {
+    pinFastWrite(&g_led, false);
+    return;
+    }
+  g_running = true;
+  if(!g_suspended)
+    indicatorStart();
+  }
+
+/** Set the brightness of the indicator LED
+ *
+ * @param level the brightness from 0 (off) to 255 (fully on).
+ */
+void indicateBrightness(uint8_t level) {
+  g_brightness = level;
+  if(g_running&&!g_suspended) {
+    indicatorStop();
+    indicatorStart();
+    }
+  }
@@ -7,6 +7,12 @@
 * well as setting up the default hardware configuration it needs to set up
 * the C runtime environment as well. This code is the first code that is
 * executed after a system RESET (hard or soft).
+*
+* 19-Oct-2026
+*
+* RAM is initialised a word at a time and the time it takes is added to the
+* tick count so the boot time can be measured. Static constructors are run
+* here (in priority order) rather than by 'main()'.
 *---------------------------------------------------------------------------*/
 #include <platform.h>
 
@@ -18,13 +24,25 @@ void init(void);
 void clock_init();
 void Default_Handler(void);
 extern void SysTick_Handler(void);
+extern void SCU_1_Handler(void);
+extern void ERU0_0_Handler(void);
+extern void ERU0_1_Handler(void);
+extern void ERU0_2_Handler(void);
+extern void ERU0_3_Handler(void);
+extern void USIC0_2_Handler(void);
+extern void VADC0_C0_0_Handler(void);
+extern void CCU40_0_Handler(void);
 
 // The following are 'declared' in the linker script
-extern unsigned char  INIT_DATA_VALUES;
-extern unsigned char  INIT_DATA_START;
-extern unsigned char  INIT_DATA_END;
-extern unsigned char  BSS_START;
-extern unsigned char  BSS_END;
+// Word aligned (see xmc1100.ld)
+extern uint32_t INIT_DATA_VALUES;
+extern uint32_t INIT_DATA_START;
+extern uint32_t INIT_DATA_END;
+extern uint32_t BSS_START;
+extern uint32_t BSS_END;
+// Static constructors, sorted by priority (see xmc1100.ld)
+extern void (*__init_array_start[])(void);
+extern void (*__init_array_end[])(void);
 
 /** Startup configuration and entry point vectors
  *
@@ -80,27 +98,35 @@ inline void JumpTable(void)
   asm(" ldr R0,=SysTick_Handler "); // -1 Systick handler
   asm(" mov PC,R0 ");
   asm(" .long 0 "); // IRQ 0
-  asm(" .long 0 "); // IRQ 1
+  asm(" ldr R0,=SCU_1_Handler "); // IRQ 1 - SCU.SR1 (RTC events)
+  asm(" mov PC,R0 ");
   asm(" .long 0 "); // IRQ 2
-  asm(" .long 0 "); // IRQ 3
-  asm(" .long 0 "); // IRQ 4
-  asm(" .long 0 "); // IRQ 5
-  asm(" .long 0 "); // IRQ 6
+  asm(" ldr R0,=ERU0_0_Handler "); // IRQ 3 - ERU0.SR0
+  asm(" mov PC,R0 ");
+  asm(" ldr R0,=ERU0_1_Handler "); // IRQ 4 - ERU0.SR1
+  asm(" mov PC,R0 ");
+  asm(" ldr R0,=ERU0_2_Handler "); // IRQ 5 - ERU0.SR2
+  asm(" mov PC,R0 ");
+  asm(" ldr R0,=ERU0_3_Handler "); // IRQ 6 - ERU0.SR3
+  asm(" mov PC,R0 ");
   asm(" .long 0 "); // IRQ 7
   asm(" .long 0 "); // IRQ 8
   asm(" .long 0 "); // IRQ 9
   asm(" .long 0 "); // IRQ 10
-  asm(" .long 0 "); // IRQ 11
+  asm(" ldr R0,=USIC0_2_Handler "); // IRQ 11 - USIC0.SR2
+  asm(" mov PC,R0 ");
   asm(" .long 0 "); // IRQ 12
   asm(" .long 0 "); // IRQ 13
   asm(" .long 0 "); // IRQ 14
-  asm(" .long 0 "); // IRQ 15
+  asm(" ldr R0,=VADC0_C0_0_Handler "); // IRQ 15 - VADC0.C0SR0
+  asm(" mov PC,R0 ");
   asm(" .long 0 "); // IRQ 16
   asm(" .long 0 "); // IRQ 17
   asm(" .long 0 "); // IRQ 18
   asm(" .long 0 "); // IRQ 19
   asm(" .long 0 "); // IRQ 20
-  asm(" .long 0 "); // IRQ 21
+  asm(" ldr R0,=CCU40_0_Handler "); // IRQ 21 - CCU40.SR0
+  asm(" mov PC,R0 ");
   asm(" .long 0 "); // IRQ 22
   asm(" .long 0 "); // IRQ 23
   asm(" .long 0 "); // IRQ 24
@@ -116,28 +142,53 @@ inline void JumpTable(void)
 /** Main initialisation
  *
  * Handles static data initialisation, copying IRQ vector table to RAM and
- * initial hardware configuration. Once set up is complete the function invokes
- * main().
+ * initial hardware configuration. Once set up is complete the function runs
+ * the static constructors and invokes main().
  */
 void init() {
-  unsigned char *src;
-  unsigned char *dest;
-  unsigned len;
-  // Copy initialised data from flash to RAM
+  void (**ctor)(void);
+  uint32_t *src;
+  uint32_t *dest;
+  uint32_t *end;
+  uint32_t cycles;
+  // Count the cycles taken to set up RAM (no interrupt, the vectors are
+  // not in place yet)
+  SYST_RVR = 0xffffff;
+  SYST_CVR = 0;
+  SYST_CSR = 1; // Counter enabled, use system clock
+  // Copy initialised data from flash to RAM four words at a time
   src = &INIT_DATA_VALUES;
   dest = &INIT_DATA_START;
-  len = &INIT_DATA_END - &INIT_DATA_START;
-  while(len--)
+  end = &INIT_DATA_END;
+  while((end - dest)>=4) {
+    dest[0] = src[0];
+    dest[1] = src[1];
+    dest[2] = src[2];
+    dest[3] = src[3];
+    dest += 4;
+    src += 4;
+    }
+  while(dest<end)
     *dest++ = *src++;
   // Zero out the uninitialized global/static variables
   dest = &BSS_START;
-  len = &BSS_END - &BSS_START;
-  while(len--)
+  end = &BSS_END;
+  while((end - dest)>=4) {
+    dest[0] = 0;
+    dest[1] = 0;
+    dest[2] = 0;
+    dest[3] = 0;
+    dest += 4;
+    }
+  while(dest<end)
     *dest++ = 0;
-  // Set up the system tick subsystem
+  cycles = 0xffffff - SYST_CVR;
+  // Set up the system tick subsystem and include the time taken so far
+  SYST_CSR = 0;
   SYST_RVR = CLOCK_SPEED / TICKS_PER_SECOND;
   SYST_CVR = 0;
   SYST_CSR = 3; // Counter enabled, interrupt enable, use system clock
+  tickAdvance(cycles / (CLOCK_SPEED / TICKS_PER_SECOND));
   // TODO: GPIO configuration
   // TODO: Set up RTC
   // TODO: Set up the UART (default 57600 baud)
@@ -151,6 +202,9 @@ void init() {
     BIT0 | BIT1 |        // Enable module
     BIT8 | BIT9 | BIT11; // Disable UART in suspend mode
   // TODO: Pick an interrupt and enable vectoring for the UART receive
+  // Call the static constructors and STARTUP functions
+  for(ctor = __init_array_start; ctor<__init_array_end; ctor++)
+    (*ctor)();
   // Invoke main
   main();
   }
@@ -6,8 +6,229 @@
 * Handles the sleep mode for the XMC1100. In this mode IO pins need to
 * maintain their state but the processor core can be shutdown (or idled).
 * The processor can be woken by the RTC or by activity on an input pin.
+*
+* 19-Oct-2026
+*
+* Fixed the signature to match sensnode.h. The wake up time is aligned with
+* the network transmit slot.
+*
+* Implemented deep sleep. The RTC alarm wakes the core, SysTick and the
+* peripheral clocks are stopped while asleep. The RTC periodic seconds event
+* records the tick count at each RTC second so the ticks lost while asleep
+* can be added back on waking. GPIO states are not touched.
+*
+* Queued I2C transactions are allowed to finish before the USIC0 clock is
+* stopped (the radio SPI is done in software so it is always idle). The RTC
+* seconds are tracked from startup, if the first second has not been seen
+* yet 'sleep()' waits for it rather than falling back to 'delay()'. The RTC
+* is started at boot (see datetime.cpp), when the network clock sets it the
+* reference is stale until the next second and 'sleep()' waits for it too.
+*
+* The radio is powered down for the whole sleep and powered up again
+* NET_WAKE_AHEAD milliseconds before the wake up time.
 *---------------------------------------------------------------------------*/
 #include <sensnode.h>
+#include <platform.h>
+
+// RTC_CTR, RTC_MSKSR and RTC_CLRSR bits
+#define RTC_CTR_TAE     BIT2
+#define RTC_CTR_ESEC    BIT8
+#define RTC_SR_PSE      BIT0
+#define RTC_SR_AI       BIT8
+
+// SCU_SRRAW, SCU_SRMSK and SCU_SRCLR bits
+#define SCU_SR_PI       BIT1
+#define SCU_SR_AI       BIT2
+
+// SCU_MIRRSTS bit for RTC_CTR
+#define MIRRSTS_RTC_CTR BIT1
+
+// SCR bits
+#define SCR_SLEEPDEEP   BIT2
+
+// Peripheral clocks stopped during deep sleep (VADC, CCU40, USIC0)
+#define CGAT_SLEEP      (BIT0|BIT2|BIT3)
+
+// Don't bother with deep sleep for less than this many seconds
+#define SLEEP_MIN_SECONDS 2
+
+// Step used while waiting for the first RTC second (ms)
+#define SLEEP_SYNC_STEP   10
+
+// RTC second tracking
+static bool              g_tracking = false;
+static volatile uint32_t g_secondTicks;  // Tick count at the last RTC second
+static volatile uint32_t g_secondTime;   // RTC timestamp of the last second
+static volatile bool     g_alarm = false;
+
+//----------------------------------------------------------------------------
+// Internal implementation
+//----------------------------------------------------------------------------
+
+/** SCU.SR1 interrupt handler
+ *
+ * Handles the RTC periodic seconds event (while awake) and the alarm (to
+ * wake from deep sleep).
+ */
+extern "C" void SCU_1_Handler() {
+  uint32_t raw = SCU_SRRAW;
+  if(raw&SCU_SR_PI) {
+    DATETIME now;
+    g_secondTicks = getTicks();
+    if(getDateTime(&now))
+      g_secondTime = toTimestamp(&now);
+    }
+  if(raw&SCU_SR_AI)
+    g_alarm = true;
+  RTC_CLRSR = RTC_SR_PSE | RTC_SR_AI;
+  SCU_SRCLR = raw & (SCU_SR_PI | SCU_SR_AI);
+  }
+
+/** Start recording the tick count at each RTC second
+ *
+ * Called at startup and before each sleep, tracking starts once the RTC is
+ * running.
+ *
+ * @return true if the RTC is running and a second has been seen since it
+ *         was last set.
+ */
+static bool trackSeconds() {
+  DATETIME now;
+  if(!getDateTime(&now))
+    return false;
+  if(!g_tracking) {
+    g_secondTime = 0;
+    RTC_CLRSR = RTC_SR_PSE;
+    SCU_SRCLR = SCU_SR_PI;
+    RTC_MSKSR |= RTC_SR_PSE;
+    while(SCU_MIRRSTS&MIRRSTS_RTC_CTR);
+    RTC_CTR |= RTC_CTR_ESEC;
+    SCU_SRMSK |= SCU_SR_PI;
+    NVIC_ISER = 1 << IRQ_SCU_SR1;
+    g_tracking = true;
+    }
+  // A reference taken before the RTC was last set is no use
+  uint32_t elapsed = toTimestamp(&now) - g_secondTime;
+  return (g_secondTime!=0)&&(elapsed<=1);
+  }
+
+/** Start tracking the RTC seconds at startup
+ *
+ * The first second is usually seen long before the first call to 'sleep()'.
+ */
+static void sleepInit() STARTUP(STARTUP_PLATFORM);
+static void sleepInit() {
+  trackSeconds();
+  }
+
+/** Wait for the first RTC second to be seen
+ *
+ * Only needed if the RTC was started or set shortly before the sleep, the
+ * wait is never longer than a second.
+ *
+ * @param wake the tick count to stop waiting at.
+ *
+ * @return true if the RTC is running and a second has been seen since it
+ *         was last set.
+ */
+static bool syncSeconds(uint32_t wake) {
+  while(!trackSeconds()) {
+    if(!g_tracking||((int32_t)(wake - getTicks())<=0))
+      return false;
+    delay(SLEEP_SYNC_STEP, MILLISECOND);
+    }
+  return true;
+  }
+
+/** Enter deep sleep until the given tick count or a wake up pin changes
+ *
+ * The RTC alarm only has a resolution of one second so the processor is
+ * woken at the last RTC second before the target time.
+ *
+ * @param wake the tick count to wake at.
+ *
+ * @return the reason for waking or WAKE_UNKNOWN if deep sleep was not used.
+ */
+static WAKE_REASON deepSleep(uint32_t wake) {
+  // USIC0 is stopped while asleep, let queued I2C transactions finish
+  while(!i2cIdle());
+  // Take a consistent copy of the reference point
+  disable_interrupts();
+  uint32_t refTicks = g_secondTicks, refTime = g_secondTime;
+  uint32_t seconds = (wake - refTicks) / TICKS_PER_SECOND;
+  enable_interrupts();
+  if(((int32_t)(wake - getTicks())<=0)||(seconds<SLEEP_MIN_SECONDS))
+    return WAKE_UNKNOWN;
+  DATETIME alarm;
+  fromTimestamp(&alarm, refTime + seconds);
+  g_alarm = false;
+  if(!setAlarm(&alarm))
+    return WAKE_UNKNOWN;
+  // Stop everything that needs the system clock
+  ENERGY_STATE state = energySwitch(ENERGY_SLEEP);
+  indicatorSuspend(true);
+  bool adc = !(SCU_CGATSTAT0&BIT0)&&(VADC0_BRSSEL0!=0);
+  energyActive(ENERGY_ADC, false);
+  disable_interrupts();
+  RTC_MSKSR &= ~RTC_SR_PSE;
+  SYST_CSR = 0;
+  uint32_t gated = CGAT_SLEEP & ~SCU_CGATSTAT0;
+  SCU_PASSWD = 0xc0;
+  SCU_CGATSET0 = gated;
+  SCU_PASSWD = 0xc3;
+  pinWakeEnable(true);
+  SCR |= SCR_SLEEPDEEP;
+  // Interrupts are taken between each wake up to update the flags
+  while(!g_alarm&&!pinEventPending()) {
+    asm(" wfi ");
+    enable_interrupts();
+    disable_interrupts();
+    }
+  SCR &= ~SCR_SLEEPDEEP;
+  pinWakeEnable(false);
+  SCU_PASSWD = 0xc0;
+  SCU_CGATCLR0 = gated;
+  SCU_PASSWD = 0xc3;
+  // Account for the time asleep. The alarm fires on an RTC second, a pin
+  // change could be anywhere in the second so assume the middle of it.
+  WAKE_REASON reason = WAKE_TIMEOUT;
+  uint32_t elapsed = seconds * TICKS_PER_SECOND;
+  if(!g_alarm) {
+    DATETIME now;
+    reason = WAKE_PINCHANGE;
+    elapsed = 0;
+    if(getDateTime(&now))
+      elapsed = ((toTimestamp(&now) - refTime) * TICKS_PER_SECOND) + (TICKS_PER_SECOND / 2);
+    }
+  uint32_t ticks = refTicks + elapsed - getTicks();
+  if((int32_t)ticks>0)
+    tickAdvance(ticks);
+  SYST_CVR = 0;
+  SYST_CSR = 3;
+  energySwitch(state);
+  energyActive(ENERGY_ADC, adc);
+  indicatorSuspend(false);
+  while(SCU_MIRRSTS&MIRRSTS_RTC_CTR);
+  RTC_CTR &= ~RTC_CTR_TAE;
+  RTC_CLRSR = RTC_SR_PSE;
+  RTC_MSKSR |= RTC_SR_PSE;
+  enable_interrupts();
+  return reason;
+  }
+
+/** Wait in 'delay()' until the given tick count
+ *
+ * @param wake the tick count to return at.
+ */
+static void delayUntil(uint32_t wake) {
+  int32_t remaining = (int32_t)(wake - getTicks());
+  if(remaining>0)
+    delay((uint32_t)(((uint64_t)remaining * 1000) / TICKS_PER_SECOND), MILLISECOND);
+  }
+
+//----------------------------------------------------------------------------
+// Public API
+//----------------------------------------------------------------------------
 
 /** Put the processor into sleep mode
  *
@@ -18,11 +239,24 @@
  * If the processor does not support sleep mode (or doesn't have an RTC to
  * trigger waking) this function will behave like the 'delay()' function.
  *
- * @param duration the amount of time to delay for
- * @param units the units the duration is specified in
+ * If the node has been assigned a network transmit slot the sleep is
+ * extended to the start of the next slot so buffered readings are sent as
+ * soon as it wakes. The radio is powered down while sleeping.
+ *
+ * @param seconds the amount of time (in seconds) to sleep for
  */
-WAKE_REASON sleep(uint32_t duration, TIMEUNIT units) {
-  // TODO: Implement this
-  return WAKE_UNKNOWN;
+WAKE_REASON sleep(uint32_t seconds) {
+  uint32_t start = getTicks();
+  uint32_t wake = netSlotAlign(start + (batteryStretch(seconds) * TICKS_PER_SECOND));
+  netSleep();
+  if(syncSeconds(wake)&&(deepSleep(wake)==WAKE_PINCHANGE)) {
+    netWake();
+    return WAKE_PINCHANGE;
+    }
+  // Make up the part of a second the RTC can't measure (or the whole period
+  // if deep sleep is not available), the radio is started just before the end
+  delayUntil(wake - ((NET_WAKE_AHEAD * TICKS_PER_SECOND) / 1000));
+  netWake();
+  delayUntil(wake);
+  return WAKE_TIMEOUT;
   }
-
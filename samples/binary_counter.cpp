@@ -1,13 +1,17 @@
 /*--------------------------------------------------------------------------*
 * Sample SensNode main program
 *---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Use 'portWrite()' to update all the outputs with a single register write.
+*
 * 08-Sep-2015 ShaneG
 *
 * Updated to the new interface model for GPIO pins.
 *
 * 03-Sep-2015 ShaneG
 *
-* This sample simply uses the 8 digital output bins as a binary counter
+* This sample simply uses the digital output pins as a binary counter
 * output incrementing the count every 250 milliseconds.
 *--------------------------------------------------------------------------*/
 #include <sensnode.h>
@@ -18,6 +22,9 @@ static uint32_t g_timer;
 // Current pin state
 static uint8_t g_state = 0;
 
+// The pins used for the counter (PIN0 to PIN4)
+#define COUNTER_PINS ((1 << (PIN4 + 1)) - 1)
+
 /** User application initialisation
  *
  * The library will call this function once at startup to allow the user
@@ -27,10 +34,9 @@ static uint8_t g_state = 0;
  */
 void setup() {
   // Set all pins as output
-  for(int pin=PIN_D0; pin<=PIN_D7; pin++) {
-    digital->init(pin, OUTPUT);
-    digital->write(pin, false);
-    }
+  for(int pin=PIN0; pin<=PIN4; pin++)
+    pinConfig((PIN)pin, DIGITAL_OUTPUT);
+  portWrite(COUNTER_PINS, 0);
   g_timer = getTicks();
   }
 
@@ -47,8 +53,7 @@ void loop() {
     g_state++;
     // Update pin output
     DBG("Updating pin output");
-    for(int pin=PIN_D0; pin<=PIN_D7; pin++)
-      digital->write(pin, g_state & (1 << pin));
+    portWrite(COUNTER_PINS, g_state);
     }
   }
 
@@ -0,0 +1,90 @@
+/*--------------------------------------------------------------------------*
+* Sample SensNode main program
+*---------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Measures the number of processor cycles used by 'fromTimestamp()' and
+* 'toTimestamp()' and writes the results to the serial port every five
+* seconds. The host side correctness tests are in software/tests.
+*--------------------------------------------------------------------------*/
+#include <sensnode.h>
+#include <platform.h>
+
+// Number of conversions timed for each report
+#define BENCH_COUNT 1000
+
+// Step between timestamps, spreads them over the full range
+#define BENCH_STEP  4294967UL
+
+// Last activity timestamp
+static uint32_t g_timer;
+
+/** Measure the cost of the benchmark loops without the conversions
+ *
+ * Each loop does the same work as the matching loop in 'benchmark()' and is
+ * subtracted from its result so only the conversion is counted. The seconds
+ * use a wrapping counter, 'i % 60' would add a software divide (the M0 has
+ * no divide instruction) to every pass.
+ *
+ * @param pFrom receives the cycles for the 'fromTimestamp()' loop.
+ * @param pTo receives the cycles for the 'toTimestamp()' loop.
+ */
+static void overhead(uint32_t *pFrom, uint32_t *pTo) {
+  volatile uint32_t sink = 0;
+  uint32_t start = getCycles();
+  for(uint32_t i=0; i<BENCH_COUNT; i++)
+    sink += i * BENCH_STEP;
+  *pFrom = getCycles() - start;
+  uint8_t second = 0;
+  start = getCycles();
+  for(uint32_t i=0; i<BENCH_COUNT; i++) {
+    second = (second==59) ? 0 : (second + 1);
+    sink += second;
+    }
+  *pTo = getCycles() - start;
+  }
+
+/** Time the conversions and report the average cycles for each
+ */
+static void benchmark() {
+  DATETIME when;
+  volatile uint32_t sink = 0;
+  uint32_t fromBase, toBase;
+  overhead(&fromBase, &toBase);
+  uint32_t start = getCycles();
+  for(uint32_t i=0; i<BENCH_COUNT; i++) {
+    fromTimestamp(&when, i * BENCH_STEP);
+    sink += when.m_day;
+    }
+  uint32_t from = getCycles() - start - fromBase;
+  uint8_t second = 0;
+  start = getCycles();
+  for(uint32_t i=0; i<BENCH_COUNT; i++) {
+    second = (second==59) ? 0 : (second + 1);
+    when.m_second = second;
+    sink += toTimestamp(&when);
+    }
+  uint32_t to = getCycles() - start - toBase;
+  serialFormat("fromTimestamp #u cycles, toTimestamp #u cycles\n",
+    (unsigned)(from / BENCH_COUNT), (unsigned)(to / BENCH_COUNT));
+  }
+
+/** User application initialisation
+ *
+ * The library will call this function once at startup to allow the user
+ * application to do any initialisation it needs.
+ */
+void setup() {
+  g_timer = getTicks();
+  }
+
+/** User application loop
+ *
+ * Repeat the benchmark every five seconds.
+ */
+void loop() {
+  if(timeExpired(g_timer, 5, SECOND)) {
+    g_timer = getTicks();
+    benchmark();
+    }
+  }
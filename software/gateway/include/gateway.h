@@ -0,0 +1,269 @@
+/*---------------------------------------------------------------------------*
+* SensNode Gateway - Common Definitions
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Provides the common classes and functions used by the base station
+* gateway daemon.
+*---------------------------------------------------------------------------*/
+#ifndef __GATEWAY_H
+#define __GATEWAY_H
+
+// Required definitions
+#include <stdint.h>
+#include <stdbool.h>
+#include <netframe.h>
+
+//---------------------------------------------------------------------------
+// Logging and error reporting
+//
+// Log messages are written to stderr, stdout is reserved for the decoded
+// readings.
+//---------------------------------------------------------------------------
+
+/** Enable or disable debugging messages
+ *
+ * @param verbose true to display debugging messages.
+ */
+void setVerbose(bool verbose);
+
+/** Emit a debugging message
+ *
+ * @param cszFormat format string (as per 'printf()')
+ */
+void DLog(const char *cszFormat, ...);
+
+/** Emit a informational message
+ *
+ * @param cszFormat format string (as per 'printf()')
+ */
+void ILog(const char *cszFormat, ...);
+
+/** Emit an error message
+ *
+ * @param cszFormat format string (as per 'printf()')
+ */
+void ELog(const char *cszFormat, ...);
+
+//---------------------------------------------------------------------------
+// Frame parsing
+//---------------------------------------------------------------------------
+
+/** A parsed view of a received frame
+ *
+ * The view refers directly to the receive buffer, no data is copied. It is
+ * only valid until the next call to Transport::receive().
+ */
+struct FrameView {
+  const NET_HEADER *m_pHeader;   //!< Frame header
+  const uint8_t    *m_pPayload;  //!< Start of the payload
+  int               m_length;    //!< Length of the payload
+
+  /** Get the frame type */
+  uint8_t type() const { return m_pHeader->m_type; }
+
+  /** Get the frame sequence number */
+  uint8_t sequence() const { return m_pHeader->m_sequence; }
+
+  /** Get the node address */
+  uint16_t address() const { return netGet16(m_pHeader->m_address); }
+
+  /** Get the number of readings in a NET_READINGS frame */
+  int readings() const { return m_length / sizeof(NET_READING); }
+
+  /** Get a single reading from a NET_READINGS frame */
+  const NET_READING *reading(int index) const {
+    return &((const NET_READING *)m_pPayload)[index];
+    }
+  };
+
+/** Validate a frame and set up a view of it
+ *
+ * @param view the view to initialise.
+ * @param pFrame the raw frame data (including header and CRC).
+ * @param length the size of the frame.
+ *
+ * @return true if the frame is well formed and the CRC matches.
+ */
+bool parseFrame(FrameView &view, const uint8_t *pFrame, int length);
+
+/** Build a frame to send to a node
+ *
+ * @param pFrame buffer to receive the frame (NET_FRAME_MAX bytes).
+ * @param type the frame type.
+ * @param sequence the sequence number.
+ * @param address the node address.
+ * @param pPayload the payload data.
+ * @param length the size of the payload.
+ *
+ * @return the total size of the frame.
+ */
+int buildFrame(uint8_t *pFrame, uint8_t type, uint8_t sequence, uint16_t address, const void *pPayload, int length);
+
+//---------------------------------------------------------------------------
+// Transports
+//---------------------------------------------------------------------------
+
+/** Source and destination of frames
+ */
+class Transport {
+  public:
+    virtual ~Transport() { }
+
+    /** Get the file descriptor to wait on for incoming data
+     */
+    virtual int fd() = 0;
+
+    /** Get the next frame
+     *
+     * Returns a pointer into the internal receive buffer, the data is valid
+     * until the next call.
+     *
+     * @param ppFrame receives a pointer to the frame.
+     *
+     * @return the size of the frame, 0 if no more frames are available or
+     *         -1 if the transport has failed.
+     */
+    virtual int receive(const uint8_t **ppFrame) = 0;
+
+    /** Send a frame to the node that sent the last received frame
+     *
+     * @param pFrame the frame to send.
+     * @param length the size of the frame.
+     *
+     * @return true if the frame was sent.
+     */
+    virtual bool send(const uint8_t *pFrame, int length) = 0;
+  };
+
+/** Open a serial base node transport
+ *
+ * @param cszDevice the serial device (eg /dev/ttyUSB0).
+ *
+ * @return the transport or NULL on error.
+ */
+Transport *openSerial(const char *cszDevice);
+
+/** Open a simulated radio transport
+ *
+ * Each datagram received on the UNIX socket is a single frame. Replies are
+ * sent back to the sending socket.
+ *
+ * @param cszPath the path of the socket to create.
+ *
+ * @return the transport or NULL on error.
+ */
+Transport *openSimulated(const char *cszPath);
+
+//---------------------------------------------------------------------------
+// Node management
+//---------------------------------------------------------------------------
+
+/** Information about a single node
+ */
+struct Node {
+  uint8_t  m_nodeID[NET_UUID_SIZE]; //!< Unique node identifier
+  uint8_t  m_typeID[NET_UUID_SIZE]; //!< Node type
+  bool     m_active;                //!< Address has been assigned
+  bool     m_typed;                 //!< TYPEID has been received
+  bool     m_haveSequence;          //!< m_sequence is valid
+  uint8_t  m_sequence;              //!< Last sequence number received
+  uint8_t  m_txSequence;            //!< Next sequence number to send
+  bool     m_timed;                 //!< Time response sent
+  bool     m_synced;                //!< Frame seen in the slot (slot is in use)
+  bool     m_updated;               //!< Update installed or rejected (no more offers)
+  uint32_t m_frames;                //!< Frames received
+  uint32_t m_duplicates;            //!< Duplicate frames discarded
+  uint32_t m_offSlot;               //!< Frames received outside the slot
+  };
+
+/** Table of all known nodes
+ *
+ * Nodes are indexed directly by address and NODEIDs are found through an
+ * open addressed hash table so both lookups are constant time.
+ */
+class NodeTable {
+  private:
+    Node     *m_nodes;  // Indexed by address
+    uint16_t *m_hash;   // NODEID hash -> address (0 = empty)
+    uint32_t  m_count;  // Number of addresses assigned
+
+    uint32_t hash(const uint8_t *pNodeID);
+
+  public:
+    NodeTable();
+    ~NodeTable();
+
+    /** Find or assign the address for a node
+     *
+     * @param pNodeID the NODEID of the node.
+     *
+     * @return the node address or NET_ADDRESS_NONE if the table is full.
+     */
+    uint16_t join(const uint8_t *pNodeID);
+
+    /** Get the node with the given address
+     *
+     * @return the node or NULL if the address has not been assigned.
+     */
+    Node *find(uint16_t address);
+
+    /** Get the number of nodes that have joined
+     */
+    uint32_t count() { return m_count; }
+  };
+
+//---------------------------------------------------------------------------
+// Output
+//---------------------------------------------------------------------------
+
+/** Destination for decoded events (JSON lines)
+ */
+class Output {
+  private:
+    int  m_listen;     // Listening socket (-1 for stdout)
+    int *m_clients;    // Connected clients
+    int  m_maxClients; // Size of the client table
+
+  public:
+    Output();
+    ~Output();
+
+    /** Write to a UNIX stream socket instead of stdout
+     *
+     * @param cszPath the path of the socket to create.
+     *
+     * @return true if the socket was created.
+     */
+    bool listen(const char *cszPath);
+
+    /** Get the listening socket (or -1 if writing to stdout)
+     */
+    int fd() { return m_listen; }
+
+    /** Accept a new client connection
+     */
+    void accept();
+
+    /** Write a line to all clients
+     *
+     * Clients that cannot keep up are disconnected.
+     *
+     * @param cszLine the line to write (including the newline).
+     * @param length the length of the line.
+     */
+    void write(const char *cszLine, int length);
+
+    /** Flush any buffered output
+     */
+    void flush();
+  };
+
+/** Format a UUID in the standard text form
+ *
+ * @param szBuffer buffer to receive the string (at least 37 bytes).
+ * @param pUUID the 16 byte UUID.
+ */
+void formatUUID(char *szBuffer, const uint8_t *pUUID);
+
+#endif /* __GATEWAY_H */
@@ -0,0 +1,69 @@
+/*---------------------------------------------------------------------------*
+* SensNode Gateway - Frame Parsing
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Validates received frames and builds frames to send to nodes. Parsing does
+* not copy any data, the FrameView refers to the receive buffer.
+*---------------------------------------------------------------------------*/
+#include <string.h>
+#include <sensnode.h>
+#include <gateway.h>
+
+/** Validate a frame and set up a view of it
+ *
+ * @param view the view to initialise.
+ * @param pFrame the raw frame data (including header and CRC).
+ * @param length the size of the frame.
+ *
+ * @return true if the frame is well formed and the CRC matches.
+ */
+bool parseFrame(FrameView &view, const uint8_t *pFrame, int length) {
+  if((length<(NET_HEADER_SIZE + NET_CRC_SIZE))||(length>NET_FRAME_MAX))
+    return false;
+  length -= NET_CRC_SIZE;
+  if(crcData(crcInit(), pFrame, length)!=netGet16(&pFrame[length]))
+    return false;
+  view.m_pHeader = (const NET_HEADER *)pFrame;
+  view.m_pPayload = &pFrame[NET_HEADER_SIZE];
+  view.m_length = length - NET_HEADER_SIZE;
+  return true;
+  }
+
+/** Build a frame to send to a node
+ *
+ * @param pFrame buffer to receive the frame (NET_FRAME_MAX bytes).
+ * @param type the frame type.
+ * @param sequence the sequence number.
+ * @param address the node address.
+ * @param pPayload the payload data.
+ * @param length the size of the payload.
+ *
+ * @return the total size of the frame.
+ */
+int buildFrame(uint8_t *pFrame, uint8_t type, uint8_t sequence, uint16_t address, const void *pPayload, int length) {
+  NET_HEADER *pHeader = (NET_HEADER *)pFrame;
+  pHeader->m_type = type;
+  pHeader->m_sequence = sequence;
+  netPut16(pHeader->m_address, address);
+  memcpy(&pFrame[NET_HEADER_SIZE], pPayload, length);
+  length += NET_HEADER_SIZE;
+  netPut16(&pFrame[length], crcData(crcInit(), pFrame, length));
+  return length + NET_CRC_SIZE;
+  }
+
+/** Format a UUID in the standard text form
+ *
+ * @param szBuffer buffer to receive the string (at least 37 bytes).
+ * @param pUUID the 16 byte UUID.
+ */
+void formatUUID(char *szBuffer, const uint8_t *pUUID) {
+  static const char HEX[] = "0123456789abcdef";
+  for(int i=0; i<NET_UUID_SIZE; i++) {
+    if((i==4)||(i==6)||(i==8)||(i==10))
+      *szBuffer++ = '-';
+    *szBuffer++ = HEX[pUUID[i] >> 4];
+    *szBuffer++ = HEX[pUUID[i] & 0x0f];
+    }
+  *szBuffer = '\0';
+  }
@@ -0,0 +1,68 @@
+/*---------------------------------------------------------------------------*
+* SensNode Gateway - Logging
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Handle logging output for the application.
+*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdarg.h>
+#include <gateway.h>
+
+// Show debugging messages
+static bool g_verbose = false;
+
+/** Write a message to stderr
+ *
+ * @param cszPrefix the message prefix.
+ * @param cszFormat format string (as per 'printf()')
+ * @param args the arguments for the format string.
+ */
+static void emit(const char *cszPrefix, const char *cszFormat, va_list args) {
+  fprintf(stderr, "%s", cszPrefix);
+  vfprintf(stderr, cszFormat, args);
+  fprintf(stderr, "\n");
+  }
+
+/** Enable or disable debugging messages
+ *
+ * @param verbose true to display debugging messages.
+ */
+void setVerbose(bool verbose) {
+  g_verbose = verbose;
+  }
+
+/** Emit a debugging message
+ *
+ * @param cszFormat format string (as per 'printf()')
+ */
+void DLog(const char *cszFormat, ...) {
+  if(!g_verbose)
+    return;
+  va_list args;
+  va_start(args, cszFormat);
+  emit("DEBUG: ", cszFormat, args);
+  va_end(args);
+  }
+
+/** Emit a informational message
+ *
+ * @param cszFormat format string (as per 'printf()')
+ */
+void ILog(const char *cszFormat, ...) {
+  va_list args;
+  va_start(args, cszFormat);
+  emit("", cszFormat, args);
+  va_end(args);
+  }
+
+/** Emit an error message
+ *
+ * @param cszFormat format string (as per 'printf()')
+ */
+void ELog(const char *cszFormat, ...) {
+  va_list args;
+  va_start(args, cszFormat);
+  emit("ERROR: ", cszFormat, args);
+  va_end(args);
+  }
@@ -0,0 +1,546 @@
+/*---------------------------------------------------------------------------*
+* SensNode Gateway - Main Program
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Receives frames from the SensNode network (through a serial base node or
+* the simulated radio), manages node joining and writes the decoded
+* readings as JSON lines. Stored samples uploaded by nodes that have been
+* out of range are reported with their original timestamps. A firmware
+* delta can be offered to the nodes, they fetch it a frame at a time.
+*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <gateway.h>
+#include <delta.h>
+
+// Version information
+#define VER_MAJOR 0
+#define VER_MINOR 1
+
+// Size of the output line buffer
+#define LINE_MAX_SIZE 1024
+
+/** Statistics
+ */
+struct Stats {
+  uint64_t m_frames;     //!< Valid frames received
+  uint64_t m_invalid;    //!< Frames with a bad CRC or length
+  uint64_t m_unknown;    //!< Frames from unknown nodes or of unknown types
+  uint64_t m_duplicates; //!< Repeated frames discarded
+  uint64_t m_readings;   //!< Readings decoded
+  uint64_t m_offSlot;    //!< Frames received outside the sender's slot
+  };
+
+// Global state
+static volatile bool g_running = true;
+static NodeTable    *g_pNodes = NULL;
+static Transport    *g_pTransport = NULL;
+static Output       *g_pOutput = NULL;
+static Stats         g_stats;
+static double        g_now;
+
+// TDMA schedule
+static uint16_t g_slotCount = 1000;
+static uint16_t g_slotTime = 10;
+
+// Firmware update offered to nodes
+static uint8_t                 *g_pUpdate = NULL;
+static uint32_t                 g_updateSize = 0;
+static NET_UPDATE_OFFER_PAYLOAD g_offer;
+
+//---------------------------------------------------------------------------
+// Frame processing
+//---------------------------------------------------------------------------
+
+/** Get the current time in seconds
+ */
+static double timeNow() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+  }
+
+/** Get the transmit slot for a node
+ *
+ * Slots are handed out in address order, if there are more nodes than slots
+ * they are shared.
+ */
+static uint16_t slotFor(uint16_t address) {
+  return (g_slotCount==0) ? 0 : (address - 1) % g_slotCount;
+  }
+
+/** Determine if a frame arrived during the sender's slot
+ *
+ * The whole slot is allowed (the node starts sending in the first half)
+ * to cover retransmissions and the delay through the base node.
+ *
+ * @param address the node address.
+ *
+ * @return true if the frame is on time.
+ */
+static bool inSlot(uint16_t address) {
+  if(g_slotCount==0)
+    return true;
+  uint64_t now = (uint64_t)(g_now * 1000);
+  return netSlotStart(now - g_slotTime + 1, slotFor(address), g_slotCount, g_slotTime)<=now;
+  }
+
+/** Handle a NET_JOIN frame
+ *
+ * @param view the received frame.
+ */
+static void processJoin(const FrameView &view) {
+  if(view.m_length<NET_UUID_SIZE) {
+    g_stats.m_invalid++;
+    return;
+    }
+  uint16_t address = g_pNodes->join(view.m_pPayload);
+  if(address==NET_ADDRESS_NONE) {
+    ELog("Node table is full, join refused.");
+    return;
+    }
+  Node *pNode = g_pNodes->find(address);
+  pNode->m_haveSequence = false;
+  pNode->m_timed = false;
+  pNode->m_synced = false;
+  // Accept the node
+  NET_ACCEPT_PAYLOAD accept;
+  memcpy(accept.m_nodeID, view.m_pPayload, NET_UUID_SIZE);
+  netPut16(accept.m_address, address);
+  netPut16(accept.m_slot, slotFor(address));
+  netPut16(accept.m_slotCount, g_slotCount);
+  netPut16(accept.m_slotTime, g_slotTime);
+  uint8_t frame[NET_FRAME_MAX];
+  int length = buildFrame(frame, NET_ACCEPT, pNode->m_txSequence++, address, &accept, sizeof(accept));
+  g_pTransport->send(frame, length);
+  // Report it
+  char line[LINE_MAX_SIZE], nodeID[40];
+  formatUUID(nodeID, view.m_pPayload);
+  length = snprintf(line, sizeof(line), "{\"time\":%.3f,\"event\":\"join\",\"node\":%u,\"nodeid\":\"%s\",\"slot\":%u}\n", g_now, address, nodeID, slotFor(address));
+  g_pOutput->write(line, length);
+  }
+
+/** Handle a NET_TYPE frame
+ *
+ * @param pNode the node that sent the frame.
+ * @param view the received frame.
+ */
+static void processType(Node *pNode, const FrameView &view) {
+  if(view.m_length<NET_UUID_SIZE) {
+    g_stats.m_invalid++;
+    return;
+    }
+  memcpy(pNode->m_typeID, view.m_pPayload, NET_UUID_SIZE);
+  pNode->m_typed = true;
+  char line[LINE_MAX_SIZE], typeID[40];
+  formatUUID(typeID, pNode->m_typeID);
+  int length = snprintf(line, sizeof(line), "{\"time\":%.3f,\"event\":\"type\",\"node\":%u,\"typeid\":\"%s\"}\n", g_now, view.address(), typeID);
+  g_pOutput->write(line, length);
+  }
+
+/** Store a time in a frame
+ *
+ * @param pTime the time field to fill in.
+ * @param now the time in seconds since 1/1/1970.
+ */
+static void putTime(NET_TIME *pTime, double now) {
+  uint64_t millis = (uint64_t)(now * 1000);
+  netPut32(pTime->m_seconds, (uint32_t)(millis / 1000));
+  netPut16(pTime->m_millis, (uint16_t)(millis % 1000));
+  }
+
+/** Handle a NET_TIME_REQUEST frame
+ *
+ * The origin is echoed back with the time the frame was received (the time
+ * the gateway woke up to process it) and the time the response is sent.
+ *
+ * @param pNode the node that sent the frame.
+ * @param view the received frame.
+ */
+static void processTime(Node *pNode, const FrameView &view) {
+  if(view.m_length<4) {
+    g_stats.m_invalid++;
+    return;
+    }
+  NET_TIME_PAYLOAD response;
+  memcpy(response.m_origin, view.m_pPayload, sizeof(response.m_origin));
+  putTime(&response.m_receive, g_now);
+  putTime(&response.m_transmit, timeNow());
+  uint8_t frame[NET_FRAME_MAX];
+  int length = buildFrame(frame, NET_TIME_RESPONSE, pNode->m_txSequence++, view.address(), &response, sizeof(response));
+  if(!g_pTransport->send(frame, length))
+    return;
+  pNode->m_timed = true;
+  // Offer the update until the node installs or rejects it
+  if((g_pUpdate!=NULL)&&!pNode->m_updated) {
+    length = buildFrame(frame, NET_UPDATE_OFFER, pNode->m_txSequence++, view.address(), &g_offer, sizeof(g_offer));
+    g_pTransport->send(frame, length);
+    }
+  }
+
+/** Handle a NET_UPDATE_REQUEST frame
+ *
+ * Sends the requested part of the delta.
+ *
+ * @param pNode the node that sent the frame.
+ * @param view the received frame.
+ */
+static void processUpdateRequest(Node *pNode, const FrameView &view) {
+  if((view.m_length<4)||(g_pUpdate==NULL)) {
+    g_stats.m_invalid++;
+    return;
+    }
+  uint32_t offset = netGet32(view.m_pPayload);
+  if(offset>=g_updateSize) {
+    g_stats.m_invalid++;
+    return;
+    }
+  uint8_t payload[NET_PAYLOAD_MAX];
+  uint32_t count = g_updateSize - offset;
+  if(count>NET_UPDATE_DATA_MAX)
+    count = NET_UPDATE_DATA_MAX;
+  netPut32(payload, offset);
+  memcpy(&payload[4], &g_pUpdate[offset], count);
+  uint8_t frame[NET_FRAME_MAX];
+  int length = buildFrame(frame, NET_UPDATE_DATA, pNode->m_txSequence++, view.address(), payload, 4 + count);
+  g_pTransport->send(frame, length);
+  }
+
+/** Handle a NET_UPDATE_STATUS frame
+ *
+ * @param pNode the node that sent the frame.
+ * @param view the received frame.
+ */
+static void processUpdateStatus(Node *pNode, const FrameView &view) {
+  static const char *cszStatus[] = { "accepted", "rejected", "failed", "complete" };
+  if((view.m_length<1)||(view.m_pPayload[0]>NET_UPDATE_COMPLETE)) {
+    g_stats.m_invalid++;
+    return;
+    }
+  uint8_t status = view.m_pPayload[0];
+  // A failed update is offered again at the next time request
+  if((status==NET_UPDATE_REJECTED)||(status==NET_UPDATE_COMPLETE))
+    pNode->m_updated = true;
+  char line[LINE_MAX_SIZE];
+  int length = snprintf(line, sizeof(line), "{\"time\":%.3f,\"event\":\"update\",\"node\":%u,\"status\":\"%s\"}\n", g_now, view.address(), cszStatus[status]);
+  g_pOutput->write(line, length);
+  }
+
+/** Handle a NET_READINGS frame
+ *
+ * @param pNode the node that sent the frame.
+ * @param view the received frame.
+ */
+static void processReadings(Node *pNode, const FrameView &view) {
+  char line[LINE_MAX_SIZE];
+  int length = snprintf(line, sizeof(line), "{\"time\":%.3f,\"event\":\"readings\",\"node\":%u,\"seq\":%u,\"readings\":[", g_now, view.address(), view.sequence());
+  int count = view.readings();
+  for(int i=0; i<count; i++) {
+    const NET_READING *pReading = view.reading(i);
+    length += snprintf(&line[length], sizeof(line) - length, "%s{\"channel\":%u,\"value\":%d}", (i==0) ? "" : ",", pReading->m_channel, (int16_t)netGet16(pReading->m_value));
+    }
+  length += snprintf(&line[length], sizeof(line) - length, "]}\n");
+  g_pOutput->write(line, length);
+  g_stats.m_readings += count;
+  }
+
+/** Handle a NET_SAMPLES frame
+ *
+ * Stored samples carry the time they were taken, it is reported as the
+ * 'timestamp' of each sample.
+ *
+ * @param pNode the node that sent the frame.
+ * @param view the received frame.
+ */
+static void processSamples(Node *pNode, const FrameView &view) {
+  char line[LINE_MAX_SIZE];
+  int length = snprintf(line, sizeof(line), "{\"time\":%.3f,\"event\":\"samples\",\"node\":%u,\"seq\":%u,\"samples\":[", g_now, view.address(), view.sequence());
+  NET_SAMPLE_STATE state;
+  netSampleReset(&state);
+  int count = 0;
+  for(int offset=0, used; offset<view.m_length; offset+=used) {
+    uint8_t channel;
+    uint32_t timestamp;
+    int16_t value;
+    used = netSampleDecode(&state, &view.m_pPayload[offset], view.m_length - offset, &channel, &timestamp, &value);
+    if(used==0) {
+      g_stats.m_invalid++;
+      break;
+      }
+    length += snprintf(&line[length], sizeof(line) - length, "%s{\"channel\":%u,\"timestamp\":%u,\"value\":%d}", (count==0) ? "" : ",", channel, timestamp, value);
+    count++;
+    }
+  length += snprintf(&line[length], sizeof(line) - length, "]}\n");
+  g_pOutput->write(line, length);
+  g_stats.m_readings += count;
+  }
+
+/** Process a single received frame
+ *
+ * @param pFrame the frame data.
+ * @param length the size of the frame.
+ */
+static void processFrame(const uint8_t *pFrame, int length) {
+  FrameView view;
+  if(!parseFrame(view, pFrame, length)) {
+    g_stats.m_invalid++;
+    return;
+    }
+  g_stats.m_frames++;
+  if(view.type()==NET_JOIN) {
+    processJoin(view);
+    return;
+    }
+  Node *pNode = g_pNodes->find(view.address());
+  if(pNode==NULL) {
+    g_stats.m_unknown++;
+    return;
+    }
+  // Drop repeats (the acknowledgement was lost and the node sent it again)
+  if(pNode->m_haveSequence&&(pNode->m_sequence==view.sequence())) {
+    pNode->m_duplicates++;
+    g_stats.m_duplicates++;
+    return;
+    }
+  pNode->m_haveSequence = true;
+  pNode->m_sequence = view.sequence();
+  pNode->m_frames++;
+  // Synchronised nodes should stick to their slot (except during updates),
+  // a node is synchronised once it has the time and has used its slot
+  bool update = (view.type()==NET_UPDATE_REQUEST)||(view.type()==NET_UPDATE_STATUS);
+  if(!update) {
+    bool onTime = inSlot(view.address());
+    if(pNode->m_synced&&!onTime) {
+      pNode->m_offSlot++;
+      g_stats.m_offSlot++;
+      }
+    else if(pNode->m_timed&&onTime)
+      pNode->m_synced = true;
+    }
+  switch(view.type()) {
+    case NET_TYPE:
+      processType(pNode, view);
+      break;
+    case NET_TIME_REQUEST:
+      processTime(pNode, view);
+      break;
+    case NET_READINGS:
+      processReadings(pNode, view);
+      break;
+    case NET_SAMPLES:
+      processSamples(pNode, view);
+      break;
+    case NET_UPDATE_REQUEST:
+      processUpdateRequest(pNode, view);
+      break;
+    case NET_UPDATE_STATUS:
+      processUpdateStatus(pNode, view);
+      break;
+    default:
+      g_stats.m_unknown++;
+      break;
+    }
+  }
+
+//---------------------------------------------------------------------------
+// Main program
+//---------------------------------------------------------------------------
+
+/** Load a firmware delta to offer to the nodes
+ *
+ * @param cszFile the delta file (see delta.h).
+ *
+ * @return true if the file was loaded and has a valid header.
+ */
+static bool loadUpdate(const char *cszFile) {
+  FILE *fp = fopen(cszFile, "rb");
+  if(fp==NULL) {
+    ELog("Unable to open update file '%s'.", cszFile);
+    return false;
+    }
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  if((size<=(long)sizeof(DELTA_HEADER))||(size>0x1000000)) {
+    ELog("Update file '%s' is not a valid delta.", cszFile);
+    fclose(fp);
+    return false;
+    }
+  g_pUpdate = (uint8_t *)malloc(size);
+  g_updateSize = (uint32_t)size;
+  bool ok = (fread(g_pUpdate, 1, size, fp)==(size_t)size);
+  fclose(fp);
+  const DELTA_HEADER *pHeader = (const DELTA_HEADER *)g_pUpdate;
+  if(!ok||(pHeader->m_magic[0]!=DELTA_MAGIC0)||(pHeader->m_magic[1]!=DELTA_MAGIC1)||
+    (pHeader->m_magic[2]!=DELTA_MAGIC2)||(pHeader->m_magic[3]!=DELTA_MAGIC3)) {
+    ELog("Update file '%s' is not a valid delta.", cszFile);
+    return false;
+    }
+  memcpy(g_offer.m_oldSize, pHeader->m_oldSize, sizeof(g_offer.m_oldSize));
+  memcpy(g_offer.m_newSize, pHeader->m_newSize, sizeof(g_offer.m_newSize));
+  memcpy(g_offer.m_oldCrc, pHeader->m_oldCrc, sizeof(g_offer.m_oldCrc));
+  memcpy(g_offer.m_newCrc, pHeader->m_newCrc, sizeof(g_offer.m_newCrc));
+  netPut32(g_offer.m_length, g_updateSize);
+  ILog("Offering update %08X -> %08X (%u byte delta).", netGet32(pHeader->m_oldCrc), netGet32(pHeader->m_newCrc), g_updateSize);
+  return true;
+  }
+
+/** Signal handler to stop the main loop
+ */
+static void onSignal(int signal) {
+  g_running = false;
+  }
+
+/** Show the program usage
+ */
+static void usage() {
+  fprintf(stderr,
+    "USAGE: gateway [options]\n\n"
+    "Options:\n"
+    "  -s device  Use a base node on the serial port 'device' (no base node\n"
+    "             firmware exists yet).\n"
+    "  -r path    Use the simulated radio socket at 'path'.\n"
+    "  -o path    Write output to clients of the UNIX socket at 'path'\n"
+    "             (default is stdout).\n"
+    "  -S count   Number of TDMA slots per superframe (default 1000, 0 to\n"
+    "             disable the schedule).\n"
+    "  -L ms      Length of a TDMA slot in milliseconds (default 10).\n"
+    "  -u file    Offer the firmware delta in 'file' to the nodes.\n"
+    "  -t secs    Report statistics every 'secs' seconds.\n"
+    "  -v         Show debugging information.\n"
+    );
+  }
+
+/** Parse a numeric option
+ *
+ * @param cszOption the option name (for error messages).
+ * @param cszValue the option value.
+ * @param min the smallest value allowed.
+ * @param max the largest value allowed.
+ * @param pValue receives the value.
+ *
+ * @return true if the value is a number in the range.
+ */
+static bool parseNumber(const char *cszOption, const char *cszValue, long min, long max, long *pValue) {
+  char *pEnd;
+  errno = 0;
+  long value = strtol(cszValue, &pEnd, 10);
+  if((errno!=0)||(pEnd==cszValue)||(*pEnd!='\0')||(value<min)||(value>max)) {
+    ELog("Option %s must be a number from %ld to %ld.", cszOption, min, max);
+    return false;
+    }
+  *pValue = value;
+  return true;
+  }
+
+/** Program entry point
+ */
+int main(int argc, char *argv[]) {
+  const char *cszSerial = NULL, *cszRadio = NULL, *cszOutput = NULL, *cszUpdate = NULL;
+  long interval = 0, value;
+  int opt;
+  while((opt = getopt(argc, argv, "s:r:o:S:L:u:t:vh"))!=-1) {
+    switch(opt) {
+      case 's': cszSerial = optarg; break;
+      case 'r': cszRadio = optarg; break;
+      case 'o': cszOutput = optarg; break;
+      case 'S':
+        if(!parseNumber("-S", optarg, 0, UINT16_MAX, &value))
+          return 1;
+        g_slotCount = value;
+        break;
+      case 'L':
+        if(!parseNumber("-L", optarg, 0, UINT16_MAX, &value))
+          return 1;
+        g_slotTime = value;
+        break;
+      case 'u': cszUpdate = optarg; break;
+      case 't':
+        if(!parseNumber("-t", optarg, 0, 86400, &interval))
+          return 1;
+        break;
+      case 'v': setVerbose(true); break;
+      default:
+        usage();
+        return 1;
+      }
+    }
+  if((g_slotCount>0)&&(g_slotTime<2)) {
+    ELog("Slots must be at least 2ms long.");
+    return 1;
+    }
+  if((cszSerial==NULL)==(cszRadio==NULL)) {
+    ELog("Exactly one of -s or -r must be specified.");
+    usage();
+    return 1;
+    }
+  ILog("SensNode Gateway V%d.%02d", VER_MAJOR, VER_MINOR);
+  if((cszUpdate!=NULL)&&!loadUpdate(cszUpdate))
+    return 1;
+  // Set up
+  g_pTransport = (cszSerial!=NULL) ? openSerial(cszSerial) : openSimulated(cszRadio);
+  if(g_pTransport==NULL)
+    return 1;
+  g_pOutput = new Output();
+  if((cszOutput!=NULL)&&!g_pOutput->listen(cszOutput))
+    return 1;
+  g_pNodes = new NodeTable();
+  memset(&g_stats, 0, sizeof(g_stats));
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  // Main loop
+  double lastReport = timeNow();
+  uint64_t lastFrames = 0;
+  while(g_running) {
+    struct pollfd fds[2];
+    int nfds = 1;
+    fds[0].fd = g_pTransport->fd();
+    fds[0].events = POLLIN;
+    if(g_pOutput->fd()>=0) {
+      fds[1].fd = g_pOutput->fd();
+      fds[1].events = POLLIN;
+      nfds++;
+      }
+    if(poll(fds, nfds, 1000)<0)
+      continue;
+    g_now = timeNow();
+    if((nfds>1)&&(fds[1].revents&POLLIN))
+      g_pOutput->accept();
+    if(fds[0].revents&(POLLIN|POLLERR|POLLHUP)) {
+      const uint8_t *pFrame;
+      int length;
+      while((length = g_pTransport->receive(&pFrame))>0)
+        processFrame(pFrame, length);
+      if(length<0)
+        break;
+      g_pOutput->flush();
+      }
+    if((interval>0)&&((g_now - lastReport)>=interval)) {
+      ILog("%.0f frames/s, %llu frames, %llu readings, %u nodes, %llu invalid, %llu unknown, %llu duplicates, %llu off slot",
+        (g_stats.m_frames - lastFrames) / (g_now - lastReport),
+        (unsigned long long)g_stats.m_frames, (unsigned long long)g_stats.m_readings, g_pNodes->count(),
+        (unsigned long long)g_stats.m_invalid, (unsigned long long)g_stats.m_unknown, (unsigned long long)g_stats.m_duplicates, (unsigned long long)g_stats.m_offSlot);
+      lastFrames = g_stats.m_frames;
+      lastReport = g_now;
+      }
+    }
+  // Clean up
+  ILog("%llu frames received from %u nodes.", (unsigned long long)g_stats.m_frames, g_pNodes->count());
+  g_pOutput->flush();
+  delete g_pTransport;
+  delete g_pOutput;
+  delete g_pNodes;
+  free(g_pUpdate);
+  if(cszRadio!=NULL)
+    unlink(cszRadio);
+  if(cszOutput!=NULL)
+    unlink(cszOutput);
+  return 0;
+  }
@@ -0,0 +1,81 @@
+/*---------------------------------------------------------------------------*
+* SensNode Gateway - Node Table
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Keeps track of the nodes that have joined the network. Addresses are
+* assigned sequentially and a node that joins again keeps its address.
+*---------------------------------------------------------------------------*/
+#include <string.h>
+#include <gateway.h>
+
+// Number of entries in the address table (every possible address)
+#define NODE_TABLE_SIZE 0x10000
+
+// Number of entries in the NODEID hash (power of 2, larger than the number
+// of assignable addresses)
+#define NODE_HASH_SIZE  0x20000
+
+/** Constructor
+ */
+NodeTable::NodeTable() {
+  m_nodes = new Node[NODE_TABLE_SIZE];
+  m_hash = new uint16_t[NODE_HASH_SIZE];
+  memset(m_nodes, 0, sizeof(Node) * NODE_TABLE_SIZE);
+  memset(m_hash, 0, sizeof(uint16_t) * NODE_HASH_SIZE);
+  m_count = 0;
+  }
+
+/** Destructor
+ */
+NodeTable::~NodeTable() {
+  delete[] m_nodes;
+  delete[] m_hash;
+  }
+
+/** Generate the hash table index for a NODEID (FNV-1a)
+ *
+ * @param pNodeID the NODEID to hash.
+ *
+ * @return the starting index in the hash table.
+ */
+uint32_t NodeTable::hash(const uint8_t *pNodeID) {
+  uint32_t hash = 2166136261u;
+  for(int i=0; i<NET_UUID_SIZE; i++)
+    hash = (hash ^ pNodeID[i]) * 16777619u;
+  return hash & (NODE_HASH_SIZE - 1);
+  }
+
+/** Find or assign the address for a node
+ *
+ * @param pNodeID the NODEID of the node.
+ *
+ * @return the node address or NET_ADDRESS_NONE if the table is full.
+ */
+uint16_t NodeTable::join(const uint8_t *pNodeID) {
+  uint32_t index = hash(pNodeID);
+  while(m_hash[index]!=NET_ADDRESS_NONE) {
+    uint16_t address = m_hash[index];
+    if(memcmp(m_nodes[address].m_nodeID, pNodeID, NET_UUID_SIZE)==0)
+      return address;
+    index = (index + 1) & (NODE_HASH_SIZE - 1);
+    }
+  // Assign the next address (NET_ADDRESS_NONE and NET_ADDRESS_GATEWAY are reserved)
+  if((m_count + 1)>=NET_ADDRESS_GATEWAY)
+    return NET_ADDRESS_NONE;
+  uint16_t address = (uint16_t)(++m_count);
+  Node *pNode = &m_nodes[address];
+  memcpy(pNode->m_nodeID, pNodeID, NET_UUID_SIZE);
+  pNode->m_active = true;
+  m_hash[index] = address;
+  return address;
+  }
+
+/** Get the node with the given address
+ *
+ * @return the node or NULL if the address has not been assigned.
+ */
+Node *NodeTable::find(uint16_t address) {
+  Node *pNode = &m_nodes[address];
+  return pNode->m_active ? pNode : NULL;
+  }
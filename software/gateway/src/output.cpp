@@ -0,0 +1,119 @@
+/*---------------------------------------------------------------------------*
+* SensNode Gateway - Output
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Writes decoded events as JSON lines, either to stdout or to every client
+* connected to a UNIX stream socket.
+*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <gateway.h>
+
+// Maximum number of socket clients
+#define MAX_CLIENTS 16
+
+/** Constructor
+ */
+Output::Output() {
+  m_listen = -1;
+  m_maxClients = MAX_CLIENTS;
+  m_clients = new int[m_maxClients];
+  for(int i=0; i<m_maxClients; i++)
+    m_clients[i] = -1;
+  }
+
+/** Destructor
+ */
+Output::~Output() {
+  for(int i=0; i<m_maxClients; i++) {
+    if(m_clients[i]>=0)
+      close(m_clients[i]);
+    }
+  if(m_listen>=0)
+    close(m_listen);
+  delete[] m_clients;
+  }
+
+/** Write to a UNIX stream socket instead of stdout
+ *
+ * @param cszPath the path of the socket to create.
+ *
+ * @return true if the socket was created.
+ */
+bool Output::listen(const char *cszPath) {
+  struct sockaddr_un addr;
+  if(strlen(cszPath)>=sizeof(addr.sun_path)) {
+    ELog("Socket path '%s' is too long.", cszPath);
+    return false;
+    }
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd<0) {
+    ELog("Unable to create socket - %s", strerror(errno));
+    return false;
+    }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, cszPath);
+  unlink(cszPath);
+  if((bind(fd, (struct sockaddr *)&addr, sizeof(addr))<0)||(::listen(fd, MAX_CLIENTS)<0)) {
+    ELog("Unable to listen on '%s' - %s", cszPath, strerror(errno));
+    close(fd);
+    return false;
+    }
+  m_listen = fd;
+  return true;
+  }
+
+/** Accept a new client connection
+ */
+void Output::accept() {
+  int fd = ::accept(m_listen, NULL, NULL);
+  if(fd<0)
+    return;
+  for(int i=0; i<m_maxClients; i++) {
+    if(m_clients[i]<0) {
+      fcntl(fd, F_SETFL, O_NONBLOCK);
+      m_clients[i] = fd;
+      DLog("Output client connected.");
+      return;
+      }
+    }
+  ELog("Too many output clients, connection refused.");
+  close(fd);
+  }
+
+/** Write a line to all clients
+ *
+ * Clients that cannot keep up are disconnected.
+ *
+ * @param cszLine the line to write (including the newline).
+ * @param length the length of the line.
+ */
+void Output::write(const char *cszLine, int length) {
+  if(m_listen<0) {
+    fwrite(cszLine, 1, length, stdout);
+    return;
+    }
+  for(int i=0; i<m_maxClients; i++) {
+    if(m_clients[i]<0)
+      continue;
+    if(send(m_clients[i], cszLine, length, MSG_NOSIGNAL)!=length) {
+      ELog("Output client disconnected.");
+      close(m_clients[i]);
+      m_clients[i] = -1;
+      }
+    }
+  }
+
+/** Flush any buffered output
+ */
+void Output::flush() {
+  if(m_listen<0)
+    fflush(stdout);
+  }
@@ -0,0 +1,211 @@
+/*---------------------------------------------------------------------------*
+* SensNode Gateway - Transports
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Implements the serial base node and simulated radio transports.
+*
+* The base node forwards every valid radio payload over the serial port as
+* a sync byte (0xA5), a length byte and the frame itself. Frames written by
+* the gateway use the same format and are sent by the base node to the
+* radio address of the node in the frame header. No base node firmware
+* implements this yet (the firmware has no serial receive and the library
+* owns the radio), only the simulated radio can be used for now.
+*
+* The simulated radio uses a UNIX datagram socket, each datagram holds a
+* single frame.
+*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <gateway.h>
+
+// Serial framing
+#define SERIAL_SYNC   0xA5
+#define SERIAL_HEADER 2
+#define SERIAL_BUFFER 4096
+
+// Receive buffer size for the simulated radio socket
+#define SIM_SOCKET_BUFFER (4 * 1024 * 1024)
+
+//---------------------------------------------------------------------------
+// Serial base node
+//---------------------------------------------------------------------------
+
+/** Transport using a base node connected to a serial port
+ */
+class SerialTransport : public Transport {
+  private:
+    int     m_fd;
+    int     m_start;
+    int     m_end;
+    uint8_t m_buffer[SERIAL_BUFFER];
+
+  public:
+    SerialTransport(int fd) : m_fd(fd), m_start(0), m_end(0) { }
+
+    virtual ~SerialTransport() {
+      close(m_fd);
+      }
+
+    virtual int fd() {
+      return m_fd;
+      }
+
+    virtual int receive(const uint8_t **ppFrame) {
+      while(true) {
+        // Look for a complete frame in the buffer
+        while((m_end - m_start)>=SERIAL_HEADER) {
+          if(m_buffer[m_start]!=SERIAL_SYNC) {
+            m_start++;
+            continue;
+            }
+          int length = m_buffer[m_start + 1];
+          if((length<(NET_HEADER_SIZE + NET_CRC_SIZE))||(length>NET_FRAME_MAX)) {
+            m_start++; // Not a real sync byte
+            continue;
+            }
+          if((m_end - m_start)<(SERIAL_HEADER + length))
+            break;
+          *ppFrame = &m_buffer[m_start + SERIAL_HEADER];
+          m_start += SERIAL_HEADER + length;
+          return length;
+          }
+        // Move the partial frame to the start and read more
+        memmove(m_buffer, &m_buffer[m_start], m_end - m_start);
+        m_end -= m_start;
+        m_start = 0;
+        int count = read(m_fd, &m_buffer[m_end], SERIAL_BUFFER - m_end);
+        if(count>0)
+          m_end += count;
+        else if((count<0)&&((errno==EAGAIN)||(errno==EINTR)))
+          return 0;
+        else {
+          ELog("Serial port closed.");
+          return -1;
+          }
+        }
+      }
+
+    virtual bool send(const uint8_t *pFrame, int length) {
+      uint8_t buffer[SERIAL_HEADER + NET_FRAME_MAX];
+      if(length>NET_FRAME_MAX)
+        return false;
+      buffer[0] = SERIAL_SYNC;
+      buffer[1] = (uint8_t)length;
+      memcpy(&buffer[SERIAL_HEADER], pFrame, length);
+      return write(m_fd, buffer, SERIAL_HEADER + length)==(SERIAL_HEADER + length);
+      }
+  };
+
+/** Open a serial base node transport
+ *
+ * @param cszDevice the serial device (eg /dev/ttyUSB0).
+ *
+ * @return the transport or NULL on error.
+ */
+Transport *openSerial(const char *cszDevice) {
+  ILog("Serial base nodes are not implemented by the firmware yet, use the simulated radio.");
+  int fd = open(cszDevice, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if(fd<0) {
+    ELog("Unable to open serial port '%s' - %s", cszDevice, strerror(errno));
+    return NULL;
+    }
+  // Raw mode, 115200 baud
+  struct termios tio;
+  if(tcgetattr(fd, &tio)==0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tcsetattr(fd, TCSANOW, &tio);
+    }
+  return new SerialTransport(fd);
+  }
+
+//---------------------------------------------------------------------------
+// Simulated radio
+//---------------------------------------------------------------------------
+
+/** Transport using a UNIX datagram socket
+ */
+class SimulatedTransport : public Transport {
+  private:
+    int                m_fd;
+    struct sockaddr_un m_source;
+    socklen_t          m_sourceLength;
+    uint8_t            m_buffer[NET_FRAME_MAX + 1];
+
+  public:
+    SimulatedTransport(int fd) : m_fd(fd), m_sourceLength(0) { }
+
+    virtual ~SimulatedTransport() {
+      close(m_fd);
+      }
+
+    virtual int fd() {
+      return m_fd;
+      }
+
+    virtual int receive(const uint8_t **ppFrame) {
+      while(true) {
+        m_sourceLength = sizeof(m_source);
+        int count = recvfrom(m_fd, m_buffer, sizeof(m_buffer), MSG_DONTWAIT, (struct sockaddr *)&m_source, &m_sourceLength);
+        if(count<0) {
+          if((errno==EAGAIN)||(errno==EINTR))
+            return 0;
+          ELog("Simulated radio failed - %s", strerror(errno));
+          return -1;
+          }
+        if((count==0)||(count>NET_FRAME_MAX))
+          continue; // Too big for the radio, drop it
+        *ppFrame = m_buffer;
+        return count;
+        }
+      }
+
+    virtual bool send(const uint8_t *pFrame, int length) {
+      if(m_sourceLength<=sizeof(sa_family_t))
+        return false; // Sender is not bound, can't reply
+      return sendto(m_fd, pFrame, length, MSG_DONTWAIT, (struct sockaddr *)&m_source, m_sourceLength)==length;
+      }
+  };
+
+/** Open a simulated radio transport
+ *
+ * Each datagram received on the UNIX socket is a single frame. Replies are
+ * sent back to the sending socket.
+ *
+ * @param cszPath the path of the socket to create.
+ *
+ * @return the transport or NULL on error.
+ */
+Transport *openSimulated(const char *cszPath) {
+  struct sockaddr_un addr;
+  if(strlen(cszPath)>=sizeof(addr.sun_path)) {
+    ELog("Socket path '%s' is too long.", cszPath);
+    return NULL;
+    }
+  int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if(fd<0) {
+    ELog("Unable to create socket - %s", strerror(errno));
+    return NULL;
+    }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, cszPath);
+  unlink(cszPath);
+  if(bind(fd, (struct sockaddr *)&addr, sizeof(addr))<0) {
+    ELog("Unable to bind to '%s' - %s", cszPath, strerror(errno));
+    close(fd);
+    return NULL;
+    }
+  int size = SIM_SOCKET_BUFFER;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  return new SimulatedTransport(fd);
+  }
@@ -0,0 +1,207 @@
+/*---------------------------------------------------------------------------*
+* SensNode Gateway - Load Generator
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Simulates a large number of nodes talking to the gateway through the
+* simulated radio socket. Each node joins the network, reports its TYPEID
+* and then sends readings at a fixed overall frame rate.
+*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <gateway.h>
+
+// Number of readings in each frame
+#define READINGS_PER_FRAME 4
+
+// Time to wait for all nodes to join (seconds)
+#define JOIN_TIMEOUT 10
+
+/** A simulated node
+ */
+struct SimNode {
+  uint8_t  m_nodeID[NET_UUID_SIZE];
+  uint16_t m_address;
+  uint8_t  m_sequence;
+  };
+
+// Global state
+static int      g_socket = -1;
+static SimNode *g_nodes = NULL;
+static int      g_nodeCount = 0;
+static int      g_joined = 0;
+
+//---------------------------------------------------------------------------
+// Helper functions
+//---------------------------------------------------------------------------
+
+/** Get a monotonic time in seconds
+ */
+static double timeNow() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+  }
+
+/** Send a frame from a node
+ *
+ * @param pNode the sending node.
+ * @param type the frame type.
+ * @param pPayload the payload data.
+ * @param length the size of the payload.
+ *
+ * @return true if the frame was sent.
+ */
+static bool sendFrame(SimNode *pNode, uint8_t type, const void *pPayload, int length) {
+  uint8_t frame[NET_FRAME_MAX];
+  length = buildFrame(frame, type, pNode->m_sequence++, pNode->m_address, pPayload, length);
+  if(send(g_socket, frame, length, 0)!=length) {
+    ELog("Unable to send frame (error %d)", errno);
+    return false;
+    }
+  return true;
+  }
+
+/** Process frames sent by the gateway
+ *
+ * Only NET_ACCEPT is handled, the node index is stored in the first bytes
+ * of the NODEID so no lookup is required.
+ */
+static void processReplies() {
+  uint8_t frame[NET_FRAME_MAX];
+  int length;
+  while((length = recv(g_socket, frame, sizeof(frame), MSG_DONTWAIT))>0) {
+    FrameView view;
+    if(!parseFrame(view, frame, length)||(view.type()!=NET_ACCEPT)||(view.m_length<(int)sizeof(NET_ACCEPT_PAYLOAD)))
+      continue;
+    const NET_ACCEPT_PAYLOAD *pAccept = (const NET_ACCEPT_PAYLOAD *)view.m_pPayload;
+    uint32_t index = pAccept->m_nodeID[0] | (pAccept->m_nodeID[1] << 8) | (pAccept->m_nodeID[2] << 16);
+    if((index>=(uint32_t)g_nodeCount)||(memcmp(g_nodes[index].m_nodeID, pAccept->m_nodeID, NET_UUID_SIZE)!=0))
+      continue;
+    SimNode *pNode = &g_nodes[index];
+    if(pNode->m_address!=NET_ADDRESS_NONE)
+      continue;
+    pNode->m_address = netGet16(pAccept->m_address);
+    g_joined++;
+    // Report a type like the firmware does
+    uint8_t typeID[NET_UUID_SIZE] = NET_TYPEID_MARKER;
+    sendFrame(pNode, NET_TYPE, typeID, NET_UUID_SIZE);
+    }
+  }
+
+/** Show the program usage
+ */
+static void usage() {
+  fprintf(stderr,
+    "USAGE: loadgen [options] socket\n\n"
+    "Options:\n"
+    "  -n count   Number of nodes to simulate (default 1000).\n"
+    "  -r rate    Total frames per second to send (default 10000).\n"
+    "  -t secs    Time to run for (default 10).\n"
+    "  -v         Show debugging information.\n"
+    );
+  }
+
+//---------------------------------------------------------------------------
+// Main program
+//---------------------------------------------------------------------------
+
+/** Program entry point
+ */
+int main(int argc, char *argv[]) {
+  int rate = 10000, duration = 10, opt;
+  g_nodeCount = 1000;
+  while((opt = getopt(argc, argv, "n:r:t:vh"))!=-1) {
+    switch(opt) {
+      case 'n': g_nodeCount = atoi(optarg); break;
+      case 'r': rate = atoi(optarg); break;
+      case 't': duration = atoi(optarg); break;
+      case 'v': setVerbose(true); break;
+      default:
+        usage();
+        return 1;
+      }
+    }
+  if((optind!=(argc - 1))||(g_nodeCount<=0)||(g_nodeCount>=NET_ADDRESS_GATEWAY)||(rate<=0)) {
+    usage();
+    return 1;
+    }
+  // Connect to the gateway from a socket of our own (for the replies)
+  struct sockaddr_un local, remote;
+  memset(&local, 0, sizeof(local));
+  local.sun_family = AF_UNIX;
+  snprintf(local.sun_path, sizeof(local.sun_path), "/tmp/sensnode-loadgen-%d", getpid());
+  memset(&remote, 0, sizeof(remote));
+  remote.sun_family = AF_UNIX;
+  strncpy(remote.sun_path, argv[optind], sizeof(remote.sun_path) - 1);
+  g_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if((g_socket<0)||(bind(g_socket, (struct sockaddr *)&local, sizeof(local))<0)||(connect(g_socket, (struct sockaddr *)&remote, sizeof(remote))<0)) {
+    ELog("Unable to connect to '%s' (error %d)", argv[optind], errno);
+    return 1;
+    }
+  // Create the nodes (version 4 UUIDs with the index in the first bytes)
+  srand(time(NULL) ^ getpid());
+  g_nodes = new SimNode[g_nodeCount];
+  for(int i=0; i<g_nodeCount; i++) {
+    SimNode *pNode = &g_nodes[i];
+    for(int j=0; j<NET_UUID_SIZE; j++)
+      pNode->m_nodeID[j] = rand();
+    pNode->m_nodeID[0] = i;
+    pNode->m_nodeID[1] = i >> 8;
+    pNode->m_nodeID[2] = i >> 16;
+    pNode->m_nodeID[6] = (pNode->m_nodeID[6] & 0x0f) | 0x40;
+    pNode->m_nodeID[8] = (pNode->m_nodeID[8] & 0x3f) | 0x80;
+    pNode->m_address = NET_ADDRESS_NONE;
+    pNode->m_sequence = 0;
+    }
+  // Join all the nodes
+  ILog("Joining %d nodes ...", g_nodeCount);
+  double start = timeNow();
+  for(int i=0; i<g_nodeCount; i++) {
+    sendFrame(&g_nodes[i], NET_JOIN, g_nodes[i].m_nodeID, NET_UUID_SIZE);
+    processReplies();
+    }
+  while((g_joined<g_nodeCount)&&((timeNow() - start)<JOIN_TIMEOUT)) {
+    processReplies();
+    usleep(1000);
+    }
+  if(g_joined<g_nodeCount) {
+    ELog("Only %d of %d nodes joined.", g_joined, g_nodeCount);
+    unlink(local.sun_path);
+    return 1;
+    }
+  ILog("All nodes joined in %.3f seconds.", timeNow() - start);
+  // Send readings in 1ms batches
+  NET_READING readings[READINGS_PER_FRAME];
+  uint64_t sent = 0;
+  int next = 0;
+  start = timeNow();
+  double now = start;
+  while((now - start)<duration) {
+    uint64_t target = (uint64_t)((now - start) * rate) + 1;
+    for(; sent<target; sent++) {
+      SimNode *pNode = &g_nodes[next];
+      next = (next + 1) % g_nodeCount;
+      for(int i=0; i<READINGS_PER_FRAME; i++) {
+        readings[i].m_channel = i;
+        netPut16(readings[i].m_value, (uint16_t)(sent + i));
+        }
+      if(!sendFrame(pNode, NET_READINGS, readings, sizeof(readings)))
+        break;
+      }
+    usleep(1000);
+    now = timeNow();
+    }
+  now = timeNow();
+  ILog("Sent %llu frames in %.3f seconds (%.0f frames/s).", (unsigned long long)sent, now - start, sent / (now - start));
+  unlink(local.sun_path);
+  close(g_socket);
+  delete[] g_nodes;
+  return 0;
+  }
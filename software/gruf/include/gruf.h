@@ -4,6 +4,11 @@
 * 27-Oct-2015 ShaneG
 *
 * Provides common functions and structures used by the GRUF utility.
+*
+* 19-Oct-2026
+*
+* Added the firmware delta functions used to build over the air updates,
+* the firmware cache and the file mapping functions it uses.
 *---------------------------------------------------------------------------*/
 #ifndef __GRUF_H
 #define __GRUF_H
@@ -104,6 +109,63 @@ bool uuidCreate(uint8_t *uuid);
  */
 const char *uuidPrint(uint8_t *uuid);
 
+//---------------------------------------------------------------------------
+// File access
+//---------------------------------------------------------------------------
+
+/** Information used to detect changes to a file
+ */
+struct FileInfo {
+  uint64_t m_size;     //!< Size of the file in bytes
+  uint64_t m_modified; //!< Modification time (platform specific units)
+  };
+
+/** Get the size and modification time of a file
+ *
+ * @param cszFilename the name of the file.
+ * @param pInfo receives the information.
+ *
+ * @return true if the information is available, false if not.
+ */
+bool fileInfo(const char *cszFilename, FileInfo *pInfo);
+
+/** A file mapped into memory
+ *
+ * The mapping is copy on write, changes made through data() are private to
+ * the process and never written back to the file.
+ */
+class MappedFile {
+  public:
+    /** Destructor
+     *
+     * Unmaps the file.
+     */
+    virtual ~MappedFile() { }
+
+    /** Get the contents of the file
+     *
+     * @return a pointer to the first byte of the file.
+     */
+    virtual uint8_t *data() = 0;
+
+    /** Get the size of the mapping
+     *
+     * @return the number of bytes mapped.
+     */
+    virtual uint32_t size() = 0;
+  };
+
+/** Map a file into memory
+ *
+ * This is a generic wrapper around the underlying operating system
+ * implementation.
+ *
+ * @param cszFilename the name of the file to map.
+ *
+ * @return a MappedFile instance or NULL if the file could not be mapped.
+ */
+MappedFile *mapFile(const char *cszFilename);
+
 //---------------------------------------------------------------------------
 // The generic flasher interface
 //---------------------------------------------------------------------------
@@ -204,6 +266,10 @@ const uint32_t INVALID_ADDRESS = (uint32_t)-1L;
  */
 class Firmware {
   public:
+    /** Destructor
+     */
+    virtual ~Firmware() { }
+
     /** The ID types that can be patched
      */
     enum ID {
@@ -299,6 +365,104 @@ class Firmware {
  */
 Firmware *loadFirmware(const char *cszFilename);
 
+/** Replace an ID marker in a list of blocks
+ *
+ * Used by the Firmware implementations to provide patchID().
+ *
+ * @param pFirst the first block to search.
+ * @param id the type of ID to change
+ * @param uuid the 16 byte UUID value to insert into the code.
+ *
+ * @return the address at which the ID was found or INVALID_ADDRESS if the
+ *         marker is not present.
+ */
+uint32_t patchMarker(Firmware::Block *pFirst, Firmware::ID id, const uint8_t *uuid);
+
+/** Find an ID marker in a list of blocks
+ *
+ * Used to check where the IDs are without changing them.
+ *
+ * @param pFirst the first block to search.
+ * @param id the type of ID to find.
+ *
+ * @return the address of the marker or INVALID_ADDRESS if the marker is not
+ *         present.
+ */
+uint32_t findMarker(Firmware::Block *pFirst, Firmware::ID id);
+
+/** Load firmware through the firmware cache
+ *
+ * The blocks parsed from a hex file are saved in a cache file alongside it
+ * (the name of the hex file with '.cache' added). If the size and
+ * modification time of the hex file have not changed the firmware is loaded
+ * by mapping the cache. Otherwise the hex file is loaded with loadFirmware()
+ * and the cache updated, unless the contents of the file are unchanged (the
+ * cache holds a hash of the file).
+ *
+ * @param cszFilename the name of the hex file containing the firmware data.
+ *
+ * @return a pointer to a Firmware instance containing the data or NULL if an
+ *         error occurs.
+ */
+Firmware *loadCachedFirmware(const char *cszFilename);
+
+//---------------------------------------------------------------------------
+// Firmware deltas
+//---------------------------------------------------------------------------
+
+/** Statistics for a delta
+ */
+struct DeltaStats {
+  uint32_t m_copied;   //!< Bytes copied from the old image
+  uint32_t m_literal;  //!< Bytes sent as literal data
+  uint32_t m_commands; //!< Number of commands (excluding DELTA_END)
+  };
+
+/** Get the flat image of a firmware from a given address
+ *
+ * Gaps between blocks are filled with zeros, data before the base address
+ * is not included.
+ *
+ * @param pFirmware the firmware.
+ * @param base the address of the first byte of the image.
+ * @param pSize receives the size of the image.
+ *
+ * @return the image (allocated with malloc()) or NULL if the firmware has no
+ *         data at or after the base address.
+ */
+uint8_t *getImage(Firmware *pFirmware, uint32_t base, uint32_t *pSize);
+
+/** Build a delta that converts one image into another
+ *
+ * The delta uses the format defined in the firmware (see delta.h) and can be
+ * sent to a node with the gateway.
+ *
+ * @param pOld the image installed on the device.
+ * @param oldSize the size of the old image.
+ * @param pNew the image to install.
+ * @param newSize the size of the new image.
+ * @param pLength receives the length of the delta.
+ * @param pStats receives statistics about the delta (may be NULL).
+ *
+ * @return the delta (allocated with malloc()).
+ */
+uint8_t *createDelta(const uint8_t *pOld, uint32_t oldSize, const uint8_t *pNew, uint32_t newSize, uint32_t *pLength, DeltaStats *pStats);
+
+/** Apply a delta to an image
+ *
+ * Used to check a delta before it is sent to the devices.
+ *
+ * @param pOld the image the delta applies to.
+ * @param oldSize the size of the old image.
+ * @param pDelta the delta.
+ * @param length the length of the delta.
+ * @param pSize receives the size of the new image.
+ *
+ * @return the new image (allocated with malloc()) or NULL if the delta does
+ *         not apply to the old image or is invalid.
+ */
+uint8_t *applyDelta(const uint8_t *pOld, uint32_t oldSize, const uint8_t *pDelta, uint32_t length, uint32_t *pSize);
+
 //---------------------------------------------------------------------------
 // Bootloader interface
 //---------------------------------------------------------------------------
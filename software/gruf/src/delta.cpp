@@ -0,0 +1,348 @@
+/*---------------------------------------------------------------------------*
+* Grand Unified Flasher (GRUF) - Firmware Deltas
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Builds the deltas used for over the air updates (see delta.h in the
+* firmware). Every position in the old image is indexed by a rolling hash
+* of the DELTA_WINDOW bytes starting there, the new image is then scanned
+* with the same rolling hash to find code that has moved. Each match is
+* extended as far as possible and the longest is used. The position that
+* continues the previous match (with the same number of bytes skipped in
+* both images) is always tried first, it catches code that has only had a
+* few bytes changed (branch offsets and literal pool addresses) and needs
+* no DELTA_SEEK.
+*---------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <gruf.h>
+#include <delta.h>
+
+// Bytes covered by the rolling hash (the shortest match found by hashing)
+#define DELTA_WINDOW     8
+
+// Multiplier for the rolling hash
+#define DELTA_PRIME      0x01000193
+
+// Candidates checked for each position in the new image
+#define DELTA_CHAIN_MAX  64
+
+// A match must save at least this many bytes over sending literals
+#define DELTA_MIN_GAIN   3
+
+// Value used for gaps between blocks (as 'objcopy -O binary' does)
+#define DELTA_FILL       0x00
+
+/** Output buffer for the delta
+ */
+struct DeltaWriter {
+  uint8_t    *m_pData;     //!< The delta
+  uint32_t    m_length;    //!< Bytes used
+  uint32_t    m_capacity;  //!< Bytes allocated
+  uint32_t    m_position;  //!< Position in the old image when applied
+  DeltaStats *m_pStats;    //!< Statistics to update
+  };
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Add bytes to the delta
+ */
+static void deltaAppend(DeltaWriter &writer, const uint8_t *pData, uint32_t length) {
+  if((writer.m_length + length)>writer.m_capacity) {
+    while((writer.m_length + length)>writer.m_capacity)
+      writer.m_capacity = (writer.m_capacity==0) ? 4096 : (writer.m_capacity * 2);
+    writer.m_pData = (uint8_t *)realloc(writer.m_pData, writer.m_capacity);
+    }
+  memcpy(&writer.m_pData[writer.m_length], pData, length);
+  writer.m_length += length;
+  }
+
+/** Get the size of a value as a varint
+ */
+static uint32_t deltaVarintSize(uint32_t value) {
+  uint32_t size = 1;
+  for(; value>=0x80; value >>= 7)
+    size++;
+  return size;
+  }
+
+/** Add a command and its argument to the delta
+ */
+static void deltaCommand(DeltaWriter &writer, DELTA_OP op, uint32_t value) {
+  uint8_t command[1 + DELTA_VARINT_MAX];
+  int length = 0;
+  command[length++] = (uint8_t)op;
+  for(; value>=0x80; value >>= 7)
+    command[length++] = (uint8_t)(value | 0x80);
+  command[length++] = (uint8_t)value;
+  deltaAppend(writer, command, length);
+  if(writer.m_pStats!=NULL)
+    writer.m_pStats->m_commands++;
+  }
+
+/** Encode a signed value for DELTA_SEEK
+ */
+static uint32_t deltaZigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  }
+
+/** Get the cost of moving the old image position
+ */
+static uint32_t deltaSeekCost(uint32_t from, uint32_t to) {
+  return (from==to) ? 0 : (1 + deltaVarintSize(deltaZigzag((int32_t)(to - from))));
+  }
+
+/** Add literal data to the delta
+ */
+static void deltaLiteral(DeltaWriter &writer, const uint8_t *pData, uint32_t length) {
+  if(length==0)
+    return;
+  deltaCommand(writer, DELTA_DATA, length);
+  deltaAppend(writer, pData, length);
+  if(writer.m_pStats!=NULL)
+    writer.m_pStats->m_literal += length;
+  }
+
+/** Add a copy from the old image to the delta
+ */
+static void deltaCopy(DeltaWriter &writer, uint32_t position, uint32_t length) {
+  if(position!=writer.m_position)
+    deltaCommand(writer, DELTA_SEEK, deltaZigzag((int32_t)(position - writer.m_position)));
+  deltaCommand(writer, DELTA_COPY, length);
+  writer.m_position = position + length;
+  if(writer.m_pStats!=NULL)
+    writer.m_pStats->m_copied += length;
+  }
+
+/** Determine how many bytes match
+ */
+static uint32_t deltaMatch(const uint8_t *pOld, uint32_t oldSize, uint32_t oldPos, const uint8_t *pNew, uint32_t newSize, uint32_t newPos) {
+  uint32_t length = 0;
+  while(((oldPos + length)<oldSize)&&((newPos + length)<newSize)&&(pOld[oldPos + length]==pNew[newPos + length]))
+    length++;
+  return length;
+  }
+
+/** Calculate the hash of the window at the start of a buffer
+ */
+static uint32_t deltaHash(const uint8_t *pData) {
+  uint32_t hash = 0;
+  for(int i=0; i<DELTA_WINDOW; i++)
+    hash = (hash * DELTA_PRIME) + pData[i];
+  return hash;
+  }
+
+/** Write a value least significant byte first
+ */
+static void deltaPut32(uint8_t *pData, uint32_t value) {
+  for(int i=0; i<4; i++, value >>= 8)
+    pData[i] = (uint8_t)value;
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Get the flat image of a firmware from a given address
+ *
+ * Gaps between blocks are filled with zeros, data before the base address
+ * is not included.
+ *
+ * @param pFirmware the firmware.
+ * @param base the address of the first byte of the image.
+ * @param pSize receives the size of the image.
+ *
+ * @return the image (allocated with malloc()) or NULL if the firmware has no
+ *         data at or after the base address.
+ */
+uint8_t *getImage(Firmware *pFirmware, uint32_t base, uint32_t *pSize) {
+  uint32_t last = pFirmware->lastAddress();
+  if((last==INVALID_ADDRESS)||(last<base))
+    return NULL;
+  uint32_t size = last - base + 1;
+  uint8_t *pImage = (uint8_t *)malloc(size);
+  memset(pImage, DELTA_FILL, size);
+  for(Firmware::Block *pBlock = pFirmware->first(); pBlock!=NULL; pBlock = pBlock->m_next) {
+    uint32_t start = (pBlock->m_base<base) ? base : pBlock->m_base;
+    uint32_t end = pBlock->m_base + pBlock->m_size;
+    if(end>start)
+      memcpy(&pImage[start - base], &pBlock->m_data[start - pBlock->m_base], end - start);
+    }
+  *pSize = size;
+  return pImage;
+  }
+
+/** Build a delta that converts one image into another
+ *
+ * @param pOld the image installed on the device.
+ * @param oldSize the size of the old image.
+ * @param pNew the image to install.
+ * @param newSize the size of the new image.
+ * @param pLength receives the length of the delta.
+ * @param pStats receives statistics about the delta (may be NULL).
+ *
+ * @return the delta (allocated with malloc()).
+ */
+uint8_t *createDelta(const uint8_t *pOld, uint32_t oldSize, const uint8_t *pNew, uint32_t newSize, uint32_t *pLength, DeltaStats *pStats) {
+  DeltaWriter writer = { NULL, 0, 0, 0, pStats };
+  if(pStats!=NULL)
+    memset(pStats, 0, sizeof(DeltaStats));
+  // Header
+  DELTA_HEADER header;
+  header.m_magic[0] = DELTA_MAGIC0;
+  header.m_magic[1] = DELTA_MAGIC1;
+  header.m_magic[2] = DELTA_MAGIC2;
+  header.m_magic[3] = DELTA_MAGIC3;
+  deltaPut32(header.m_oldSize, oldSize);
+  deltaPut32(header.m_newSize, newSize);
+  deltaPut32(header.m_oldCrc, deltaCrc(pOld, oldSize));
+  deltaPut32(header.m_newCrc, deltaCrc(pNew, newSize));
+  deltaAppend(writer, (const uint8_t *)&header, sizeof(header));
+  // Index every window in the old image (chains hold the latest first)
+  uint32_t buckets = 1024;
+  while(buckets<(oldSize * 2))
+    buckets *= 2;
+  uint32_t *pHead = (uint32_t *)malloc(buckets * sizeof(uint32_t));
+  uint32_t *pChain = (uint32_t *)malloc((oldSize + 1) * sizeof(uint32_t));
+  memset(pHead, 0xff, buckets * sizeof(uint32_t));
+  uint32_t power = 1;
+  for(int i=1; i<DELTA_WINDOW; i++)
+    power *= DELTA_PRIME;
+  if(oldSize>=DELTA_WINDOW) {
+    uint32_t hash = deltaHash(pOld);
+    for(uint32_t pos=0; ; pos++) {
+      uint32_t bucket = hash & (buckets - 1);
+      pChain[pos] = pHead[bucket];
+      pHead[bucket] = pos;
+      if((pos + DELTA_WINDOW)>=oldSize)
+        break;
+      hash = ((hash - (pOld[pos] * power)) * DELTA_PRIME) + pOld[pos + DELTA_WINDOW];
+      }
+    }
+  // Scan the new image
+  uint32_t literal = 0, newPos = 0;
+  uint32_t hash = (newSize>=DELTA_WINDOW) ? deltaHash(pNew) : 0;
+  while(newPos<newSize) {
+    // Continue from the previous match first
+    uint32_t bestPos = writer.m_position + literal, bestLength = 0;
+    if(bestPos<oldSize)
+      bestLength = deltaMatch(pOld, oldSize, bestPos, pNew, newSize, newPos);
+    int bestGain = (int)bestLength - (int)(deltaSeekCost(writer.m_position, bestPos) + 1 + deltaVarintSize(bestLength));
+    // Look for moved code
+    if(((newPos + DELTA_WINDOW)<=newSize)&&(oldSize>=DELTA_WINDOW)) {
+      int checked = 0;
+      for(uint32_t pos = pHead[hash & (buckets - 1)]; (pos!=0xffffffff)&&(checked<DELTA_CHAIN_MAX); pos = pChain[pos], checked++) {
+        uint32_t length = deltaMatch(pOld, oldSize, pos, pNew, newSize, newPos);
+        int gain = (int)length - (int)(deltaSeekCost(writer.m_position, pos) + 1 + deltaVarintSize(length));
+        if(gain>bestGain) {
+          bestPos = pos;
+          bestLength = length;
+          bestGain = gain;
+          }
+        }
+      }
+    uint32_t advance = 1;
+    if(bestGain>=DELTA_MIN_GAIN) {
+      deltaLiteral(writer, &pNew[newPos - literal], literal);
+      literal = 0;
+      deltaCopy(writer, bestPos, bestLength);
+      advance = bestLength;
+      }
+    else
+      literal++;
+    // Move the rolling hash along
+    for(; advance>0; advance--, newPos++) {
+      if((newPos + DELTA_WINDOW)<newSize)
+        hash = ((hash - (pNew[newPos] * power)) * DELTA_PRIME) + pNew[newPos + DELTA_WINDOW];
+      }
+    }
+  deltaLiteral(writer, &pNew[newPos - literal], literal);
+  uint8_t end = DELTA_END;
+  deltaAppend(writer, &end, 1);
+  free(pHead);
+  free(pChain);
+  *pLength = writer.m_length;
+  return writer.m_pData;
+  }
+
+/** Apply a delta to an image
+ *
+ * Used to check a delta before it is sent to the devices.
+ *
+ * @param pOld the image the delta applies to.
+ * @param oldSize the size of the old image.
+ * @param pDelta the delta.
+ * @param length the length of the delta.
+ * @param pSize receives the size of the new image.
+ *
+ * @return the new image (allocated with malloc()) or NULL if the delta does
+ *         not apply to the old image or is invalid.
+ */
+uint8_t *applyDelta(const uint8_t *pOld, uint32_t oldSize, const uint8_t *pDelta, uint32_t length, uint32_t *pSize) {
+  if(length<sizeof(DELTA_HEADER))
+    return NULL;
+  const DELTA_HEADER *pHeader = (const DELTA_HEADER *)pDelta;
+  if((pHeader->m_magic[0]!=DELTA_MAGIC0)||(pHeader->m_magic[1]!=DELTA_MAGIC1)||
+    (pHeader->m_magic[2]!=DELTA_MAGIC2)||(pHeader->m_magic[3]!=DELTA_MAGIC3))
+    return NULL;
+  uint32_t headerOldSize = 0, newSize = 0, oldCrc = 0, newCrc = 0;
+  for(int i=3; i>=0; i--) {
+    headerOldSize = (headerOldSize << 8) | pHeader->m_oldSize[i];
+    newSize = (newSize << 8) | pHeader->m_newSize[i];
+    oldCrc = (oldCrc << 8) | pHeader->m_oldCrc[i];
+    newCrc = (newCrc << 8) | pHeader->m_newCrc[i];
+    }
+  if((headerOldSize!=oldSize)||(oldCrc!=deltaCrc(pOld, oldSize)))
+    return NULL;
+  uint8_t *pNew = (uint8_t *)malloc((newSize==0) ? 1 : newSize);
+  uint32_t offset = sizeof(DELTA_HEADER), position = 0, written = 0;
+  while(offset<length) {
+    uint8_t op = pDelta[offset++];
+    if(op==DELTA_END) {
+      if((written==newSize)&&(deltaCrc(pNew, newSize)==newCrc)) {
+        *pSize = newSize;
+        return pNew;
+        }
+      break;
+      }
+    // Read the argument
+    uint32_t value = 0;
+    int shift = 0;
+    bool more = true;
+    while(more&&(offset<length)&&(shift<(DELTA_VARINT_MAX * 7))) {
+      value |= (uint32_t)(pDelta[offset] & 0x7f) << shift;
+      more = (pDelta[offset++] & 0x80)!=0;
+      shift += 7;
+      }
+    if(more)
+      break;
+    if(op==DELTA_COPY) {
+      if((value>(oldSize - position))||(value>(newSize - written)))
+        break;
+      memcpy(&pNew[written], &pOld[position], value);
+      position += value;
+      written += value;
+      }
+    else if(op==DELTA_DATA) {
+      if((value>(length - offset))||(value>(newSize - written)))
+        break;
+      memcpy(&pNew[written], &pDelta[offset], value);
+      offset += value;
+      written += value;
+      }
+    else if(op==DELTA_SEEK) {
+      position += (uint32_t)((int32_t)(value >> 1) ^ -(int32_t)(value & 1));
+      if(position>oldSize)
+        break;
+      }
+    else
+      break;
+    }
+  free(pNew);
+  return NULL;
+  }
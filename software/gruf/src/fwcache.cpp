@@ -0,0 +1,341 @@
+/*---------------------------------------------------------------------------*
+* Grand Unified Flasher (GRUF) - Firmware Cache
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Saves the blocks parsed from a hex file so later runs (flashing a batch of
+* boards for example) can load them by mapping a single file instead of
+* parsing the hex file again. The cache file is laid out so it can be used
+* directly once mapped -
+*
+*   CacheHeader
+*   CacheBlock[m_blocks]
+*   block data (in the same order as the blocks)
+*
+* All values are in the byte order of the host. The header records the size,
+* modification time and hash of the hex file it was built from, the cache is
+* only used if the size and modification time still match. If they don't the
+* hex file is hashed, a matching hash (the file was copied or touched) just
+* updates the header.
+*---------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <string>
+#include <gruf.h>
+
+// Identifies a cache file (changes if the layout does)
+#define CACHE_MAGIC      0x31435247 // 'GRC1'
+
+// Added to the hex file name to get the cache file name
+#define CACHE_EXTENSION  ".cache"
+
+// FNV-1a parameters (64 bit)
+#define HASH_BASIS       0xcbf29ce484222325ULL
+#define HASH_PRIME       0x00000100000001b3ULL
+
+/** Cache file header
+ */
+struct CacheHeader {
+  uint32_t m_magic;    //!< CACHE_MAGIC
+  uint32_t m_blocks;   //!< Number of blocks
+  uint64_t m_size;     //!< Size of the hex file
+  uint64_t m_modified; //!< Modification time of the hex file
+  uint64_t m_hash;     //!< Hash of the hex file contents
+  uint32_t m_length;   //!< Length of the cache file
+  uint32_t m_reserved; //!< Keeps the header a multiple of 8 bytes
+  };
+
+/** Cache entry for a single block
+ */
+struct CacheBlock {
+  uint32_t m_base;     //!< Base address of the block
+  uint32_t m_size;     //!< Size of the block (in bytes)
+  uint32_t m_offset;   //!< Offset of the data from the start of the cache
+  uint32_t m_reserved; //!< Keeps entries a multiple of 8 bytes
+  };
+
+/** Firmware loaded from a mapped cache file
+ *
+ * The block data points directly into the mapping, it is copy on write so
+ * patching the IDs does not change the cache.
+ */
+class CachedFirmware : public Firmware {
+  private:
+    MappedFile *m_pMapping; // The cache file
+    Block      *m_pFirst;   // First block
+
+  public:
+    /** Constructor
+     *
+     * @param pMapping the mapped cache file (which must have been validated).
+     */
+    CachedFirmware(MappedFile *pMapping) {
+      m_pMapping = pMapping;
+      m_pFirst = NULL;
+      const CacheHeader *pHeader = (const CacheHeader *)pMapping->data();
+      const CacheBlock *pEntry = (const CacheBlock *)&pHeader[1];
+      for(uint32_t index=pHeader->m_blocks; index>0; index--) {
+        Block *pBlock = new Block;
+        pBlock->m_base = pEntry[index - 1].m_base;
+        pBlock->m_size = pEntry[index - 1].m_size;
+        pBlock->m_data = pMapping->data() + pEntry[index - 1].m_offset;
+        pBlock->m_next = m_pFirst;
+        m_pFirst = pBlock;
+        }
+      }
+
+    /** Destructor
+     */
+    virtual ~CachedFirmware() {
+      while(m_pFirst!=NULL) {
+        Block *pNext = m_pFirst->m_next;
+        delete m_pFirst;
+        m_pFirst = pNext;
+        }
+      delete m_pMapping;
+      }
+
+    //-----------------------------------------------------------------------
+    // Public API
+    //-----------------------------------------------------------------------
+
+    /** Get the first block in the firmware
+     *
+     * @return a pointer to the first block of memory to be written or NULL if
+     *         there is no data.
+     */
+    virtual Block *first() {
+      return m_pFirst;
+      }
+
+    /** Get the start address of the flash data to be written
+     *
+     * @return the start address of the firmware data or INVALID_ADDRESS if no
+     *         data is available.
+     */
+    virtual uint32_t baseAddress() {
+      return (m_pFirst==NULL) ? INVALID_ADDRESS : m_pFirst->m_base;
+      }
+
+    /** Get the last address referenced in the firmware
+     *
+     * @return the highest address containing data to be written or INVALID_ADDRESS
+     *         if no data is available.
+     */
+    virtual uint32_t lastAddress() {
+      if(m_pFirst==NULL)
+        return INVALID_ADDRESS;
+      Block *pBlock = m_pFirst;
+      while(pBlock->m_next!=NULL)
+        pBlock = pBlock->m_next;
+      return pBlock->m_base + pBlock->m_size - 1;
+      }
+
+    /** Get the total size of the firmware
+     *
+     * @return the total number of bytes covered by the firmware.
+     */
+    virtual uint32_t totalSize() {
+      if(m_pFirst==NULL)
+        return 0;
+      return lastAddress() - baseAddress() + 1;
+      }
+
+    /** Get the number of bytes that need to be written to the target flash.
+     *
+     * @return the number of bytes to write to the target.
+     */
+    virtual uint32_t flashSize() {
+      uint32_t size = 0;
+      for(Block *pBlock = m_pFirst; pBlock!=NULL; pBlock = pBlock->m_next)
+        size += pBlock->m_size;
+      return size;
+      }
+
+    /** Patch the firmware with a new ID code
+     *
+     * Only the mapped copy is changed, the cache file is not modified.
+     *
+     * @param id the type of ID to change
+     * @param uuid the 16 byte UUID value to insert into the code.
+     *
+     * @return the address at which the ID was found or INVALID_ADDRESS if the
+     *         location could not be determined.
+     */
+    virtual uint32_t patchID(ID id, const uint8_t *uuid) {
+      return patchMarker(m_pFirst, id, uuid);
+      }
+  };
+
+//---------------------------------------------------------------------------
+// Internal implementation
+//---------------------------------------------------------------------------
+
+/** Get the name of the cache file for a hex file
+ */
+static std::string cacheName(const char *cszFilename) {
+  return std::string(cszFilename) + CACHE_EXTENSION;
+  }
+
+/** Calculate the hash of a file
+ *
+ * @param cszFilename the name of the file.
+ * @param pHash receives the hash.
+ *
+ * @return true if the file was read.
+ */
+static bool hashFile(const char *cszFilename, uint64_t *pHash) {
+  FILE *fp = fopen(cszFilename, "rb");
+  if(fp==NULL)
+    return false;
+  uint64_t hash = HASH_BASIS;
+  uint8_t buffer[4096];
+  size_t count;
+  while((count = fread(buffer, 1, sizeof(buffer), fp))>0) {
+    for(size_t i=0; i<count; i++)
+      hash = (hash ^ buffer[i]) * HASH_PRIME;
+    }
+  bool ok = !ferror(fp);
+  fclose(fp);
+  *pHash = hash;
+  return ok;
+  }
+
+/** Check a mapped cache file is complete and consistent
+ *
+ * @param pMapping the mapped cache file.
+ *
+ * @return the header if the cache can be used or NULL if it is invalid.
+ */
+static const CacheHeader *cacheCheck(MappedFile *pMapping) {
+  uint32_t size = pMapping->size();
+  if(size<sizeof(CacheHeader))
+    return NULL;
+  const CacheHeader *pHeader = (const CacheHeader *)pMapping->data();
+  if((pHeader->m_magic!=CACHE_MAGIC)||(pHeader->m_length!=size))
+    return NULL;
+  if(pHeader->m_blocks>((size - sizeof(CacheHeader)) / sizeof(CacheBlock)))
+    return NULL;
+  const CacheBlock *pEntry = (const CacheBlock *)&pHeader[1];
+  uint32_t offset = sizeof(CacheHeader) + (pHeader->m_blocks * sizeof(CacheBlock));
+  for(uint32_t index=0; index<pHeader->m_blocks; index++) {
+    if((pEntry[index].m_offset!=offset)||(pEntry[index].m_size>(size - offset)))
+      return NULL;
+    if((index>0)&&(pEntry[index].m_base<=(pEntry[index - 1].m_base + pEntry[index - 1].m_size - 1)))
+      return NULL;
+    offset += pEntry[index].m_size;
+    }
+  return (offset==size) ? pHeader : NULL;
+  }
+
+/** Record new details of the hex file in an existing cache
+ *
+ * @param cszCache the name of the cache file.
+ * @param pHeader the header to write.
+ *
+ * @return true if the header was updated.
+ */
+static bool cacheStamp(const char *cszCache, const CacheHeader *pHeader) {
+  FILE *fp = fopen(cszCache, "r+b");
+  if(fp==NULL)
+    return false;
+  bool ok = (fwrite(pHeader, sizeof(CacheHeader), 1, fp)==1);
+  return (fclose(fp)==0)&&ok;
+  }
+
+/** Write the cache for a firmware image
+ *
+ * The cache is written to a temporary file which then replaces the old one
+ * so a partially written cache is never used.
+ *
+ * @param cszCache the name of the cache file.
+ * @param pFirmware the firmware to save.
+ * @param info the size and modification time of the hex file.
+ * @param hash the hash of the hex file.
+ *
+ * @return true if the cache was written.
+ */
+static bool cacheWrite(const char *cszCache, Firmware *pFirmware, const FileInfo &info, uint64_t hash) {
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  header.m_magic = CACHE_MAGIC;
+  header.m_size = info.m_size;
+  header.m_modified = info.m_modified;
+  header.m_hash = hash;
+  for(Firmware::Block *pBlock = pFirmware->first(); pBlock!=NULL; pBlock = pBlock->m_next)
+    header.m_blocks++;
+  header.m_length = sizeof(CacheHeader) + (header.m_blocks * sizeof(CacheBlock)) + pFirmware->flashSize();
+  std::string temp = std::string(cszCache) + ".tmp";
+  FILE *fp = fopen(temp.c_str(), "wb");
+  if(fp==NULL)
+    return false;
+  bool ok = (fwrite(&header, sizeof(header), 1, fp)==1);
+  uint32_t offset = sizeof(CacheHeader) + (header.m_blocks * sizeof(CacheBlock));
+  for(Firmware::Block *pBlock = pFirmware->first(); ok&&(pBlock!=NULL); pBlock = pBlock->m_next) {
+    CacheBlock entry = { pBlock->m_base, pBlock->m_size, offset, 0 };
+    ok = (fwrite(&entry, sizeof(entry), 1, fp)==1);
+    offset += pBlock->m_size;
+    }
+  for(Firmware::Block *pBlock = pFirmware->first(); ok&&(pBlock!=NULL); pBlock = pBlock->m_next)
+    ok = (fwrite(pBlock->m_data, 1, pBlock->m_size, fp)==pBlock->m_size);
+  ok = (fclose(fp)==0)&&ok;
+  // Windows will not rename over an existing file
+  if(ok&&(rename(temp.c_str(), cszCache)!=0)) {
+    remove(cszCache);
+    ok = (rename(temp.c_str(), cszCache)==0);
+    }
+  if(!ok)
+    remove(temp.c_str());
+  return ok;
+  }
+
+//---------------------------------------------------------------------------
+// Public API
+//---------------------------------------------------------------------------
+
+/** Load firmware through the firmware cache
+ *
+ * @param cszFilename the name of the hex file containing the firmware data.
+ *
+ * @return a pointer to a Firmware instance containing the data or NULL if an
+ *         error occurs.
+ */
+Firmware *loadCachedFirmware(const char *cszFilename) {
+  FileInfo info;
+  if(!fileInfo(cszFilename, &info))
+    return loadFirmware(cszFilename); // Let the loader report the error
+  std::string cache = cacheName(cszFilename);
+  MappedFile *pMapping = mapFile(cache.c_str());
+  const CacheHeader *pHeader = (pMapping==NULL) ? NULL : cacheCheck(pMapping);
+  if((pHeader!=NULL)&&(pHeader->m_size==info.m_size)&&(pHeader->m_modified==info.m_modified)) {
+    DLog("Loaded %u blocks from cache '%s'.", pHeader->m_blocks, cache.c_str());
+    return new CachedFirmware(pMapping);
+    }
+  // The hex file may have been touched or copied without changing
+  uint64_t hash;
+  if(!hashFile(cszFilename, &hash)) {
+    delete pMapping;
+    return loadFirmware(cszFilename);
+    }
+  if((pHeader!=NULL)&&(pHeader->m_size==info.m_size)&&(pHeader->m_hash==hash)) {
+    CacheHeader header = *pHeader;
+    header.m_modified = info.m_modified;
+    if(cacheStamp(cache.c_str(), &header))
+      DLog("Updated cache '%s', hex file is unchanged.", cache.c_str());
+    DLog("Loaded %u blocks from cache '%s'.", pHeader->m_blocks, cache.c_str());
+    return new CachedFirmware(pMapping);
+    }
+  delete pMapping;
+  // Parse the hex file and save the result
+  Firmware *pFirmware = loadFirmware(cszFilename);
+  if(pFirmware==NULL)
+    return NULL;
+  if(cacheWrite(cache.c_str(), pFirmware, info, hash))
+    DLog("Saved firmware to cache '%s'.", cache.c_str());
+  else
+    DLog("Unable to write cache '%s'.", cache.c_str());
+  return pFirmware;
+  }
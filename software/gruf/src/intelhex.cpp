@@ -4,17 +4,116 @@
 * 27-Oct-2015 ShaneG
 *
 * Implementation of the Firmware interface for Intel Hex files.
+*
+* 19-Oct-2026
+*
+* The loader now parses the file. Data records are merged into contiguous
+* blocks as they are read (extended segment and extended linear addresses
+* are supported) and the NODEID/TYPEID markers can be patched. The marker
+* search is shared with the firmware cache (see fwcache.cpp).
 *---------------------------------------------------------------------------*/
 #include <stdlib.h>
+#include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <stdbool.h>
 #include <gruf.h>
+#include <netframe.h>
+
+// Longest line accepted (255 data bytes plus overhead)
+#define MAX_LINE_LENGTH 600
+
+// Intel Hex record types
+#define RECORD_DATA             0x00
+#define RECORD_EOF              0x01
+#define RECORD_SEGMENT_ADDRESS  0x02
+#define RECORD_SEGMENT_START    0x03
+#define RECORD_LINEAR_ADDRESS   0x04
+#define RECORD_LINEAR_START     0x05
+
+// Marker values for the IDs (see netframe.h)
+static const uint8_t NODEID_MARKER[UUID_LENGTH] = NET_NODEID_MARKER;
+static const uint8_t TYPEID_MARKER[UUID_LENGTH] = NET_TYPEID_MARKER;
 
 class FirmwareImpl : public Firmware {
+  private:
+    Block *m_pFirst; // First block
+    Block *m_pLast;  // Block that was last extended
+
   public:
     /** Default constructor
      */
     FirmwareImpl() {
+      m_pFirst = NULL;
+      m_pLast = NULL;
+      }
+
+    /** Destructor
+     */
+    virtual ~FirmwareImpl() {
+      while(m_pFirst!=NULL) {
+        Block *pNext = m_pFirst->m_next;
+        free(m_pFirst->m_data);
+        delete m_pFirst;
+        m_pFirst = pNext;
+        }
+      }
+
+    /** Add data to the firmware
+     *
+     * Data following on from the end of a block is added to that block,
+     * blocks that become contiguous are merged.
+     *
+     * @param address the address of the data.
+     * @param pData the data to add.
+     * @param length the number of bytes.
+     *
+     * @return true if the data was added, false if it overlaps existing data.
+     */
+    bool addData(uint32_t address, const uint8_t *pData, uint32_t length) {
+      if(length==0)
+        return true;
+      // Find the block before the data (records are usually in order)
+      Block *pPrev = NULL, *pNext = m_pFirst;
+      if((m_pLast!=NULL)&&(m_pLast->m_base<=address)) {
+        pPrev = m_pLast;
+        pNext = m_pLast->m_next;
+        }
+      while((pNext!=NULL)&&(pNext->m_base<=address)) {
+        pPrev = pNext;
+        pNext = pNext->m_next;
+        }
+      if((pPrev!=NULL)&&(address<(pPrev->m_base + pPrev->m_size)))
+        return false;
+      if((pNext!=NULL)&&((address + length)>pNext->m_base))
+        return false;
+      if((pPrev==NULL)||((pPrev->m_base + pPrev->m_size)!=address)) {
+        // Start a new block
+        Block *pBlock = new Block;
+        pBlock->m_base = address;
+        pBlock->m_size = 0;
+        pBlock->m_data = NULL;
+        pBlock->m_next = pNext;
+        if(pPrev==NULL)
+          m_pFirst = pBlock;
+        else
+          pPrev->m_next = pBlock;
+        pPrev = pBlock;
+        }
+      pPrev->m_data = (uint8_t *)realloc(pPrev->m_data, pPrev->m_size + length);
+      memcpy(&pPrev->m_data[pPrev->m_size], pData, length);
+      pPrev->m_size += length;
+      // Merge with the next block if they now touch
+      if((pNext!=NULL)&&((pPrev->m_base + pPrev->m_size)==pNext->m_base)) {
+        pPrev->m_data = (uint8_t *)realloc(pPrev->m_data, pPrev->m_size + pNext->m_size);
+        memcpy(&pPrev->m_data[pPrev->m_size], pNext->m_data, pNext->m_size);
+        pPrev->m_size += pNext->m_size;
+        pPrev->m_next = pNext->m_next;
+        free(pNext->m_data);
+        delete pNext;
+        }
+      m_pLast = pPrev;
+      return true;
       }
 
     //-----------------------------------------------------------------------
@@ -31,7 +130,7 @@ class FirmwareImpl : public Firmware {
      *         there is no data.
      */
     virtual Block *first() {
-      return NULL;
+      return m_pFirst;
       }
 
     /** Get the start address of the flash data to be written
@@ -42,7 +141,7 @@ class FirmwareImpl : public Firmware {
      *         data is available.
      */
     virtual uint32_t baseAddress() {
-      return INVALID_ADDRESS;
+      return (m_pFirst==NULL) ? INVALID_ADDRESS : m_pFirst->m_base;
       }
 
     /** Get the last address referenced in the firmware
@@ -51,7 +150,12 @@ class FirmwareImpl : public Firmware {
      *         if no data is available.
      */
     virtual uint32_t lastAddress() {
-      return INVALID_ADDRESS;
+      if(m_pFirst==NULL)
+        return INVALID_ADDRESS;
+      Block *pBlock = m_pFirst;
+      while(pBlock->m_next!=NULL)
+        pBlock = pBlock->m_next;
+      return pBlock->m_base + pBlock->m_size - 1;
       }
 
     /** Get the total size of the firmware
@@ -63,7 +167,9 @@ class FirmwareImpl : public Firmware {
      * @return the total number of bytes covered by the firmware.
      */
     virtual uint32_t totalSize() {
-      return 0;
+      if(m_pFirst==NULL)
+        return 0;
+      return lastAddress() - baseAddress() + 1;
       }
 
     /** Get the number of bytes that need to be written to the target flash.
@@ -74,7 +180,10 @@ class FirmwareImpl : public Firmware {
      * @return the number of bytes to write to the target.
      */
     virtual uint32_t flashSize() {
-      return 0;
+      uint32_t size = 0;
+      for(Block *pBlock = m_pFirst; pBlock!=NULL; pBlock = pBlock->m_next)
+        size += pBlock->m_size;
+      return size;
       }
 
     /** Patch the firmware with a new ID code
@@ -92,10 +201,85 @@ class FirmwareImpl : public Firmware {
      *         location could not be determined.
      */
     virtual uint32_t patchID(ID id, const uint8_t *uuid) {
-      return 0;
+      return patchMarker(m_pFirst, id, uuid);
       }
   };
 
+/** Convert a pair of hex digits to a byte
+ *
+ * @param cszHex the two characters to convert.
+ *
+ * @return the value of the byte or -1 if the characters are not valid.
+ */
+static int hexByte(const char *cszHex) {
+  int value = 0;
+  for(int i=0; i<2; i++) {
+    char ch = cszHex[i];
+    value <<= 4;
+    if((ch>='0')&&(ch<='9'))
+      value |= ch - '0';
+    else if((ch>='A')&&(ch<='F'))
+      value |= ch - 'A' + 10;
+    else if((ch>='a')&&(ch<='f'))
+      value |= ch - 'a' + 10;
+    else
+      return -1;
+    }
+  return value;
+  }
+
+/** Find an ID marker in a list of blocks
+ *
+ * @param pFirst the first block to search.
+ * @param id the type of ID to find.
+ * @param ppData receives a pointer to the marker data (may be NULL).
+ *
+ * @return the address of the marker or INVALID_ADDRESS if the marker is not
+ *         present.
+ */
+static uint32_t locateMarker(Firmware::Block *pFirst, Firmware::ID id, uint8_t **ppData) {
+  const uint8_t *pMarker = (id==Firmware::NODEID) ? NODEID_MARKER : TYPEID_MARKER;
+  for(Firmware::Block *pBlock = pFirst; pBlock!=NULL; pBlock = pBlock->m_next) {
+    for(uint32_t offset=0; (offset + UUID_LENGTH)<=pBlock->m_size; offset++) {
+      if(memcmp(&pBlock->m_data[offset], pMarker, UUID_LENGTH)==0) {
+        if(ppData!=NULL)
+          *ppData = &pBlock->m_data[offset];
+        return pBlock->m_base + offset;
+        }
+      }
+    }
+  return INVALID_ADDRESS;
+  }
+
+/** Replace an ID marker in a list of blocks
+ *
+ * @param pFirst the first block to search.
+ * @param id the type of ID to change
+ * @param uuid the 16 byte UUID value to insert into the code.
+ *
+ * @return the address at which the ID was found or INVALID_ADDRESS if the
+ *         marker is not present.
+ */
+uint32_t patchMarker(Firmware::Block *pFirst, Firmware::ID id, const uint8_t *uuid) {
+  uint8_t *pData;
+  uint32_t addr = locateMarker(pFirst, id, &pData);
+  if(addr!=INVALID_ADDRESS)
+    memcpy(pData, uuid, UUID_LENGTH);
+  return addr;
+  }
+
+/** Find an ID marker in a list of blocks
+ *
+ * @param pFirst the first block to search.
+ * @param id the type of ID to find.
+ *
+ * @return the address of the marker or INVALID_ADDRESS if the marker is not
+ *         present.
+ */
+uint32_t findMarker(Firmware::Block *pFirst, Firmware::ID id) {
+  return locateMarker(pFirst, id, NULL);
+  }
+
 /** Load firmware from a Intel Hex file.
  *
  * This function creates a new Firmware instance and populates it from the
@@ -107,10 +291,70 @@ class FirmwareImpl : public Firmware {
  *         error occurs.
  */
 Firmware *loadFirmware(const char *cszFilename) {
-  // TODO: Make sure the file exists and we can read it
+  FILE *fp = fopen(cszFilename, "r");
+  if(fp==NULL) {
+    ELog("Unable to open '%s'.", cszFilename);
+    return NULL;
+    }
   FirmwareImpl *firmware = new FirmwareImpl();
-  // TODO: Load file contents into Firmware instance
+  char szLine[MAX_LINE_LENGTH];
+  uint8_t record[MAX_LINE_LENGTH / 2];
+  uint32_t upper = 0;
+  int line = 0;
+  bool done = false;
+  while(!done&&(fgets(szLine, sizeof(szLine), fp)!=NULL)) {
+    line++;
+    // Strip trailing white space and skip blank lines
+    int length = (int)strlen(szLine);
+    while((length>0)&&((szLine[length - 1]=='\r')||(szLine[length - 1]=='\n')||(szLine[length - 1]==' ')))
+      length--;
+    if(length==0)
+      continue;
+    // Decode the record
+    bool valid = (szLine[0]==':')&&((length % 2)==1);
+    int count = (length - 1) / 2;
+    uint8_t checksum = 0;
+    for(int i=0; valid&&(i<count); i++) {
+      int value = hexByte(&szLine[1 + (i * 2)]);
+      valid = (value>=0);
+      record[i] = (uint8_t)value;
+      checksum += record[i];
+      }
+    valid = valid&&(count>=5)&&(count==(record[0] + 5))&&(checksum==0);
+    if(!valid) {
+      ELog("Invalid record in '%s' at line %d.", cszFilename, line);
+      fclose(fp);
+      delete firmware;
+      return NULL;
+      }
+    uint32_t address = ((uint32_t)record[1] << 8) | record[2];
+    switch(record[3]) {
+      case RECORD_DATA:
+        if(!firmware->addData(upper + address, &record[4], record[0])) {
+          ELog("Overlapping data in '%s' at line %d.", cszFilename, line);
+          fclose(fp);
+          delete firmware;
+          return NULL;
+          }
+        break;
+      case RECORD_EOF:
+        done = true;
+        break;
+      case RECORD_SEGMENT_ADDRESS:
+        upper = (((uint32_t)record[4] << 8) | record[5]) << 4;
+        break;
+      case RECORD_LINEAR_ADDRESS:
+        upper = (((uint32_t)record[4] << 8) | record[5]) << 16;
+        break;
+      default:
+        // Start addresses are not needed
+        break;
+      }
+    }
+  fclose(fp);
+  if(!done)
+    ILog("No end of file record in '%s'.", cszFilename);
+  DLog("Loaded %u bytes from '%s' (0x%08x to 0x%08x).", firmware->flashSize(), cszFilename, firmware->baseAddress(), firmware->lastAddress());
   // All done
   return firmware;
   }
-
@@ -0,0 +1,97 @@
+/*---------------------------------------------------------------------------*
+* Grand Unified Flasher (GRUF) - File Mapping for Linux
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Implements the file access functions with stat() and mmap().
+*---------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <gruf.h>
+
+/** Implementation of MappedFile using mmap()
+ */
+class MappedFileImpl : public MappedFile {
+  private:
+    uint8_t *m_pData; // Start of the mapping
+    uint32_t m_size;  // Size of the mapping
+
+  public:
+    /** Constructor
+     *
+     * @param pData the start of the mapping.
+     * @param size the size of the mapping.
+     */
+    MappedFileImpl(uint8_t *pData, uint32_t size) {
+      m_pData = pData;
+      m_size = size;
+      }
+
+    /** Destructor
+     */
+    virtual ~MappedFileImpl() {
+      munmap(m_pData, m_size);
+      }
+
+    /** Get the contents of the file
+     *
+     * @return a pointer to the first byte of the file.
+     */
+    virtual uint8_t *data() {
+      return m_pData;
+      }
+
+    /** Get the size of the mapping
+     *
+     * @return the number of bytes mapped.
+     */
+    virtual uint32_t size() {
+      return m_size;
+      }
+  };
+
+/** Get the size and modification time of a file
+ *
+ * @param cszFilename the name of the file.
+ * @param pInfo receives the information.
+ *
+ * @return true if the information is available, false if not.
+ */
+bool fileInfo(const char *cszFilename, FileInfo *pInfo) {
+  struct stat info;
+  if(stat(cszFilename, &info)!=0)
+    return false;
+  pInfo->m_size = (uint64_t)info.st_size;
+  pInfo->m_modified = ((uint64_t)info.st_mtim.tv_sec * 1000000000ULL) + (uint64_t)info.st_mtim.tv_nsec;
+  return true;
+  }
+
+/** Map a file into memory
+ *
+ * This is a generic wrapper around the underlying operating system
+ * implementation.
+ *
+ * @param cszFilename the name of the file to map.
+ *
+ * @return a MappedFile instance or NULL if the file could not be mapped.
+ */
+MappedFile *mapFile(const char *cszFilename) {
+  int fd = open(cszFilename, O_RDONLY);
+  if(fd<0)
+    return NULL;
+  struct stat info;
+  if((fstat(fd, &info)!=0)||(info.st_size==0)||(info.st_size>0x7fffffff)) {
+    close(fd);
+    return NULL;
+    }
+  void *pData = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(pData==MAP_FAILED)
+    return NULL;
+  return new MappedFileImpl((uint8_t *)pData, (uint32_t)info.st_size);
+  }
@@ -4,10 +4,21 @@
 * 27-Oct-2015 ShaneG
 *
 * Main program for the flashing tool.
+*
+* 19-Oct-2026
+*
+* Added the 'diff' command to build firmware deltas for over the air updates.
+* Hex files are loaded through the firmware cache unless --nocache is given.
+* A delta is only built if the NODEID and TYPEID markers are outside the
+* application image, so the image (and its CRC) is the same on every node.
 *---------------------------------------------------------------------------*/
 #include <iostream>
+#include <stdlib.h>
+#include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <stdbool.h>
+#include <time.h>
 #include <gruf.h>
 #include <optionparser.h>
 
@@ -15,16 +26,26 @@
 #define VER_MAJOR 0
 #define VER_MINOR 1
 
+// Default start of the application image (XMC1100, see xmc1100.ld)
+#define DEFAULT_IMAGE_BASE 0x10002000
+
+// Flash page size used for statistics
+#define DIFF_PAGE_SIZE 256
+
+// Number of times the delta is built when benchmarking
+#define BENCHMARK_RUNS 20
+
 struct Arg: public option::Arg {
   static option::ArgStatus Required(const option::Option& option, bool) {
     return option.arg == 0 ? option::ARG_ILLEGAL : option::ARG_OK;
     }
   };
 
-enum  optionIndex { UNKNOWN, HELP, SILENT, NOISY, SETTYPE, SETNODE, DEVICE, PORT, ERASE };
+enum  optionIndex { UNKNOWN, HELP, SILENT, NOISY, SETTYPE, SETNODE, DEVICE, PORT, ERASE, OUTPUT, BASE, BENCHMARK, NOCACHE };
 
 const option::Descriptor usage[] = {
-  { UNKNOWN, 0, "" , ""    , option::Arg::None, "USAGE: gruf [options] hexfile\n\n"
+  { UNKNOWN, 0, "" , ""    , option::Arg::None, "USAGE: gruf [options] hexfile\n"
+                                              "       gruf [options] diff oldhex newhex\n\n"
                                               "Options:" },
   { HELP,    0, "" , "help", Arg::None, "  --help  \tPrint usage and exit." },
   { SILENT,  0, "q", "quiet", Arg::None, "  --quiet, -q  \tRun in quiet mode." },
@@ -34,9 +55,173 @@ const option::Descriptor usage[] = {
   { DEVICE,  0, "d", "device", Arg::Required, "  --device, -d device  \tSpecify the target device." },
   { PORT,    0, "p", "port", Arg::Required, "  --port, -p port  \tSpecify the serial port to use." },
   { ERASE,   0, "e", "erase", Arg::None, "  --erase, -e  \tErase the flash before programming." },
+  { OUTPUT,  0, "o", "output", Arg::Required, "  --output, -o file  \tFile to write the delta to (diff only)." },
+  { BASE,    0, "", "base", Arg::Required, "  --base address  \tStart of the application image (diff only)." },
+  { BENCHMARK, 0, "", "benchmark", Arg::None, "  --benchmark  \tReport the time taken to build the delta (diff only)." },
+  { NOCACHE, 0, "", "nocache", Arg::None, "  --nocache  \tAlways parse the hex files, do not use or update the cache." },
   {0,0,0,0,0,0}
   };
 
+/** Load the application image from a hex file
+ *
+ * @param cszFilename the hex file.
+ * @param base the start of the application image.
+ * @param cache true to use the firmware cache.
+ * @param ppFirmware receives the firmware.
+ * @param pSize receives the size of the image.
+ *
+ * @return the image or NULL on error.
+ */
+static uint8_t *loadImage(const char *cszFilename, uint32_t base, bool cache, Firmware **ppFirmware, uint32_t *pSize) {
+  *ppFirmware = cache ? loadCachedFirmware(cszFilename) : loadFirmware(cszFilename);
+  if(*ppFirmware==NULL) {
+    ELog("Unable to load firmware from '%s'.", cszFilename);
+    return NULL;
+    }
+  uint8_t *pImage = getImage(*ppFirmware, base, pSize);
+  if(pImage==NULL)
+    ELog("No data at or after 0x%08x in '%s'.", base, cszFilename);
+  return pImage;
+  }
+
+/** Check if the data before the application image has changed
+ *
+ * The delta only updates the application, changes to the boot loader have
+ * to be flashed.
+ *
+ * @param pOld the old firmware.
+ * @param pNew the new firmware.
+ * @param base the start of the application image.
+ *
+ * @return true if the data before the image is the same.
+ */
+static bool sameBoot(Firmware *pOld, Firmware *pNew, uint32_t base) {
+  Firmware::Block *pOldBlock = pOld->first(), *pNewBlock = pNew->first();
+  while(true) {
+    bool oldDone = (pOldBlock==NULL)||(pOldBlock->m_base>=base);
+    bool newDone = (pNewBlock==NULL)||(pNewBlock->m_base>=base);
+    if(oldDone||newDone)
+      return oldDone&&newDone;
+    uint32_t oldSize = ((pOldBlock->m_base + pOldBlock->m_size)>base) ? (base - pOldBlock->m_base) : pOldBlock->m_size;
+    uint32_t newSize = ((pNewBlock->m_base + pNewBlock->m_size)>base) ? (base - pNewBlock->m_base) : pNewBlock->m_size;
+    if((pOldBlock->m_base!=pNewBlock->m_base)||(oldSize!=newSize)||(memcmp(pOldBlock->m_data, pNewBlock->m_data, oldSize)!=0))
+      return false;
+    pOldBlock = pOldBlock->m_next;
+    pNewBlock = pNewBlock->m_next;
+    }
+  }
+
+/** Check the ID markers are outside the application image
+ *
+ * Every node has its own NODEID (and possibly TYPEID) written over the
+ * markers when it is flashed. The image CRCs in the delta only match the
+ * nodes if the IDs are outside the image, and only then does the delta keep
+ * each node's IDs. The hex file must be the unpatched build output.
+ *
+ * @param pFirmware the firmware.
+ * @param cszFilename the hex file it was loaded from.
+ * @param base the start of the application image.
+ *
+ * @return true if both markers were found before the image.
+ */
+static bool checkIDs(Firmware *pFirmware, const char *cszFilename, uint32_t base) {
+  static const Firmware::ID ids[] = { Firmware::NODEID, Firmware::TYPEID };
+  static const char *names[] = { "NODEID", "TYPEID" };
+  for(int i=0; i<2; i++) {
+    uint32_t addr = findMarker(pFirmware->first(), ids[i]);
+    if(addr==INVALID_ADDRESS) {
+      ELog("No %s marker in '%s', use the unpatched build output.", names[i], cszFilename);
+      return false;
+      }
+    if(addr>=base) {
+      ELog("%s is inside the application image in '%s' (0x%08x), the delta would not match per node images.", names[i], cszFilename, addr);
+      return false;
+      }
+    }
+  return true;
+  }
+
+/** Build a delta between two firmware images
+ *
+ * @param cszOld the hex file installed on the devices.
+ * @param cszNew the hex file to install.
+ * @param cszOutput the file to write the delta to.
+ * @param base the start of the application image.
+ * @param benchmark true to report the time taken.
+ * @param cache true to use the firmware cache.
+ *
+ * @return the exit code for the program.
+ */
+static int diffFirmware(const char *cszOld, const char *cszNew, const char *cszOutput, uint32_t base, bool benchmark, bool cache) {
+  Firmware *pOldFirmware, *pNewFirmware;
+  uint32_t oldSize, newSize;
+  uint8_t *pOld = loadImage(cszOld, base, cache, &pOldFirmware, &oldSize);
+  if(pOld==NULL)
+    return 1;
+  uint8_t *pNew = loadImage(cszNew, base, cache, &pNewFirmware, &newSize);
+  if(pNew==NULL)
+    return 1;
+  if(!checkIDs(pOldFirmware, cszOld, base)||!checkIDs(pNewFirmware, cszNew, base))
+    return 1;
+  if(!sameBoot(pOldFirmware, pNewFirmware, base))
+    ILog("Data before 0x%08x has changed, it will not be updated by the delta.", base);
+  // Build the delta
+  DeltaStats stats;
+  uint32_t length;
+  clock_t start = clock();
+  uint8_t *pDelta = createDelta(pOld, oldSize, pNew, newSize, &length, &stats);
+  clock_t elapsed = clock() - start;
+  if(benchmark) {
+    for(int run=1; run<BENCHMARK_RUNS; run++) {
+      free(pDelta);
+      pDelta = createDelta(pOld, oldSize, pNew, newSize, &length, &stats);
+      }
+    elapsed = clock() - start;
+    }
+  // Make sure it produces the new image
+  uint32_t size;
+  uint8_t *pCheck = applyDelta(pOld, oldSize, pDelta, length, &size);
+  bool valid = (pCheck!=NULL)&&(size==newSize)&&(memcmp(pCheck, pNew, newSize)==0);
+  free(pCheck);
+  if(!valid) {
+    ELog("The delta does not reproduce '%s'.", cszNew);
+    return 1;
+    }
+  // Count the pages that will change
+  uint32_t pages = 0, changed = 0;
+  for(uint32_t offset=0; offset<newSize; offset+=DIFF_PAGE_SIZE, pages++) {
+    uint32_t count = ((newSize - offset)<DIFF_PAGE_SIZE) ? (newSize - offset) : DIFF_PAGE_SIZE;
+    if(((offset + count)>oldSize)||(memcmp(&pOld[offset], &pNew[offset], count)!=0))
+      changed++;
+    }
+  ILog("Image is %u bytes (was %u bytes), %u of %u pages changed.", newSize, oldSize, changed, pages);
+  ILog("Delta is %u bytes (%.1f%% of the image) - %u bytes copied, %u literal, %u commands.",
+    length, (100.0 * length) / newSize, stats.m_copied, stats.m_literal, stats.m_commands);
+  if(benchmark) {
+    double ms = (1000.0 * elapsed) / CLOCKS_PER_SEC;
+    ILog("Built %d deltas in %.1fms (%.2fms each).", BENCHMARK_RUNS, ms, ms / BENCHMARK_RUNS);
+    }
+  // Save it
+  FILE *fp = fopen(cszOutput, "wb");
+  if(fp==NULL) {
+    ELog("Unable to create '%s'.", cszOutput);
+    return 1;
+    }
+  bool written = (fwrite(pDelta, 1, length, fp)==length);
+  written = (fclose(fp)==0)&&written;
+  if(!written) {
+    ELog("Unable to write '%s'.", cszOutput);
+    return 1;
+    }
+  ILog("Wrote delta to '%s'.", cszOutput);
+  free(pDelta);
+  free(pOld);
+  free(pNew);
+  delete pOldFirmware;
+  delete pNewFirmware;
+  return 0;
+  }
+
 /** Program entry point
  */
 int main(int argc, char *argv[]) {
@@ -71,6 +256,34 @@ int main(int argc, char *argv[]) {
     setVerbosity(QUIET);
   if(options[NOISY])
     setVerbosity(VERBOSE);
+  // Build a delta if requested
+  if((parse.nonOptionsCount()>0)&&(strcmp(parse.nonOption(0), "diff")==0)) {
+    if(parse.nonOptionsCount()!=3) {
+      ELog("You must specify the old and new hex files to compare.");
+      return 1;
+      }
+    uint32_t base = DEFAULT_IMAGE_BASE;
+    if(options[BASE]&&options[BASE].arg) {
+      char *pEnd;
+      base = strtoul(options[BASE].arg, &pEnd, 0);
+      if((*pEnd!='\0')||(pEnd==options[BASE].arg)) {
+        ELog("Invalid base address '%s'.", options[BASE].arg);
+        return 1;
+        }
+      }
+    std::string output;
+    if(options[OUTPUT]&&options[OUTPUT].arg)
+      output = options[OUTPUT].arg;
+    else {
+      // Replace the extension of the new file
+      output = parse.nonOption(2);
+      size_t dot = output.find_last_of('.');
+      if((dot!=std::string::npos)&&(output.find_first_of("/\\", dot)==std::string::npos))
+        output.erase(dot);
+      output += ".delta";
+      }
+    return diffFirmware(parse.nonOption(1), parse.nonOption(2), output.c_str(), base, options[BENCHMARK]!=NULL, options[NOCACHE]==NULL);
+    }
   // Check for device
   if((options[DEVICE]==NULL)||(options[DEVICE].arg==NULL)||(options[DEVICE].arg[0]=='\0')) {
     ELog("Device type must be specified.");
@@ -116,7 +329,7 @@ int main(int argc, char *argv[]) {
     ELog("You must specify a hex file on the command line.");
     return 1;
     }
-  Firmware *pFirmware = loadFirmware(parse.nonOption(0));
+  Firmware *pFirmware = options[NOCACHE] ? loadFirmware(parse.nonOption(0)) : loadCachedFirmware(parse.nonOption(0));
   if(pFirmware==NULL) {
     ELog("Unable to load firmware from '%s'.", parse.nonOption(0));
     return 1;
@@ -0,0 +1,99 @@
+/*---------------------------------------------------------------------------*
+* Grand Unified Flasher (GRUF) - File Mapping for Windows
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Implements the file access functions with the Windows file mapping API.
+*---------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <windows.h>
+#include <gruf.h>
+
+/** Implementation of MappedFile using MapViewOfFile()
+ */
+class MappedFileImpl : public MappedFile {
+  private:
+    uint8_t *m_pData; // Start of the view
+    uint32_t m_size;  // Size of the view
+
+  public:
+    /** Constructor
+     *
+     * @param pData the start of the view.
+     * @param size the size of the view.
+     */
+    MappedFileImpl(uint8_t *pData, uint32_t size) {
+      m_pData = pData;
+      m_size = size;
+      }
+
+    /** Destructor
+     */
+    virtual ~MappedFileImpl() {
+      UnmapViewOfFile(m_pData);
+      }
+
+    /** Get the contents of the file
+     *
+     * @return a pointer to the first byte of the file.
+     */
+    virtual uint8_t *data() {
+      return m_pData;
+      }
+
+    /** Get the size of the mapping
+     *
+     * @return the number of bytes mapped.
+     */
+    virtual uint32_t size() {
+      return m_size;
+      }
+  };
+
+/** Get the size and modification time of a file
+ *
+ * @param cszFilename the name of the file.
+ * @param pInfo receives the information.
+ *
+ * @return true if the information is available, false if not.
+ */
+bool fileInfo(const char *cszFilename, FileInfo *pInfo) {
+  WIN32_FILE_ATTRIBUTE_DATA info;
+  if(!GetFileAttributesExA(cszFilename, GetFileExInfoStandard, &info))
+    return false;
+  pInfo->m_size = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+  pInfo->m_modified = ((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+  return true;
+  }
+
+/** Map a file into memory
+ *
+ * This is a generic wrapper around the underlying operating system
+ * implementation.
+ *
+ * @param cszFilename the name of the file to map.
+ *
+ * @return a MappedFile instance or NULL if the file could not be mapped.
+ */
+MappedFile *mapFile(const char *cszFilename) {
+  HANDLE hFile = CreateFileA(cszFilename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(hFile==INVALID_HANDLE_VALUE)
+    return NULL;
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(hFile, &size)||(size.QuadPart==0)||(size.QuadPart>0x7fffffff)) {
+    CloseHandle(hFile);
+    return NULL;
+    }
+  // The view keeps the file open once the handles are closed
+  HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  CloseHandle(hFile);
+  if(hMapping==NULL)
+    return NULL;
+  void *pData = MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, 0);
+  CloseHandle(hMapping);
+  if(pData==NULL)
+    return NULL;
+  return new MappedFileImpl((uint8_t *)pData, (uint32_t)size.QuadPart);
+  }
@@ -0,0 +1,244 @@
+/*---------------------------------------------------------------------------*
+* SensNode Host Tests - Date and time conversions
+*----------------------------------------------------------------------------*
+* 19-Oct-2026
+*
+* Checks 'toTimestamp()', 'fromTimestamp()' and 'isDateTimeValid()' against
+* the C library ('gmtime_r()' and 'timegm()') over the full timestamp range
+* (1/1/1970 to 7/2/2106 06:28:15). Every day in the range is tested at the
+* start, end and a varying time of day, use --full to test every timestamp.
+* Use --benchmark to time the conversions against the C library.
+*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sensnode.h>
+
+// Last valid timestamp (7/2/2106 06:28:15)
+#define TIMESTAMP_LAST 0xffffffffUL
+
+// Number of days in the range (including the partial last day)
+#define DAYS_IN_RANGE  ((TIMESTAMP_LAST / 86400) + 1)
+
+// Conversions made for each benchmark run
+#define BENCHMARK_COUNT 10000000
+
+// Number of failures reported before going quiet
+#define REPORT_LIMIT   10
+
+// Total failures
+static unsigned long g_failures = 0;
+
+//---------------------------------------------------------------------------
+// Helpers
+//---------------------------------------------------------------------------
+
+/** Report a failure
+ */
+static void fail(const char *cszTest, uint32_t timestamp, const DATETIME *pDateTime) {
+  if(g_failures++<REPORT_LIMIT)
+    printf("FAIL: %s %lu (%04u-%02u-%02u %02u:%02u:%02u)\n", cszTest, (unsigned long)timestamp,
+      pDateTime->m_year, pDateTime->m_month, pDateTime->m_day,
+      pDateTime->m_hour, pDateTime->m_minute, pDateTime->m_second);
+  }
+
+/** Convert a timestamp with the C library
+ */
+static void expected(DATETIME *pDateTime, uint32_t timestamp) {
+  time_t t = timestamp;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  pDateTime->m_year = tm.tm_year + 1900;
+  pDateTime->m_month = tm.tm_mon + 1;
+  pDateTime->m_day = tm.tm_mday;
+  pDateTime->m_hour = tm.tm_hour;
+  pDateTime->m_minute = tm.tm_min;
+  pDateTime->m_second = tm.tm_sec;
+  }
+
+/** Check a single timestamp in both directions
+ */
+static void check(uint32_t timestamp) {
+  DATETIME want, got;
+  expected(&want, timestamp);
+  fromTimestamp(&got, timestamp);
+  if(memcmp(&want, &got, sizeof(DATETIME))!=0)
+    fail("fromTimestamp", timestamp, &got);
+  if(!isDateTimeValid(&want))
+    fail("isDateTimeValid", timestamp, &want);
+  if(toTimestamp(&want)!=timestamp)
+    fail("toTimestamp", timestamp, &want);
+  }
+
+/** Check the validation of a date against the C library
+ *
+ * A date is valid if 'timegm()' does not have to normalise it.
+ */
+static void checkValid(uint16_t year, uint8_t month, uint8_t day) {
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  tm.tm_year = year - 1900;
+  tm.tm_mon = month - 1;
+  tm.tm_mday = day;
+  timegm(&tm);
+  bool valid = (tm.tm_mon==(month - 1))&&(tm.tm_mday==day);
+  DATETIME when = { year, month, day, 0, 0, 0 };
+  if(isDateTimeValid(&when)!=valid)
+    fail("isDateTimeValid", 0, &when);
+  }
+
+/** Check that a date time is rejected by 'toTimestamp()'
+ */
+static void checkRejected(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second) {
+  DATETIME when = { year, month, day, hour, minute, second };
+  if(toTimestamp(&when)!=0)
+    fail("toTimestamp (out of range)", toTimestamp(&when), &when);
+  }
+
+/** Get the current time in nanoseconds
+ */
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1e9) + ts.tv_nsec;
+  }
+
+//---------------------------------------------------------------------------
+// Tests
+//---------------------------------------------------------------------------
+
+/** Test every day in the range
+ */
+static void testDays() {
+  for(uint32_t day=0; day<DAYS_IN_RANGE; day++) {
+    uint32_t start = day * 86400;
+    check(start);
+    // Vary the time of day so every second of the day is covered
+    check(start + ((day * 7919) % 86400));
+    if((TIMESTAMP_LAST - start)>=86399)
+      check(start + 86399);
+    }
+  check(TIMESTAMP_LAST);
+  }
+
+/** Test every timestamp in the range
+ */
+static void testFull() {
+  for(uint64_t timestamp=0; timestamp<=TIMESTAMP_LAST; timestamp++) {
+    check((uint32_t)timestamp);
+    if((timestamp&0x0fffffff)==0x0fffffff) {
+      printf("  %lu%%\r", (unsigned long)((timestamp * 100) / TIMESTAMP_LAST));
+      fflush(stdout);
+      }
+    }
+  }
+
+/** Test date validation, including days that do not exist
+ */
+static void testValid() {
+  for(uint16_t year=1900; year<=2400; year++)
+    for(uint8_t month=1; month<=12; month++)
+      for(uint8_t day=1; day<=31; day++)
+        checkValid(year, month, day);
+  }
+
+/** Test values outside the timestamp range or with invalid fields
+ */
+static void testRejected() {
+  checkRejected(1969, 12, 31, 23, 59, 59);
+  checkRejected(2106, 2, 7, 6, 28, 16);
+  checkRejected(2106, 2, 8, 0, 0, 0);
+  checkRejected(2107, 1, 1, 0, 0, 0);
+  checkRejected(2100, 2, 29, 0, 0, 0);
+  checkRejected(2001, 0, 1, 0, 0, 0);
+  checkRejected(2001, 13, 1, 0, 0, 0);
+  checkRejected(2001, 4, 31, 0, 0, 0);
+  checkRejected(2001, 1, 0, 0, 0, 0);
+  checkRejected(2001, 1, 1, 24, 0, 0);
+  checkRejected(2001, 1, 1, 0, 60, 0);
+  checkRejected(2001, 1, 1, 0, 0, 60);
+  if(isDateTimeValid(NULL))
+    printf("FAIL: isDateTimeValid(NULL)\n"), g_failures++;
+  if(toTimestamp(NULL)!=0)
+    printf("FAIL: toTimestamp(NULL)\n"), g_failures++;
+  }
+
+/** Time the conversions against the C library
+ *
+ * The host figures only compare the algorithms, use the 'timestamp_bench'
+ * sample to measure cycles on the target.
+ */
+static void benchmark() {
+  volatile uint32_t sink = 0;
+  DATETIME when;
+  struct tm tm;
+  uint32_t step = TIMESTAMP_LAST / BENCHMARK_COUNT;
+  // fromTimestamp() against gmtime_r()
+  double start = now();
+  for(uint32_t i=0; i<BENCHMARK_COUNT; i++) {
+    fromTimestamp(&when, i * step);
+    sink += when.m_day;
+    }
+  double from = (now() - start) / BENCHMARK_COUNT;
+  start = now();
+  for(uint32_t i=0; i<BENCHMARK_COUNT; i++) {
+    time_t t = i * step;
+    gmtime_r(&t, &tm);
+    sink += tm.tm_mday;
+    }
+  double gmtime = (now() - start) / BENCHMARK_COUNT;
+  // toTimestamp() against timegm()
+  fromTimestamp(&when, 0x7fffffff);
+  start = now();
+  for(uint32_t i=0; i<BENCHMARK_COUNT; i++) {
+    when.m_second = i % 60;
+    sink += toTimestamp(&when);
+    }
+  double to = (now() - start) / BENCHMARK_COUNT;
+  expected(&when, 0x7fffffff);
+  memset(&tm, 0, sizeof(tm));
+  tm.tm_year = when.m_year - 1900;
+  tm.tm_mon = when.m_month - 1;
+  tm.tm_mday = when.m_day;
+  start = now();
+  for(uint32_t i=0; i<BENCHMARK_COUNT; i++) {
+    tm.tm_sec = i % 60;
+    sink += timegm(&tm);
+    }
+  double timegmTime = (now() - start) / BENCHMARK_COUNT;
+  printf("fromTimestamp %6.1f ns  gmtime_r %6.1f ns\n", from, gmtime);
+  printf("toTimestamp   %6.1f ns  timegm   %6.1f ns\n", to, timegmTime);
+  }
+
+//---------------------------------------------------------------------------
+// Main program
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+  bool full = false, bench = false;
+  for(int i=1; i<argc; i++) {
+    if(strcmp(argv[i], "--full")==0)
+      full = true;
+    else if(strcmp(argv[i], "--benchmark")==0)
+      bench = true;
+    else {
+      printf("Usage: %s [--full] [--benchmark]\n", argv[0]);
+      return 1;
+      }
+    }
+  // The C library must handle the full unsigned range
+  if(sizeof(time_t)<8) {
+    printf("FAIL: a 64 bit time_t is required\n");
+    return 1;
+    }
+  testRejected();
+  testValid();
+  if(full)
+    testFull();
+  else
+    testDays();
+  if(bench)
+    benchmark();
+  printf("datetime: %s (%lu failures)\n", g_failures ? "FAILED" : "passed", g_failures);
+  return g_failures ? 1 : 0;
+  }